@@ -100,7 +100,14 @@ static void fast_exact_tests() {
       Exact<2*a> rr(uninit); \
       const auto ax = is_negative(x) ? -x : x; \
       mpn_sqr(rr.n,ax.n,x.limbs); \
-      GEODE_ASSERT(rr == xx,format("sqr %d:\n   x %s\n  xx %s\n   r %s",a,hex(x),hex(xx),hex(rr))); }
+      GEODE_ASSERT(rr == xx,format("sqr %d:\n   x %s\n  xx %s\n   r %s",a,hex(x),hex(xx),hex(rr))); \
+      GEODE_ASSERT(-x == gmp_neg(x),format("neg %d:\n   x %s\n  -x %s",a,hex(x),hex(-x))); \
+      Exact<a> one, z = x; \
+      one.n[0] = 1; \
+      z.n[0] = mp_limb_t(-1); /* Force a carry */ \
+      const auto z1 = gmp_add(z,one); \
+      ++z; \
+      GEODE_ASSERT(z == z1); }
     #define MUL(a,b) { \
       const auto x = random_exact<a>(random); \
       const auto y = random_exact<b>(random); \
@@ -13,6 +13,9 @@
 #include <geode/utility/endian.h>
 #include <geode/utility/move.h>
 #include <gmp.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 namespace geode {
 
 #if GMP_LIMB_BITS==64 && defined(__GNUC__)
@@ -81,10 +84,10 @@ template<int d> static inline bool is_nonzero(const Exact<d>& x) {
 }
 
 template<int d> static inline bool operator==(const Exact<d>& lhs, const Exact<d>& rhs) {
-  if(Exact<d>::limbs == 1)
-    return lhs.n[0] == rhs.n[0];
-  else
-    return mpn_cmp(lhs.n, rhs.n, Exact<d>::limbs) == 0;
+  for (int i=0;i<lhs.limbs;i++)
+    if (lhs.n[i]!=rhs.n[i])
+      return false;
+  return true;
 }
 
 // For template compatibility with Interval
@@ -111,15 +114,18 @@ template<int d> static inline bool operator>(const Exact<d>& lhs, const Exact<d>
   return sign(lhs - rhs) > 0;
 }
 
-#if GEODE_FAST_EXACT
-
-// Pull in autogenerated arithmetic routines
-#include <geode/exact/exact-generated.h>
+// GMP's assembly uses legacy SSE encodings, which stall on every instruction if the upper halves of the AVX registers
+// are dirty.  Inlined floating point code can leave them dirty, so routines which make many GMP calls clean up first.
+static inline void clear_avx_state() {
+#ifdef __AVX__
+  _mm256_zeroupper();
+#endif
+}
 
-#endif // GEODE_FAST_EXACT
+// Generic GMP arithmetic.  In fast mode, the operators below use these only for large degrees, but they are available
+// for any degree so that the autogenerated routines can be tested and benchmarked against them.
 
-template<int a> GEODE_PURE static inline Exact<a> operator+(const Exact<a> x, const Exact<a> y) {
-  ASSERT_LARGE(a);
+template<int a> GEODE_PURE static inline Exact<a> gmp_add(const Exact<a> x, const Exact<a> y) {
   Exact<a> r(uninit);
   if (r.limbs==1)
     r.n[0] = x.n[0] + y.n[0];
@@ -128,17 +134,7 @@ template<int a> GEODE_PURE static inline Exact<a> operator+(const Exact<a> x, co
   return r;
 }
 
-template<int a> static inline typename enable_if_c<(a<=32)>::type operator+=(Exact<a>& x, const Exact<a>& y) {
-  x = x+y;
-}
-
-template<int a> static inline typename enable_if_c<(a>32)>::type operator+=(Exact<a>& x, const Exact<a>& y) {
-  ASSERT_LARGE(a);
-  mpn_add_n(x.n,x.n,y.n,x.limbs);
-}
-
-template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x, const Exact<a> y) {
-  ASSERT_LARGE(a);
+template<int a> GEODE_PURE static inline Exact<a> gmp_sub(const Exact<a> x, const Exact<a> y) {
   Exact<a> r(uninit);
   if (r.limbs==1)
     r.n[0] = x.n[0] - y.n[0];
@@ -147,10 +143,7 @@ template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x, co
   return r;
 }
 
-template<int a,int b> GEODE_PURE static inline typename enable_if_c<(a>=b),Exact<a+b>>::type
-operator*(const Exact<a> x, const Exact<b> y) {
-  ASSERT_LARGE(a);
-  ASSERT_LARGE(b);
+template<int a,int b> GEODE_PURE static inline Exact<a+b> gmp_mul(const Exact<a> x, const Exact<b> y) {
   // Perform multiplication as if inputs were unsigned
   Exact<a+b> r(uninit);
   if (a>=b)
@@ -173,14 +166,7 @@ operator*(const Exact<a> x, const Exact<b> y) {
   return r;
 }
 
-// Multiplication is symmetric
-template<int a,int b> GEODE_PURE static inline typename enable_if_c<(a<b),Exact<a+b>>::type
-operator*(const Exact<a> x, const Exact<b> y) {
-  return y*x;
-}
-
-template<int a> GEODE_PURE static inline Exact<2*a> sqr(const Exact<a> x) {
-  ASSERT_LARGE(a);
+template<int a> GEODE_PURE static inline Exact<2*a> gmp_sqr(const Exact<a> x) {
   Exact<2*a> r(uninit);
   mp_limb_t nx[x.limbs];
   const bool negative = is_negative(x);
@@ -190,8 +176,7 @@ template<int a> GEODE_PURE static inline Exact<2*a> sqr(const Exact<a> x) {
   return r;
 }
 
-template<int a> GEODE_PURE static inline Exact<a> operator<<(const Exact<a> x, const int s) {
-  ASSERT_LARGE(a);
+template<int a> GEODE_PURE static inline Exact<a> gmp_lshift(const Exact<a> x, const int s) {
   assert(0<s && s<=3);
   Exact<a> r(uninit);
   if (x.limbs==1)
@@ -201,7 +186,7 @@ template<int a> GEODE_PURE static inline Exact<a> operator<<(const Exact<a> x, c
   return r;
 }
 
-template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x) {
+template<int a> GEODE_PURE static inline Exact<a> gmp_neg(const Exact<a> x) {
   Exact<a> r(uninit);
   if (r.limbs==1)
     r.n[0] = mp_limb_t(-mp_limb_signed_t(x.n[0]));
@@ -210,16 +195,67 @@ template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x) {
   return r;
 }
 
+#if GEODE_FAST_EXACT
+
+// Pull in autogenerated arithmetic routines
+#include <geode/exact/exact-generated.h>
+
+#endif // GEODE_FAST_EXACT
+
+template<int a> GEODE_PURE static inline Exact<a> operator+(const Exact<a> x, const Exact<a> y) {
+  ASSERT_LARGE(a);
+  return gmp_add(x,y);
+}
+
+template<int a> static inline typename enable_if_c<(a<=32)>::type operator+=(Exact<a>& x, const Exact<a>& y) {
+  x = x+y;
+}
+
+template<int a> static inline typename enable_if_c<(a>32)>::type operator+=(Exact<a>& x, const Exact<a>& y) {
+  ASSERT_LARGE(a);
+  mpn_add_n(x.n,x.n,y.n,x.limbs);
+}
+
+template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x, const Exact<a> y) {
+  ASSERT_LARGE(a);
+  return gmp_sub(x,y);
+}
+
+template<int a,int b> GEODE_PURE static inline typename enable_if_c<(a>=b),Exact<a+b>>::type
+operator*(const Exact<a> x, const Exact<b> y) {
+  ASSERT_LARGE(a);
+  ASSERT_LARGE(b);
+  return gmp_mul(x,y);
+}
+
+// Multiplication is symmetric
+template<int a,int b> GEODE_PURE static inline typename enable_if_c<(a<b),Exact<a+b>>::type
+operator*(const Exact<a> x, const Exact<b> y) {
+  return y*x;
+}
+
+template<int a> GEODE_PURE static inline Exact<2*a> sqr(const Exact<a> x) {
+  ASSERT_LARGE(a);
+  return gmp_sqr(x);
+}
+
+template<int a> GEODE_PURE static inline Exact<a> operator<<(const Exact<a> x, const int s) {
+  ASSERT_LARGE(a);
+  return gmp_lshift(x,s);
+}
+
+template<int a> GEODE_PURE static inline Exact<a> operator-(const Exact<a> x) {
+  return gmp_neg(x);
+}
+
 template<int a> GEODE_PURE static inline Exact<3*a> cube(const Exact<a> x) {
   return x*sqr(x);
 }
 
 template<int a> static inline void operator++(Exact<a>& x) {
-  ASSERT_LARGE(Exact<a>::limbs==1 ? 32 : a);
-  if (x.limbs==1)
-    x.n[0]++;
-  else
-    mpn_add_1(x.n,x.n,x.limbs,1);
+  for (int i=0;i<x.limbs;i++)
+    if (++x.n[i]) // Stop once there is no carry
+      break;
 }
 
 #undef ASSERT_LARGE
@@ -42,9 +42,11 @@ static Array<Box<exact::Vec2>> segment_boxes(RawArray<const int> next, RawArray<
 }
 
 // Compute all nontrivial intersections between segments
+// Collect candidate pairs with overlapping boxes, which intersection_pairs then tests in bulk
 struct SegmentIntersections {
   const ExactSegmentSet& segs;
   Array<Vector<SegmentId,2>> pairs;
+  Array<Vector<exact::Perturbed2,4>> segments;
 
   SegmentIntersections(const ExactSegmentSet& _segs)
     : segs(_segs) {}
@@ -57,8 +59,11 @@ struct SegmentIntersections {
     assert(segs.tree->prims(n0).size()==1 && segs.tree->prims(n1).size()==1);
     const auto s0 = SegmentId(segs.tree->prims(n0)[0]),
                s1 = SegmentId(segs.tree->prims(n1)[0]);
-    if (segs.segments_intersect(s0,s1))
-        pairs.append(vec(s0,s1));
+    const auto d0 = segs.next[s0], d1 = segs.next[s1];
+    if ((s0==s1) || (s0==d1) || (d0==s1) || (d0==d1))
+      return; // Ignore intersections at endpoint
+    pairs.append(vec(s0,s1));
+    segments.append(vec(segs.src(s0),segs.src(d0),segs.src(s1),segs.src(d1)));
   }
 };
 
@@ -150,7 +155,13 @@ uint8_t ExactSegmentSet::quadrant(const SegmentId s) const {
 Array<Vector<SegmentId, 2>> ExactSegmentSet::intersection_pairs() const {
   SegmentIntersections pairs(*this);
   double_traverse(*tree,pairs);
-  return pairs.pairs;
+  Array<bool> intersect(pairs.pairs.size(),uninit);
+  geode::segments_intersect(intersect,pairs.segments);
+  Array<Vector<SegmentId,2>> result;
+  for (const int i : range(intersect.size()))
+    if (intersect[i])
+      result.append(pairs.pairs[i]);
+  return result;
 }
 
 static VertexId src_id(const SegmentId s) { return VertexId(s.idx()); }
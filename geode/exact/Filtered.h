@@ -0,0 +1,211 @@
+// Semi-static floating point filters for exact predicates
+#pragma once
+
+// Before falling back to interval arithmetic, perturbed_predicate evaluates its polynomial in ordinary floating
+// point together with a forward error bound.  This needs no rounding mode changes and no two-sided arithmetic, so
+// it is several times cheaper than Interval and decides the sign of almost all nondegenerate predicates.
+//
+// The bound is the standard one from Higham, Accuracy and Stability of Numerical Algorithms, section 3.1: if an
+// expression with integer inputs is evaluated in floating point, and m is the same expression evaluated on the
+// absolute values of the inputs with all subtractions replaced by additions, then the error is at most gamma(n)*m,
+// where gamma(n) = n*u/(1-n*u) and n is the number of roundings along the worst path through the expression.
+// We take u = 2^-52 so that the bound holds in any rounding mode, since callers are usually inside an IntervalScope.
+
+#include <geode/exact/config.h>
+#include <geode/math/max.h>
+#include <geode/math/One.h>
+#include <geode/utility/type_traits.h>
+#include <geode/vector/forward.h>
+#include <cfloat>
+#include <cmath>
+namespace geode {
+
+// A floating point value together with the same expression evaluated on absolute values
+struct Filtered {
+  double v; // Approximate value
+  double m; // Absolute value bound for error analysis
+
+  Filtered(const double v, const double m)
+    : v(v), m(m) {}
+
+  // Quantized inputs are integers of magnitude at most exact::bound, and are therefore exact
+  explicit Filtered(const Quantized x)
+    : v(x), m(fabs(x)) {}
+};
+
+// The number of roundings along the worst path through an expression.  Since this depends only on the structure of
+// the expression, perturbed_predicate computes it once per predicate by evaluating with FilterDepth.
+struct FilterDepth {
+  int n;
+
+  explicit FilterDepth(const int n)
+    : n(n) {}
+
+  explicit FilterDepth(const Quantized x)
+    : n(0) {}
+};
+
+// Filtered values are treated as scalars so that they are preserved through various arithmetic operations
+template<> struct IsScalar<Filtered> : public mpl::true_ {};
+template<> struct IsScalar<FilterDepth> : public mpl::true_ {};
+
+GEODE_ALWAYS_INLINE static inline Filtered operator+(const Filtered x, const Filtered y) {
+  return Filtered(x.v+y.v,x.m+y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline Filtered operator-(const Filtered x, const Filtered y) {
+  return Filtered(x.v-y.v,x.m+y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline Filtered operator-(const Filtered x) {
+  return Filtered(-x.v,x.m);
+}
+
+GEODE_ALWAYS_INLINE static inline Filtered operator*(const Filtered x, const Filtered y) {
+  return Filtered(x.v*y.v,x.m*y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline Filtered sqr(const Filtered x) {
+  return Filtered(x.v*x.v,x.m*x.m);
+}
+
+// Scaling by powers of two is exact
+GEODE_ALWAYS_INLINE static inline Filtered operator<<(const Filtered x, const int p) {
+  const double y = 1<<p;
+  return Filtered(y*x.v,y*x.m);
+}
+
+GEODE_ALWAYS_INLINE static inline Filtered operator>>(const Filtered x, const int p) {
+  const double y = 1./(1<<p);
+  return Filtered(y*x.v,y*x.m);
+}
+
+// filter_lanes Filtered values packed into SIMD registers via GCC vector extensions, so that batch predicates
+// (see perturbed_predicates) evaluate the filter for several argument tuples at once.  Each lane is rounded exactly
+// as the corresponding scalar Filtered expression would be, so the same thresholds apply.  Other compilers get a
+// plain array with elementwise loops, which computes the same values.
+const int filter_lanes = 4;
+#ifdef __GNUC__
+typedef double FilterLane __attribute__((vector_size(8*filter_lanes)));
+#else
+struct FilterLane {
+  double x[filter_lanes];
+
+  double& operator[](const int k) { return x[k]; }
+  const double& operator[](const int k) const { return x[k]; }
+};
+
+#define GEODE_FILTER_LANE_OP(op) \
+  static inline FilterLane operator op(const FilterLane a, const FilterLane b) { \
+    FilterLane r; \
+    for (int k=0;k<filter_lanes;k++) \
+      r[k] = a[k] op b[k]; \
+    return r; \
+  }
+GEODE_FILTER_LANE_OP(+)
+GEODE_FILTER_LANE_OP(-)
+GEODE_FILTER_LANE_OP(*)
+#undef GEODE_FILTER_LANE_OP
+
+static inline FilterLane operator-(const FilterLane a) {
+  FilterLane r;
+  for (int k=0;k<filter_lanes;k++)
+    r[k] = -a[k];
+  return r;
+}
+
+static inline FilterLane operator*(const double a, const FilterLane b) {
+  FilterLane r;
+  for (int k=0;k<filter_lanes;k++)
+    r[k] = a*b[k];
+  return r;
+}
+#endif
+
+struct FilteredLanes {
+  FilterLane v, m;
+
+  FilteredLanes() {}
+
+  FilteredLanes(const FilterLane v, const FilterLane m)
+    : v(v), m(m) {}
+};
+
+template<> struct IsScalar<FilteredLanes> : public mpl::true_ {};
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator+(const FilteredLanes x, const FilteredLanes y) {
+  return FilteredLanes(x.v+y.v,x.m+y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator-(const FilteredLanes x, const FilteredLanes y) {
+  return FilteredLanes(x.v-y.v,x.m+y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator-(const FilteredLanes x) {
+  return FilteredLanes(-x.v,x.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator*(const FilteredLanes x, const FilteredLanes y) {
+  return FilteredLanes(x.v*y.v,x.m*y.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes sqr(const FilteredLanes x) {
+  return FilteredLanes(x.v*x.v,x.m*x.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator<<(const FilteredLanes x, const int p) {
+  const double y = 1<<p;
+  return FilteredLanes(y*x.v,y*x.m);
+}
+
+GEODE_ALWAYS_INLINE static inline FilteredLanes operator>>(const FilteredLanes x, const int p) {
+  const double y = 1./(1<<p);
+  return FilteredLanes(y*x.v,y*x.m);
+}
+
+static inline FilterDepth operator+(const FilterDepth x, const FilterDepth y) { return FilterDepth(max(x.n,y.n)+1); }
+static inline FilterDepth operator-(const FilterDepth x, const FilterDepth y) { return FilterDepth(max(x.n,y.n)+1); }
+static inline FilterDepth operator-(const FilterDepth x) { return x; }
+static inline FilterDepth operator*(const FilterDepth x, const FilterDepth y) { return FilterDepth(x.n+y.n+1); }
+static inline FilterDepth sqr(const FilterDepth x) { return FilterDepth(2*x.n+1); }
+static inline FilterDepth operator<<(const FilterDepth x, const int p) { return x; }
+static inline FilterDepth operator>>(const FilterDepth x, const int p) { return x; }
+
+// The relative error threshold for an expression of the given depth.  Since m is itself computed with rounding, the
+// true absolute bound is at most m/(1-gamma(n)), so the error is at most gamma(2n)*m.  The threshold (2n+4)*u
+// exceeds this even after rounding of the product with m.
+static inline double filter_threshold(const FilterDepth x) {
+  return (2*x.n+4)*DBL_EPSILON;
+}
+
+static inline double filter_threshold(One) {
+  return 0;
+}
+
+// The sign of the exact value if the error bound proves it, otherwise zero
+static inline int filter_sign(const Filtered x, const double threshold) {
+  const double bound = threshold*x.m;
+  return x.v > bound ?  1
+       : x.v < -bound ? -1
+                      :  0;
+}
+
+static inline int filter_sign(One, const double threshold) {
+  return 1;
+}
+
+// Per lane filter_sign
+static inline void filter_signs(int signs[filter_lanes], const FilteredLanes x, const double threshold) {
+  const FilterLane bound = threshold*x.m;
+  for (int k=0;k<filter_lanes;k++)
+    signs[k] = x.v[k] > bound[k] ?  1
+             : x.v[k] < -bound[k] ? -1
+                                  :  0;
+}
+
+static inline void filter_signs(int signs[filter_lanes], One, const double threshold) {
+  for (int k=0;k<filter_lanes;k++)
+    signs[k] = 1;
+}
+
+}
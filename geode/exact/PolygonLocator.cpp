@@ -0,0 +1,210 @@
+// Batched winding number queries against planar polygons
+
+#include <geode/exact/PolygonLocator.h>
+#include <geode/exact/predicates.h>
+#include <geode/exact/scope.h>
+#include <geode/array/amap.h>
+#include <geode/math/integer_log.h>
+#include <geode/python/Class.h>
+#include <geode/utility/openmp.h>
+#include <vector>
+namespace geode {
+
+typedef real T;
+typedef Vector<T,2> TV;
+using exact::Vec2;
+using exact::Perturbed2;
+
+GEODE_DEFINE_TYPE(PolygonLocator)
+
+// Leaves with at most this many edges are not split further
+static const int leaf_size = 8;
+
+PolygonLocator::PolygonLocator(Nested<const TV> polys)
+  : quant(bounding_box(polys)) {
+  build(amap(quant,polys));
+}
+
+PolygonLocator::PolygonLocator(Nested<const Vec2> polys, const Quantizer<T,2>& quant)
+  : quant(quant) {
+  build(polys);
+}
+
+PolygonLocator::~PolygonLocator() {}
+
+// Conservatively decide whether the segment a,b touches the closed box.  The line test is done in floating point
+// with an error margin, so it may keep a few edges that only pass near the box.
+static bool overlaps(const Box<Vec2>& box, const Vec2 a, const Vec2 b) {
+  if (   max(a.x,b.x)<box.min.x || box.max.x<min(a.x,b.x)
+      || max(a.y,b.y)<box.min.y || box.max.y<min(a.y,b.y))
+    return false;
+  const auto d = b-a;
+  bool below = false, above = false;
+  for (const int i : range(4)) {
+    const auto c = Vec2(i&1 ? box.max.x : box.min.x,
+                        i&2 ? box.max.y : box.min.y)-a;
+    const auto x = d.x*c.y, y = d.y*c.x,
+               error = T(1e-15)*(abs(x)+abs(y));
+    below |= x-y < error;
+    above |= x-y > -error;
+  }
+  return below && above;
+}
+
+void PolygonLocator::build(Nested<const Vec2> polys) {
+  // Perturbation seeds: vertices use their flat index, queries share X.size(), the point outside the box uses
+  // X.size()+1, and node centers follow
+  X.preallocate(polys.flat.size());
+  for (const int i : range(polys.flat.size()))
+    X.append_assuming_enough_space(Perturbed2(i,polys.flat[i]));
+  for (const int p : range(polys.size())) {
+    const int lo = polys.offsets[p],
+              n = polys.size(p);
+    for (const int i : range(n))
+      if (n>1)
+        edges.append(vec(lo+i,lo+(i+1)%n));
+  }
+  box = bounding_box(polys.flat);
+  if (!edges.size())
+    return;
+
+  // Build the tree depth first.  Each node's edges are those overlapping its closed box, and the winding number of
+  // each center is found by walking from the center of its parent.
+  IntervalScope scope;
+  const int max_depth = 8+2*integer_log(uint32_t(edges.size()));
+  struct Pending {
+    int node, depth;
+    Box<Vec2> box;
+    Array<const int> edges;
+  };
+  const auto center = [](const Box<Vec2>& box) {
+    return Vec2(box.min.x+floor(.5*(box.max.x-box.min.x)),
+                box.min.y+floor(.5*(box.max.y-box.min.y)));
+  };
+  Node root;
+  root.center = center(box);
+  root.child = -1;
+  {
+    const auto outside = Vec2(box.max.x+1,root.center.y);
+    const auto all = arange(edges.size()).copy();
+    nodes.append(root);
+    nodes[0].winding = crossings(X.size()+1,outside,Perturbed2(X.size()+2,root.center),all);
+  }
+  std::vector<Pending> stack(1,Pending{0,0,box,arange(edges.size()).copy()});
+  while (stack.size()) {
+    const auto p = stack.back();
+    stack.pop_back();
+    const auto sizes = p.box.sizes();
+    const int axis = sizes.argmax();
+    if (p.edges.size()<=leaf_size || p.depth>=max_depth || sizes[axis]<2) {
+      nodes[p.node].edges = range(leaf_edges.size(),leaf_edges.size()+p.edges.size());
+      leaf_edges.extend(p.edges);
+      continue;
+    }
+    const auto parent = nodes[p.node];
+    const Quantized split = parent.center[axis];
+    const int child = nodes.size();
+    nodes[p.node].axis = axis;
+    nodes[p.node].split = split;
+    nodes[p.node].child = child;
+    for (const int c : range(2)) {
+      auto box = p.box;
+      (c ? box.min : box.max)[axis] = split;
+      Array<int> sub;
+      for (const int e : p.edges)
+        if (overlaps(box,X[edges[e].x].value(),X[edges[e].y].value()))
+          sub.append(e);
+      Node node;
+      node.center = center(box);
+      node.winding = parent.winding+crossings(X.size()+2+p.node,parent.center,
+                                              Perturbed2(X.size()+2+child+c,node.center),p.edges);
+      node.child = -1;
+      nodes.append(node);
+      stack.push_back(Pending{child+c,p.depth+1,box,sub});
+    }
+  }
+}
+
+// Signed number of edges crossed by the segment from c to x.  Crossing an edge from its right to its left adds one.
+int PolygonLocator::crossings(const int seed, const Vec2 c, const Perturbed2 x, RawArray<const int> edges) const {
+  const Perturbed2 cp(seed,c);
+  const auto y = x.value();
+  const auto lo = Vec2(min(c.x,y.x),min(c.y,y.y)),
+             hi = Vec2(max(c.x,y.x),max(c.y,y.y));
+  int winding = 0;
+  for (const int e : edges) {
+    const auto& a = X[this->edges[e].x];
+    const auto& b = X[this->edges[e].y];
+    const auto av = a.value(), bv = b.value();
+    if (   max(av.x,bv.x)<lo.x || hi.x<min(av.x,bv.x)
+        || max(av.y,bv.y)<lo.y || hi.y<min(av.y,bv.y))
+      continue;
+    const bool sc = triangle_oriented(a,b,cp),
+               sx = triangle_oriented(a,b,x);
+    if (sc!=sx && triangle_oriented(cp,x,a)!=triangle_oriented(cp,x,b))
+      winding += sx ? 1 : -1;
+  }
+  return winding;
+}
+
+// Find the leaf containing x, which must lie inside box
+int PolygonLocator::locate(const Vec2 x) const {
+  int n = 0;
+  while (nodes[n].child>=0)
+    n = nodes[n].child+(x[nodes[n].axis]>nodes[n].split);
+  return n;
+}
+
+int PolygonLocator::exact_winding(const Vec2 x) const {
+  if (!nodes.size() || !box.lazy_inside(x))
+    return 0;
+  IntervalScope scope;
+  const int n = locate(x);
+  const auto& node = nodes[n];
+  return node.winding+crossings(X.size()+2+n,node.center,Perturbed2(X.size(),x),leaf_edges.slice(node.edges));
+}
+
+int PolygonLocator::winding(const TV x) const {
+  return exact_winding(quant(x)); // Quantize outside of IntervalScope, which changes the rounding mode
+}
+
+template<class F> static Array<int> parallel_windings(const int n, const int threads, const F& winding) {
+  GEODE_ASSERT(threads>=0);
+  const Array<int> result(n,uninit);
+  const int nt = threads ? threads : omp_get_max_threads(),
+            runs = min(n,8*nt);
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int r=0;r<runs;r++)
+    for (const int i : partition_loop(n,runs,r))
+      result[i] = winding(i);
+  return result;
+}
+
+Array<int> PolygonLocator::exact_windings(RawArray<const Vec2> Y, const int threads) const {
+  return parallel_windings(Y.size(),threads,[=](const int i) { return exact_winding(Y[i]); });
+}
+
+Array<int> PolygonLocator::windings(RawArray<const TV> Y, const int threads) const {
+  return parallel_windings(Y.size(),threads,[=](const int i) { return exact_winding(quant(Y[i])); });
+}
+
+Array<bool> PolygonLocator::inside(RawArray<const TV> Y, const int threads) const {
+  const auto w = windings(Y,threads);
+  Array<bool> result(w.size(),uninit);
+  for (const int i : range(w.size()))
+    result[i] = w[i]>0;
+  return result;
+}
+
+}
+using namespace geode;
+
+void wrap_polygon_locator() {
+  typedef PolygonLocator Self;
+  Class<Self>("PolygonLocator")
+    .GEODE_INIT(Nested<const TV>)
+    .GEODE_METHOD(winding)
+    .GEODE_METHOD(windings)
+    .GEODE_METHOD(inside)
+    ;
+}
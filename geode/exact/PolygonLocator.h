@@ -0,0 +1,63 @@
+// Batched winding number queries against planar polygons
+#pragma once
+
+#include <geode/exact/config.h>
+#include <geode/exact/quantize.h>
+#include <geode/array/Nested.h>
+#include <geode/python/Object.h>
+#include <geode/utility/range.h>
+namespace geode {
+
+// Winding numbers of points with respect to a set of closed polygons, as in polygon_union and split_polygons.
+// The polygon edges are sorted into a kd-tree whose leaves hold a few edges each, and every node remembers the
+// winding number of its center.  A query descends to its leaf and counts the crossings of the segment from the leaf
+// center to the query point, so it costs O(log n) for reasonably distributed edges.  All decisions use exact
+// predicates with symbolic perturbation, so points on the boundary are classified consistently.
+class PolygonLocator : public Object {
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef real T;
+  typedef Vector<T,2> TV;
+
+  const Quantizer<T,2> quant;
+protected:
+  struct Node {
+    exact::Vec2 center;
+    int winding; // Winding number of center
+    int axis; // Split axis of internal nodes
+    Quantized split; // Points with x[axis] <= split go to the first child
+    int child; // First child if internal, or -1 for leaves
+    Range<int> edges; // Edges overlapping a leaf, as a range of leaf_edges
+  };
+
+  Array<exact::Perturbed2> X; // Quantized vertices
+  Array<Vector<int,2>> edges; // Indices into X
+  Box<exact::Vec2> box; // Bounding box of X
+  Array<Node> nodes;
+  Array<int> leaf_edges;
+
+  GEODE_CORE_EXPORT PolygonLocator(Nested<const TV> polys);
+
+  // Polygons which have already been quantized with quant
+  GEODE_CORE_EXPORT PolygonLocator(Nested<const exact::Vec2> polys, const Quantizer<T,2>& quant);
+public:
+  ~PolygonLocator();
+
+  // Winding number of a single point
+  GEODE_CORE_EXPORT int winding(const TV x) const;
+  GEODE_CORE_EXPORT int exact_winding(const exact::Vec2 x) const;
+
+  // Winding numbers of many points in parallel.  If threads is zero, all available threads are used.
+  GEODE_CORE_EXPORT Array<int> windings(RawArray<const TV> X, const int threads=0) const;
+  GEODE_CORE_EXPORT Array<int> exact_windings(RawArray<const exact::Vec2> X, const int threads=0) const;
+
+  // Whether points have positive winding number, in parallel
+  GEODE_CORE_EXPORT Array<bool> inside(RawArray<const TV> X, const int threads=0) const;
+
+private:
+  void build(Nested<const exact::Vec2> polys);
+  int crossings(const int seed, const exact::Vec2 c, const exact::Perturbed2 x, RawArray<const int> edges) const;
+  int locate(const exact::Vec2 x) const;
+};
+
+}
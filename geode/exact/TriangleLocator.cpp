@@ -0,0 +1,206 @@
+// Batched point location in planar triangle meshes
+
+#include <geode/exact/TriangleLocator.h>
+#include <geode/exact/predicates.h>
+#include <geode/exact/scope.h>
+#include <geode/geometry/Triangle2d.h>
+#include <geode/math/clamp.h>
+#include <geode/python/Class.h>
+#include <geode/python/ExceptionValue.h>
+#include <geode/structure/Tuple.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
+namespace geode {
+
+typedef real T;
+typedef Vector<T,2> TV;
+using exact::Perturbed2;
+
+GEODE_DEFINE_TYPE(TriangleLocator)
+
+TriangleLocator::TriangleLocator(const TriangleTopology& mesh, Array<const TV> X)
+  : mesh(ref(mesh))
+  , X(X)
+  , box(bounding_box(X))
+  , quant(box)
+  , inv_sizes(T(1)/clamp_min(box.sizes(),max(T(1e-10)*box.sizes().max(),T(1e-6)))) {
+  GEODE_ASSERT(mesh.allocated_vertices()<=X.size());
+
+  // Quantize.  Query points all share the seed X.size(), since they are never compared against each other.
+  Xq = Field<Perturbed2,VertexId>(X.size(),uninit);
+  for (const int i : range(X.size()))
+    Xq.flat[i] = Perturbed2(i,quant(X[i]));
+
+  // Build a grid with about two faces per cell, each cell remembering a face whose centroid lies within it
+  const int target = max(1,mesh.n_faces()/2);
+  const T aspect = clamp(inv_sizes.y/inv_sizes.x,T(1)/target,T(target));
+  cells.x = clamp(int(sqrt(target*aspect)+.5),1,target);
+  cells.y = clamp(target/cells.x,1,target);
+  grid = Array<FaceId>(cells.x*cells.y);
+  for (const auto f : mesh.faces()) {
+    const auto v = mesh.vertices(f);
+    const auto c = (X[v.x.id]+X[v.y.id]+X[v.z.id])/3;
+    const auto i = clamp(Vector<int,2>(TV(cells)*((c-box.min)*inv_sizes)),Vector<int,2>(),cells-1);
+    grid[cells.y*i.x+i.y] = f;
+  }
+
+  // Fill empty cells with nearby faces
+  FaceId last;
+  for (auto& f : grid)
+    f = f.valid() ? (last = f) : last;
+  last = FaceId();
+  for (int i=grid.size()-1;i>=0;i--)
+    grid[i] = grid[i].valid() ? (last = grid[i]) : last;
+}
+
+TriangleLocator::~TriangleLocator() {}
+
+FaceId TriangleLocator::jump(const TV x) const {
+  const auto i = clamp(Vector<int,2>(TV(cells)*((x-box.min)*inv_sizes)),Vector<int,2>(),cells-1);
+  return grid[cells.y*i.x+i.y];
+}
+
+// Visibility walk from f to the face containing x.  The order of edge tests is randomized with a cheap xorshift
+// generator, which guarantees termination even for non-Delaunay meshes.  See
+//
+//   Olivier Devillers, Sylvain Pion, Monique Teillaud, "Walking in a triangulation".
+//
+FaceId TriangleLocator::walk(const Perturbed2 x, FaceId f) const {
+  if (!f.valid())
+    return f;
+  uint32_t state = 2463534242u;
+  HalfedgeId e; // The edge we entered f through
+  for (;;) {
+    state ^= state<<13;
+    state ^= state>>17;
+    state ^= state<<5;
+    const int start = state%3;
+    for (const int i : range(3)) {
+      const auto h = mesh->halfedge(f,(start+i)%3);
+      if (h!=e && !triangle_oriented(Xq[mesh->src(h)],Xq[mesh->dst(h)],x)) {
+        // Since the mesh is convex, leaving through the boundary means x is outside
+        e = mesh->reverse(h);
+        if (mesh->is_boundary(e))
+          return FaceId();
+        f = mesh->face(e);
+        goto next;
+      }
+    }
+    return f;
+    next:;
+  }
+}
+
+FaceId TriangleLocator::face(const TV x, const FaceId start) const {
+  if (!box.lazy_inside(x))
+    return FaceId();
+  IntervalScope scope;
+  return walk(Perturbed2(Xq.size(),quant(x)),mesh->valid(start) ? start : jump(x));
+}
+
+FaceId TriangleLocator::face_py(const TV x) const {
+  return face(x);
+}
+
+Vector<T,3> TriangleLocator::weights(const FaceId f, const TV x) const {
+  const auto v = mesh->vertices(f);
+  const Vector<TV,3> P(X[v.x],X[v.y],X[v.z]);
+  const Vector<T,3> lengths(sqr_magnitude(P.z-P.y),sqr_magnitude(P.x-P.z),sqr_magnitude(P.y-P.x));
+  const int i = lengths.argmax();
+  if (abs(cross(P.y-P.x,P.z-P.x)) > numeric_limits<T>::epsilon()*lengths[i])
+    return Triangle<TV>::barycentric_coordinates(x,P.x,P.y,P.z);
+
+  // Degenerate face: interpolate along the longest edge, which is opposite vertex i
+  const int a = (i+1)%3, b = (i+2)%3;
+  const T t = lengths[i] ? clamp(dot(x-P[a],P[b]-P[a])/lengths[i],T(0),T(1)) : 0;
+  Vector<T,3> w;
+  w[a] = 1-t;
+  w[b] = t;
+  return w;
+}
+
+// Locate a run of queries in sorted order, starting each walk from the previous answer
+void TriangleLocator::locate_sorted(RawArray<const TV> Y, RawArray<const Tuple<uint64_t,int>> order,
+                                    RawArray<FaceId> faces, RawArray<Vector<T,3>> weights) const {
+  IntervalScope scope;
+  FaceId f;
+  for (const auto& o : order) {
+    const int i = o.y;
+    const auto y = Y[i];
+    if (box.lazy_inside(y)) {
+      const auto g = walk(Perturbed2(Xq.size(),quant(y)),f.valid() ? f : jump(y));
+      if (g.valid()) {
+        faces[i] = f = g;
+        weights[i] = this->weights(g,y);
+        continue;
+      }
+    }
+    faces[i] = FaceId();
+    weights[i] = Vector<T,3>();
+  }
+}
+
+// Interleave the bits of a 32 bit integer with zeros
+static inline uint64_t spread_bits(uint64_t x) {
+  x = (x|x<<16)&0x0000ffff0000ffffu;
+  x = (x|x<< 8)&0x00ff00ff00ff00ffu;
+  x = (x|x<< 4)&0x0f0f0f0f0f0f0f0fu;
+  x = (x|x<< 2)&0x3333333333333333u;
+  x = (x|x<< 1)&0x5555555555555555u;
+  return x;
+}
+
+Tuple<Array<FaceId>,Array<Vector<T,3>>> TriangleLocator::locate(RawArray<const TV> Y, const int threads) const {
+  GEODE_ASSERT(threads>=0);
+  const int n = Y.size();
+
+  // Sort queries along a Morton curve
+  Array<Tuple<uint64_t,int>> order(n,uninit);
+  for (const int i : range(n)) {
+    const auto u = clamp((Y[i]-box.min)*inv_sizes,TV(),TV(1,1));
+    order[i] = tuple(spread_bits(uint32_t(u.x*T(~uint32_t(0))))<<1 | spread_bits(uint32_t(u.y*T(~uint32_t(0)))),i);
+  }
+  std::sort(order.begin(),order.end(),[](const Tuple<uint64_t,int>& a, const Tuple<uint64_t,int>& b) {
+    return a.x<b.x;
+  });
+
+  // Walk through contiguous runs in parallel.  Use several runs per thread for load balancing.
+  const Array<FaceId> faces(n,uninit);
+  const Array<Vector<T,3>> weights(n,uninit);
+  const int nt = threads ? threads : omp_get_max_threads(),
+            runs = min(n,8*nt);
+  // Exceptions can't escape OpenMP regions, so we stash the first
+  ExceptionValue error;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int r=0;r<runs;r++) {
+    try {
+      const auto range = partition_loop(n,runs,r);
+      locate_sorted(Y,order.slice(range.lo,range.hi),faces,weights);
+    } catch (const std::exception& e) {
+      #pragma omp critical
+      {
+        if (!error)
+          error = ExceptionValue(e);
+      }
+    }
+  }
+  if (error)
+    error.throw_();
+  return tuple(faces,weights);
+}
+
+}
+using namespace geode;
+
+void wrap_triangle_locator() {
+  typedef TriangleLocator Self;
+  Class<Self>("TriangleLocator")
+    .GEODE_INIT(const TriangleTopology&,Array<const TV>)
+    .GEODE_FIELD(mesh)
+    .GEODE_FIELD(X)
+    .GEODE_FIELD(box)
+    .GEODE_METHOD_2("face",face_py)
+    .GEODE_METHOD(weights)
+    .GEODE_METHOD(locate)
+    ;
+}
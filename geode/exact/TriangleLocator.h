@@ -0,0 +1,55 @@
+// Batched point location in planar triangle meshes
+#pragma once
+
+#include <geode/exact/config.h>
+#include <geode/exact/quantize.h>
+#include <geode/mesh/TriangleTopology.h>
+namespace geode {
+
+// Locate points in a planar triangle mesh whose faces cover a convex region, such as the output of delaunay_points.
+// Point location uses exact predicates with symbolic perturbation, so every point inside the mesh lands in exactly one
+// face, even if it lies on an edge or vertex.  Each query jumps to a nearby face using a coarse uniform grid, then
+// walks through the mesh to the containing face.  Batch queries are sorted along a Morton curve so that consecutive
+// walks are short, and are answered in parallel.
+class TriangleLocator : public Object {
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef real T;
+  typedef Vector<T,2> TV;
+
+  const Ref<const TriangleTopology> mesh;
+  const Field<const TV,VertexId> X;
+  const Box<TV> box; // Bounding box of X
+protected:
+  const Quantizer<T,2> quant;
+  const TV inv_sizes; // 1/box.sizes(), with degenerate dimensions clamped so that collinear or coincident X are safe
+  Field<exact::Perturbed2,VertexId> Xq; // Quantized positions
+  Vector<int,2> cells; // Grid resolution
+  Array<FaceId> grid; // A face near each grid cell, row major
+
+  GEODE_CORE_EXPORT TriangleLocator(const TriangleTopology& mesh, Array<const TV> X);
+public:
+  ~TriangleLocator();
+
+  // Find the face containing x, starting the walk at the given face if it is valid.  Returns an invalid face if x is
+  // outside the mesh.  For a walk starting from the previous answer, the cost is proportional to the distance moved.
+  GEODE_CORE_EXPORT FaceId face(const TV x, FaceId start=FaceId()) const;
+  GEODE_CORE_EXPORT FaceId face_py(const TV x) const; // Python can't see default arguments
+
+
+  // Barycentric coordinates of x with respect to mesh->vertices(f).  For zero area faces, x is projected onto the
+  // longest edge and interpolated between its endpoints, so the weights are always finite, nonnegative, and sum to one.
+  GEODE_CORE_EXPORT Vector<T,3> weights(const FaceId f, const TV x) const;
+
+  // Locate many points in parallel, returning containing faces (invalid if outside) and barycentric coordinates (zero
+  // if outside).  If threads is zero, all available threads are used.
+  GEODE_CORE_EXPORT Tuple<Array<FaceId>,Array<Vector<T,3>>> locate(RawArray<const TV> X, const int threads=0) const;
+
+private:
+  FaceId jump(const TV x) const;
+  FaceId walk(const exact::Perturbed2 x, FaceId f) const;
+  void locate_sorted(RawArray<const TV> X, RawArray<const Tuple<uint64_t,int>> order,
+                     RawArray<FaceId> faces, RawArray<Vector<T,3>> weights) const;
+};
+
+}
@@ -14,8 +14,11 @@ else:
 if not has_exact():
   raise ImportError('geode/exact is unavailable since geode was compiled without gmp support')
 
-def delaunay_points(X,edges=zeros((0,2),dtype=int32),validate=False):
-  return delaunay_points_py(X,edges,validate)
+def delaunay_points(X,edges=zeros((0,2),dtype=int32),validate=False,threads=1):
+  return delaunay_points_py(X,edges,validate,threads)
+
+def delaunay_points_3d(X,validate=False):
+  return delaunay_points_3d_py(X,validate)
 
 def polygon_union(*polys):
   '''The union of possibly intersecting polygons, assuming consistent ordering'''
@@ -49,19 +52,30 @@ def circle_arc_intersection(*arcs):
   split = split_circle_arcs if all_arcs.flat.dtype==CircleArc else exact_split_circle_arcs
   return split(all_arcs,len(arcs)-1)
 
-def split_soup(mesh,X,depth=0):
-  '''If depth is None, extract nonmanifold mesh with triangles at all depths'''
+def parallel_polygon_union(polys,threads=0):
+  '''Union many polygons in parallel.  Holes must immediately follow the contour containing them.'''
+  return geode_wrap.parallel_polygon_union(polys,threads)
+
+def parallel_circle_arc_union(arcs,threads=0):
+  '''Union many circular arc polygons in parallel.  Holes must immediately follow the contour containing them.'''
+  return geode_wrap.parallel_circle_arc_union(arcs,threads)
+
+def split_soup(mesh,X,depth=0,threads=1,approximate_depths=False):
+  '''If depth is None, extract nonmanifold mesh with triangles at all depths.
+  threads=0 uses all available threads; the result does not depend on threads.
+  approximate_depths=True estimates ray depths with fast winding numbers, which is faster for many components
+  but not certified.'''
   if depth is None:
     depth = -1<<31
-  return geode_wrap.split_soup(mesh,X,depth)
+  return geode_wrap.split_soup(mesh,X,depth,threads,approximate_depths)
 
-def split_soup_with_weight(mesh,X,weight,depth=0):
+def split_soup_with_weight(mesh,X,weight,depth=0,threads=1,approximate_depths=False):
   if depth is None:
     depth = -1<<31
-  return geode_wrap.split_soup_with_weight(mesh,X,weight,depth)
+  return geode_wrap.split_soup_with_weight(mesh,X,weight,depth,threads,approximate_depths)
 
-def split_soups(meshes,depth=0):
-  return split_soup(*merge_meshes(meshes),depth=depth)
+def split_soups(meshes,depth=0,threads=1,approximate_depths=False):
+  return split_soup(*merge_meshes(meshes),depth=depth,threads=threads,approximate_depths=approximate_depths)
 
 def soup_union(*meshes):
   return split_soups(meshes,depth=0)
@@ -69,6 +83,16 @@ def soup_union(*meshes):
 def soup_intersection(*meshes):
   return split_soups(meshes,depth=len(meshes)-1)
 
+def closed_soup_union(a,b,threads=1):
+  '''Union of two closed (mesh,X) soups, each free of self intersections.  Only the overlap is retriangulated.'''
+  return soup_union_py(a[0],a[1],b[0],b[1],threads)
+
+def closed_soup_intersection(a,b,threads=1):
+  return soup_intersection_py(a[0],a[1],b[0],b[1],threads)
+
+def closed_soup_difference(a,b,threads=1):
+  return soup_difference_py(a[0],a[1],b[0],b[1],threads)
+
 def split_mesh_with_weight(mesh, weights, depth=0):
   return meshify(*split_soup_with_weight(mesh.face_soup()[0], mesh.vertex_field(vertex_position_id), weights, depth))
 
@@ -7,6 +7,7 @@
 #include <geode/exact/circle_csg.h>
 #include <geode/exact/circle_offsets.h>
 #include <geode/exact/circle_quantization.h>
+#include <geode/exact/hierarchical_union.h>
 #include <geode/exact/scope.h>
 #include <geode/exact/Exact.h>
 #include <geode/exact/math.h>
@@ -16,6 +17,7 @@
 #include <geode/geometry/BoxTree.h>
 #include <geode/geometry/polygon.h>
 #include <geode/geometry/traverse.h>
+#include <geode/math/constants.h>
 #include <geode/python/stl.h>
 #include <geode/python/wrap.h>
 #include <geode/random/Random.h>
@@ -67,6 +69,13 @@ Nested<CircleArc> split_arcs_by_parity(Nested<const CircleArc> arcs) {
   return result;
 }
 
+Nested<CircleArc> parallel_circle_arc_union(Nested<const CircleArc> arcs, const int threads) {
+  return hierarchical_union(arcs,threads,
+    [](RawArray<const CircleArc> a) { return circle_arc_area(a); },
+    [](RawArray<const CircleArc> a) { return approximate_bounding_box(a); },
+    [](Nested<const CircleArc> a) { return split_circle_arcs(a,0); });
+}
+
 ostream& operator<<(ostream& output, const CircleArc& arc) {
   return output << format("CircleArc([%g,%g],%g)",arc.x.x,arc.x.y,arc.q);
 }
@@ -152,6 +161,289 @@ Nested<CircleArc> canonicalize_circle_arcs(Nested<const CircleArc> polys) {
   return new_polys;
 }
 
+namespace {
+typedef Vector<Quantized,2> QV;
+
+// Is x within tolerance of the circle?  Everything is an integer, so this is exact.
+bool near_circle(const QV center, const Quantized radius, const QV x, const Quantized tolerance) {
+  const auto d2 = esqr_magnitude(Vector<Exact<1>,2>(x)-Vector<Exact<1>,2>(center));
+  return sqr(Exact<1>(max(radius-tolerance,Quantized(0)))) <= d2 && d2 <= sqr(Exact<1>(radius+tolerance));
+}
+
+struct ArcSimplifier {
+  const Quantizer<real,2>& quant;
+  const Quantized tolerance;
+  RawArray<const CircleArc> arcs; // Closed contour with tiny arcs already removed
+
+  // Quantized midpoint of arc i
+  QV midpoint(const int i) const {
+    const auto x0 = arcs[i].x, x1 = arcs[(i+1)%arcs.size()].x;
+    return quant(.5*((x0+x1)+arcs[i].q*rotate_right_90(x1-x0)));
+  }
+
+  // Can arcs [s,s+count) be replaced by a single arc?  If so, return its q.
+  Tuple<bool,real> merge(const int s, const int count) const {
+    const int n = arcs.size();
+    if (count<2 || count>=n)
+      return tuple(count==1,count==1?arcs[s].q:0);
+    // Take curvature from the longest arc, and the angle of the merged arc from its chord.  The angles
+    // 4*atan(q) of the individual arcs only pick between the short and long way around.
+    real estimate = 0, longest = -1, curvature = 0;
+    for (int k=0;k<count;k++) {
+      const int i = (s+k)%n;
+      const real q = arcs[i].q,
+                 chord = magnitude(arcs[(i+1)%n].x-arcs[i].x);
+      estimate += 4*atan(q);
+      if (longest<chord) {
+        longest = chord;
+        curvature = 4*q/((1+sqr(q))*chord);
+      }
+    }
+    const real half_sin = .5*curvature*magnitude(arcs[(s+count)%n].x-arcs[s].x);
+    if (abs(half_sin)>1 || abs(estimate)>1.9*pi)
+      return tuple(false,real(0));
+    real angle = 2*asin(half_sin);
+    if (abs(estimate)>pi)
+      angle = (curvature>0?2*pi:-2*pi)-angle;
+    const real q = tan(angle/4);
+    // Construct the exact circle the merged arc will be quantized to, and check that every replaced
+    // vertex and arc midpoint is within tolerance of it.
+    const auto c = construct_circle_center_and_radius(quant(arcs[s].x),quant(arcs[(s+count)%n].x),q);
+    if (!c.y)
+      return tuple(false,real(0));
+    for (int k=0;k<count;k++) {
+      const int i = (s+k)%n;
+      if (   (k && !near_circle(c.x,c.y,quant(arcs[i].x),tolerance))
+          || !near_circle(c.x,c.y,midpoint(i),tolerance))
+        return tuple(false,real(0));
+    }
+    return tuple(true,q);
+  }
+};
+
+// An output arc replacing arcs [start,start+len) of contour poly.  Arcs with len 1 are left unchanged.
+struct SimplifiedArc {
+  int poly, start, len;
+  real q;
+  bool rejected;
+};
+
+// Replace a rejected arc by its two halves, merging each again if possible
+void split_simplified_arc(const ArcSimplifier& simplifier, const SimplifiedArc& s, Array<SimplifiedArc>& pieces) {
+  const int half = s.len/2;
+  for (const auto r : vec(vec(s.start,half),vec((s.start+half)%simplifier.arcs.size(),s.len-half))) {
+    const auto merged = simplifier.merge(r.x,r.y);
+    const SimplifiedArc h = {s.poly,r.x,r.y,merged.y,false};
+    if (merged.x)
+      pieces.append(h);
+    else
+      split_simplified_arc(simplifier,h,pieces);
+  }
+}
+
+// A quantized arc, trimmed to the helper circles around its endpoints (as in quantize_circle_arcs) so that arcs
+// sharing a vertex only intersect near it.
+struct TrimmedArc {
+  ExactArc<Pb::Implicit> arc;
+  QV x0, x1;
+  int piece; // Index of the SimplifiedArc if this arc is new, otherwise -1
+  int poly, start, end; // Original vertices joined by this arc
+
+  bool init(const QV x0_, const QV x1_, const real q) {
+    const auto PS = Pb::Implicit;
+    x0 = x0_;
+    x1 = x1_;
+    const ExactCircle<PS> h0(x0,constructed_arc_endpoint_error_bound()),
+                          h1(x1,constructed_arc_endpoint_error_bound());
+    if (x0==x1 || circles_overlap(h0,h1))
+      return false; // Too small to cross anything that its neighbors don't
+    const auto c = construct_circle_center_and_radius(x0,x1,q);
+    arc.circle = ExactCircle<PS>(c.x,c.y);
+    arc.src = q>=0 ? arc.circle.intersection_max(h0) : arc.circle.intersection_max(h1);
+    arc.dst = q>=0 ? arc.circle.intersection_min(h1) : arc.circle.intersection_min(h0);
+    return true;
+  }
+};
+
+// Find new arcs that cross any other arc.  Arcs meeting at a vertex may each be off by up to tolerance there, so
+// their intersections within tolerance of that vertex are allowed.
+struct CrossingVisitor {
+  const BoxTree<QV>& tree;
+  RawArray<const TrimmedArc> arcs;
+  const Quantized near;
+  RawArray<SimplifiedArc> pieces;
+  bool found;
+
+  bool cull(const int n) const { return false; }
+  bool cull(const int n0, const int n1) const { return false; }
+  void leaf(const int n) const { assert(tree.prims(n).size()==1); }
+
+  void leaf(const int n0, const int n1) {
+    const auto& a = arcs[tree.prims(n0)[0]];
+    const auto& b = arcs[tree.prims(n1)[0]];
+    if (   (a.piece<0 || pieces[a.piece].rejected)
+        && (b.piece<0 || pieces[b.piece].rejected))
+      return; // Only new arcs can be rejected
+    if (!crosses(a,b))
+      return;
+    for (const int p : vec(a.piece,b.piece))
+      if (p>=0 && !pieces[p].rejected)
+        pieces[p].rejected = found = true;
+  }
+
+  bool crosses(const TrimmedArc& a, const TrimmedArc& b) const {
+    const auto PS = Pb::Implicit;
+    if (is_same_circle(a.arc.circle,b.arc.circle))
+      return arcs_overlap(a.arc,b.arc);
+    const bool ab = a.poly==b.poly && a.end==b.start,
+               ba = a.poly==b.poly && b.end==a.start;
+    for (const auto& i : intersections_if_any(a.arc,b.arc))
+      if (   !(ab && i.is_inside(ExactCircle<PS>(a.x1,near)))
+          && !(ba && i.is_inside(ExactCircle<PS>(b.x1,near))))
+        return true;
+    return false;
+  }
+};
+}
+
+Nested<CircleArc> simplify_circle_arcs(Nested<const CircleArc> arcs, const real tolerance) {
+  GEODE_ASSERT(tolerance>=0);
+  const auto quant = make_arc_quantizer(approximate_bounding_box(arcs));
+  const Quantized qtolerance = quant.quantize_length(tolerance);
+  const auto tiny = [=](const CircleArc a, const Vec2 x1) {
+    const real chord = magnitude(x1-a.x);
+    return chord<tolerance && .5*abs(a.q)*chord<tolerance;
+  };
+
+  Array<SimplifiedArc> pieces;
+  Array<CircleArc> kept;
+  Array<int> starts; // Index in poly of the first vertex of each kept arc
+  Array<Vector<int,2>> runs; // Start and size of each run of merged arcs
+  for (const int p : range(arcs.size())) {
+    const auto poly = arcs[p];
+    const int n = poly.size();
+    if (!n)
+      continue;
+
+    // Drop tiny arcs by removing their ending vertex, so that the next arc starts a bit earlier
+    kept.clear();
+    starts.clear();
+    kept.append(poly[0]);
+    starts.append(0);
+    for (int i=1;i<n;i++) {
+      if (tiny(kept.back(),poly[i].x))
+        kept.back().q = poly[i].q;
+      else {
+        kept.append(poly[i]);
+        starts.append(i);
+      }
+    }
+    if (kept.size()>2 && tiny(kept.back(),kept[0].x)) {
+      kept[0].x = kept.back().x;
+      starts[0] = starts.back();
+      kept.pop();
+      starts.pop();
+    }
+    if (kept.size()<2) {
+      // Everything was tiny.  Drop the whole contour if it's degenerate, otherwise leave it alone.
+      if (approximate_bounding_box(poly).sizes().max()>=2*tolerance)
+        for (const int i : range(n))
+          pieces.append(SimplifiedArc({p,i,1,poly[i].q,false}));
+      continue;
+    }
+
+    // Greedily merge runs of arcs lying on nearly the same circle
+    const ArcSimplifier simplifier = {quant,qtolerance,kept};
+    const int m = kept.size();
+    Array<real> qs;
+    runs.clear();
+    for (int s=0;s<m;) {
+      int count = 1;
+      real q = kept[s].q;
+      for (;s+count<m;count++) {
+        const auto merged = simplifier.merge(s,count+1);
+        if (!merged.x)
+          break;
+        q = merged.y;
+      }
+      runs.append(vec(s,count));
+      qs.append(q);
+      s += count;
+    }
+    // The last run may continue into the first
+    if (runs.size()>2) {
+      const auto merged = simplifier.merge(runs.back().x,runs.back().y+runs[0].y);
+      if (merged.x) {
+        runs[0] = vec(runs.back().x,runs.back().y+runs[0].y);
+        qs[0] = merged.y;
+        runs.pop();
+        qs.pop();
+      }
+    }
+    for (const int r : range(runs.size())) {
+      const int start = starts[runs[r].x],
+                len = (starts[(runs[r].x+runs[r].y)%m]-start+n-1)%n+1;
+      pieces.append(SimplifiedArc({p,start,len,qs[r],false}));
+    }
+  }
+
+  // Moving arcs by up to tolerance could make a contour cross itself or a nearby contour.  Rather than resolving
+  // crossings with another union, which could merge or split contours, we check every merged arc exactly against
+  // all other arcs and split any that cross, down to the original arcs if necessary.  The new pieces can cross
+  // other merged arcs, so we repeat until nothing more is rejected.
+  {
+    IntervalScope scope;
+    Array<TrimmedArc> trimmed;
+    Array<Box<QV>> boxes;
+    Array<SimplifiedArc> next;
+    for (;;) {
+      trimmed.clear();
+      boxes.clear();
+      const auto add = [&](const int poly, const int start, const int len, const real q, const int piece) {
+        const auto contour = arcs[poly];
+        const int end = (start+len)%contour.size();
+        TrimmedArc t;
+        if (!t.init(quant(contour[start].x),quant(contour[end].x),q))
+          return;
+        t.piece = piece;
+        t.poly = poly;
+        t.start = start;
+        t.end = end;
+        trimmed.append(t);
+        boxes.append(bounding_box(t.arc));
+      };
+      for (const int p : range(pieces.size())) {
+        const auto& s = pieces[p];
+        add(s.poly,s.start,s.len,s.q,s.len>1 ? p : -1);
+      }
+      if (trimmed.size()<2)
+        break;
+      const auto tree = new_<BoxTree<QV>>(boxes,1);
+      CrossingVisitor visitor = {*tree,trimmed,constructed_arc_endpoint_error_bound()+qtolerance,pieces,false};
+      double_traverse(*tree,visitor);
+      if (!visitor.found)
+        break;
+      next.clear();
+      for (const auto& s : pieces) {
+        if (!s.rejected)
+          next.append(s);
+        else
+          split_simplified_arc(ArcSimplifier({quant,qtolerance,arcs[s.poly]}),s,next);
+      }
+      swap(pieces,next);
+    }
+  }
+
+  Nested<CircleArc,false> result;
+  for (int p=0;p<pieces.size();) {
+    const int poly = pieces[p].poly;
+    result.append_empty();
+    for (;p<pieces.size() && pieces[p].poly==poly;p++)
+      result.append_to_back(CircleArc(arcs(poly,pieces[p].start).x,pieces[p].q));
+  }
+  return result.freeze();
+}
+
 #ifdef GEODE_PYTHON
 
 // Instantiate Python conversions for arrays of circular arcs
@@ -256,7 +548,9 @@ using namespace geode;
 void wrap_circle_csg() {
   GEODE_FUNCTION(split_circle_arcs)
   GEODE_FUNCTION(split_arcs_by_parity)
+  GEODE_FUNCTION(parallel_circle_arc_union)
   GEODE_FUNCTION(canonicalize_circle_arcs)
+  GEODE_FUNCTION(simplify_circle_arcs)
   GEODE_FUNCTION_2(circle_arc_area,static_cast<real(*)(Nested<const CircleArc>)>(circle_arc_area))
   GEODE_FUNCTION(circle_arc_length)
   GEODE_FUNCTION(offset_arcs)
@@ -48,6 +48,16 @@ template<class... Arcs> static inline Nested<CircleArc> circle_arc_intersection(
   return split_circle_arcs(concatenate(arcs...),sizeof...(Arcs)-1);
 }
 
+// Union many circular arc polygons in parallel, grouping and merging as in parallel_polygon_union.
+GEODE_CORE_EXPORT Nested<CircleArc> parallel_circle_arc_union(Nested<const CircleArc> arcs, const int threads);
+
+// Merge consecutive arcs that lie within tolerance of a single circle, and drop arcs shorter than tolerance.
+// Merges are verified exactly against the quantized circle of the merged arc, so every removed vertex and arc
+// midpoint stays within tolerance.  Merged arcs that would cross another arc (away from their shared vertices) are
+// split until they don't, so topology is preserved: contours are never merged or split, although contours smaller
+// than tolerance are dropped.  The input should be free of crossings, as produced by split_circle_arcs.
+GEODE_CORE_EXPORT Nested<CircleArc> simplify_circle_arcs(Nested<const CircleArc> arcs, const real tolerance);
+
 // Signed area of circular arc polygons
 GEODE_CORE_EXPORT real circle_arc_area(RawArray<const CircleArc> arcs);
 GEODE_CORE_EXPORT real circle_arc_area(Nested<const CircleArc> arcs);
@@ -8,7 +8,7 @@ namespace geode {
 // that should have resulted in a single arc. The exponential increase in number of arcs quickly cripples performance.
 // * Calling offset_arcs on the original input with different offsets is one workaround
 // * offset_shells preserves a higher precision representation that should avoid this issue
-// * If user has a way to simplify arc contours (not currently available in geode) between iterations this would avoid the issue
+// * Calling simplify_circle_arcs between iterations merges the nearly coincident arcs and avoids the issue
 Nested<CircleArc> offset_arcs(const Nested<const CircleArc> arcs, const real d);
 
 // Generate closed contours around area covered by a disk of radius d moving along open arcs
@@ -7,6 +7,8 @@
 #include <geode/array/amap.h>
 #include <geode/array/RawField.h>
 #include <geode/math/integer_log.h>
+#include <geode/python/Class.h>
+#include <geode/python/ExceptionValue.h>
 #include <geode/python/wrap.h>
 #include <geode/random/permute.h>
 #include <geode/random/Random.h>
@@ -14,10 +16,14 @@
 #include <geode/utility/curry.h>
 #include <geode/utility/interrupts.h>
 #include <geode/utility/Log.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
+#include <vector>
 namespace geode {
 
 using Log::cout;
 using std::endl;
+using std::vector;
 typedef Vector<real,2> TV;
 typedef Vector<Quantized,2> EV;
 using exact::Perturbed2;
@@ -113,6 +119,15 @@ GEODE_ALWAYS_INLINE static inline bool triangle_oriented(const RawField<const Pe
   return triangle_oriented_sentinels(x0,x1,x2);
 }
 
+// As above, but with a point not in X as the third vertex
+GEODE_ALWAYS_INLINE static inline bool triangle_oriented(const RawField<const Perturbed2,VertexId> X, VertexId v0, VertexId v1, const Perturbed2 x2) {
+  const auto x0 = X[v0],
+             x1 = X[v1];
+  if (maxabs(x0.value().x,x1.value().x,x2.value().x)!=bound)
+    return triangle_oriented(x0,x1,x2);
+  return triangle_oriented_sentinels(x0,x1,x2);
+}
+
 // Test whether an edge containing sentinels is Delaunay
 GEODE_COLD GEODE_PURE static inline bool is_delaunay_sentinels(Perturbed2 x0, Perturbed2 x1, Perturbed2 x2, Perturbed2 x3) {
   // Unfortunately, the sentinels need to be at infinity for purposes of Delaunay testing, and our SOS predicates
@@ -155,6 +170,26 @@ GEODE_ALWAYS_INLINE static inline bool is_delaunay(const TriangleTopology& mesh,
   return is_delaunay_sentinels(x0,x1,x2,x3);
 }
 
+// Restore the Delaunay property by flipping edges starting from those on the stack, leaving constrained edges alone.
+// Since halfedge ids change during edge flips in a corner mesh, stack entries include directed vertex pairs.
+static void delaunay_flips(MutableTriangleTopology& mesh, RawField<const Perturbed2,VertexId> X,
+                           const Hashtable<Vector<VertexId,2>>& constrained,
+                           Array<Tuple<HalfedgeId,Vector<VertexId,2>>>& stack) {
+  while (stack.size()) {
+    const auto evs = stack.pop();
+    auto e = mesh.valid(evs.x) && mesh.vertices(evs.x)==evs.y ? evs.x : mesh.halfedge(evs.y.x,evs.y.y);
+    if (   e.valid() && !is_delaunay(mesh,X,e)
+        && !(constrained.size() && constrained.contains(evs.y.sorted()))) {
+      // Locally non-Delaunay edges always have convex quadrilaterals, so the flip is safe
+      assert(mesh.is_flip_safe(e));
+      e = mesh.unsafe_flip_edge(e);
+      const auto r = mesh.reverse(e);
+      for (const auto h : vec(mesh.next(e),mesh.prev(e),mesh.next(r),mesh.prev(r)))
+        stack.append(tuple(h,mesh.vertices(h)));
+    }
+  }
+}
+
 static inline FaceId bsp_search(RawArray<const Node> bsp, RawField<const Perturbed2,VertexId> X, const VertexId v) {
   if (!bsp.size())
     return FaceId(0);
@@ -241,17 +276,6 @@ GEODE_COLD static void assert_delaunay(const char* prefix,
     }
 }
 
-GEODE_COLD static void assert_delaunay(const char* prefix,
-                                       const TriangleTopology& mesh, RawField<const EV,VertexId> X,
-                                       const Hashtable<Vector<VertexId,2>>& constrained=Tuple<>(),
-                                       const bool oriented_only=false,
-                                       const bool check_boundary=true) {
-  Field<Perturbed2,VertexId> Xp(X.size(),uninit);
-  for (const int i : range(X.size()))
-    Xp.flat[i] = Perturbed2(i,X.flat[i]);
-  assert_delaunay(prefix,mesh,Xp,constrained,oriented_only,check_boundary);
-}
-
 // This routine assumes the sentinel points have already been added, and processes points in order
 GEODE_NEVER_INLINE static Ref<MutableTriangleTopology> deterministic_exact_delaunay(RawField<const Perturbed2,VertexId> X, const bool validate) {
 
@@ -507,7 +531,7 @@ static void chew_fan(MutableTriangleTopology& parent_mesh, RawField<const Pertur
 
 // Retriangulate a cavity formed when a constraint edge is inserted, following Shewchuck and Brown.
 // The cavity is defined by a counterclockwise list of vertices v[0] to v[m-1] as in Shewchuck and Brown, Figure 5.
-static void cavity_delaunay(MutableTriangleTopology& parent_mesh, RawField<const EV,VertexId> X,
+static void cavity_delaunay(MutableTriangleTopology& parent_mesh, RawField<const Perturbed2,VertexId> X,
                             RawArray<const VertexId> cavity, Random& random) {
   // Since the algorithm generates meshes which may be inconsistent with the outer mesh, and the cavity
   // array may have duplicate vertices, we use a temporary mesh and then copy the triangles over when done.
@@ -517,7 +541,7 @@ static void cavity_delaunay(MutableTriangleTopology& parent_mesh, RawField<const
   const auto mesh = new_<MutableTriangleTopology>();
   Field<Perturbed2,VertexId> Xc(m,uninit);
   for (const int i : range(m))
-    Xc.flat[i] = Perturbed2(cavity[i].id,X[cavity[i]]);
+    Xc.flat[i] = X[cavity[i]];
   mesh->add_vertices(m);
   const auto xs = Xc.flat[0],
              xe = Xc.flat[m-1];
@@ -603,117 +627,124 @@ static void cavity_delaunay(MutableTriangleTopology& parent_mesh, RawField<const
   }
 }
 
-GEODE_NEVER_INLINE static void add_constraint_edges(MutableTriangleTopology& mesh, RawField<const EV,VertexId> X,
-                                                    RawArray<const Vector<int,2>> edges, const bool validate) {
-  if (!edges.size())
-    return;
-  IntervalScope scope;
-  Hashtable<Vector<VertexId,2>> constrained;
-  Array<VertexId> left_cavity, right_cavity; // List of vertices for both cavities
-  const auto random = new_<Random>(key+7);
-  for (int i=0;i<edges.size();i++) {
-    // Randomly choose an edge to ensure optimal time complexity
-    const auto edge = edges[int(random_permute(edges.size(),key+5,i))].sorted();
-    auto v0 = VertexId(edge.x),
-         v1 = VertexId(edge.y);
-    const auto vs = vec(v0,v1);
-    GEODE_ASSERT(mesh.valid(v0) && mesh.valid(v1));
+// Insert a single constraint edge, retriangulating the cavities on either side of it.  Sentinels are allowed.
+static void add_constraint_edge(MutableTriangleTopology& mesh, RawField<const Perturbed2,VertexId> X,
+                                Hashtable<Vector<VertexId,2>>& constrained, const Vector<VertexId,2> vs,
+                                Random& random, Array<VertexId>& left_cavity, Array<VertexId>& right_cavity) {
+  auto v0 = vs.x,
+       v1 = vs.y;
+  GEODE_ASSERT(mesh.valid(v0) && mesh.valid(v1));
 
+  {
+    // Check if the edge already exists in the triangulation.  To ensure optimal complexity,
+    // we loop around both vertices interleaved so that our time is O(min(degree(v0),degree(v1))).
+    const auto s0 = mesh.halfedge(v0),
+               s1 = mesh.halfedge(v1);
     {
-      // Check if the edge already exists in the triangulation.  To ensure optimal complexity,
-      // we loop around both vertices interleaved so that our time is O(min(degree(v0),degree(v1))).
-      const auto s0 = mesh.halfedge(v0),
-                 s1 = mesh.halfedge(v1);
-      {
-        auto e0 = s0,
-             e1 = s1;
-        do {
-          if (mesh.dst(e0)==v1 || mesh.dst(e1)==v0)
-            goto success; // The edge already exists, so there's nothing to be done.
-          e0 = mesh.left(e0);
-          e1 = mesh.left(e1);
-        } while (e0!=s0 && e1!=s1);
-      }
+      auto e0 = s0,
+           e1 = s1;
+      do {
+        if (mesh.dst(e0)==v1 || mesh.dst(e1)==v0)
+          goto success; // The edge already exists, so there's nothing to be done.
+        e0 = mesh.left(e0);
+        e1 = mesh.left(e1);
+      } while (e0!=s0 && e1!=s1);
+    }
 
-      // Find a triangle touching v0 or v1 containing part of the v0-v1 segment.
-      // As above, we loop around both vertices interleaved.
-      auto e0 = s0;
-      {
-        auto e1 = s1;
-        if (mesh.is_boundary(e0)) e0 = mesh.left(e0);
-        if (mesh.is_boundary(e1)) e1 = mesh.left(e1);
-        const auto x0 = Perturbed2(v0.id,X[v0]),
-                   x1 = Perturbed2(v1.id,X[v1]);
-        const auto e0d = mesh.dst(e0),
-                   e1d = mesh.dst(e1);
-        bool e0o = triangle_oriented(x0,Perturbed2(e0d.id,X[e0d]),x1),
-             e1o = triangle_oriented(x1,Perturbed2(e1d.id,X[e1d]),x0);
-        for (;;) { // No need to check for an end condition, since we're guaranteed to terminate
-          const auto n0 = mesh.left(e0),
-                     n1 = mesh.left(e1);
-          const auto n0d = mesh.dst(n0),
-                     n1d = mesh.dst(n1);
-          const bool n0o = triangle_oriented(x0,Perturbed2(n0d.id,X[n0d]),x1),
-                     n1o = triangle_oriented(x1,Perturbed2(n1d.id,X[n1d]),x0);
-          if (e0o && !n0o)
-            break;
-          if (e1o && !n1o) {
-            // Swap v0 with v1 and e0 with e1 so that our ray starts at v0
-            swap(v0,v1);
-            swap(e0,e1);
-            break;
-          }
-          e0 = n0;
-          e1 = n1;
-          e0o = n0o;
-          e1o = n1o;
+    // Find a triangle touching v0 or v1 containing part of the v0-v1 segment.
+    // As above, we loop around both vertices interleaved.
+    auto e0 = s0;
+    {
+      auto e1 = s1;
+      if (mesh.is_boundary(e0)) e0 = mesh.left(e0);
+      if (mesh.is_boundary(e1)) e1 = mesh.left(e1);
+      bool e0o = triangle_oriented(X,v0,mesh.dst(e0),v1),
+           e1o = triangle_oriented(X,v1,mesh.dst(e1),v0);
+      for (;;) { // No need to check for an end condition, since we're guaranteed to terminate
+        const auto n0 = mesh.left(e0),
+                   n1 = mesh.left(e1);
+        const bool n0o = triangle_oriented(X,v0,mesh.dst(n0),v1),
+                   n1o = triangle_oriented(X,v1,mesh.dst(n1),v0);
+        if (e0o && !n0o)
+          break;
+        if (e1o && !n1o) {
+          // Swap v0 with v1 and e0 with e1 so that our ray starts at v0
+          swap(v0,v1);
+          swap(e0,e1);
+          break;
         }
+        e0 = n0;
+        e1 = n1;
+        e0o = n0o;
+        e1o = n1o;
       }
+    }
 
-      // If we only need to walk one step, the retriangulation is a single edge flip
-      auto cut = mesh.reverse(mesh.next(e0));
-      if (mesh.dst(mesh.next(cut))==v1) {
-        if (constrained.contains(vec(mesh.src(cut),mesh.dst(cut)).sorted()))
-          throw ValueError(format("delaunay: Constraints (%d,%d) and (%d,%d) intersect",
-                                  v0.id,v1.id,mesh.src(cut).id,mesh.dst(cut).id));
-        cut = mesh.flip_edge(cut);
-        goto success;
-      }
+    // If we only need to walk one step, the retriangulation is a single edge flip
+    auto cut = mesh.reverse(mesh.next(e0));
+    if (mesh.dst(mesh.next(cut))==v1) {
+      if (constrained.contains(vec(mesh.src(cut),mesh.dst(cut)).sorted()))
+        throw ValueError(format("delaunay: Constraints (%d,%d) and (%d,%d) intersect",
+                                v0.id,v1.id,mesh.src(cut).id,mesh.dst(cut).id));
+      cut = mesh.flip_edge(cut);
+      goto success;
+    }
 
-      // Walk from v0 to v1, collecting the two cavities.
-      const auto x0 = Perturbed2(v0.id,X[v0]),
-                 x1 = Perturbed2(v1.id,X[v1]);
-      right_cavity.copy(vec(v0,mesh.dst(cut)));
-      left_cavity .copy(vec(v0,mesh.src(cut)));
-      mesh.erase(mesh.face(e0));
-      for (;;) {
-        if (constrained.contains(vec(mesh.src(cut),mesh.dst(cut)).sorted()))
+    // Walk from v0 to v1 once to check for intersecting constraints, so that we throw before changing anything
+    if (constrained.size())
+      for (auto c=cut;;) {
+        if (constrained.contains(vec(mesh.src(c),mesh.dst(c)).sorted()))
           throw ValueError(format("delaunay: Constraints (%d,%d) and (%d,%d) intersect",
-                                  v0.id,v1.id,mesh.src(cut).id,mesh.dst(cut).id));
-        const auto n = mesh.reverse(mesh.next(cut)),
-                   p = mesh.reverse(mesh.prev(cut));
-        const auto v = mesh.src(n);
-        mesh.erase(mesh.face(cut));
-        if (v == v1) {
-          left_cavity.append(v);
-          right_cavity.append(v);
+                                  v0.id,v1.id,mesh.src(c).id,mesh.dst(c).id));
+        const auto v = mesh.dst(mesh.next(c));
+        if (v == v1)
           break;
-        } else if (triangle_oriented(x0,x1,Perturbed2(v.id,X[v]))) {
-          left_cavity.append(v);
-          cut = n;
-        } else {
-          right_cavity.append(v);
-          cut = p;
-        }
+        c = mesh.reverse(triangle_oriented(X,v0,v1,v) ? mesh.next(c) : mesh.prev(c));
       }
 
-      // Retriangulate both cavities
-      left_cavity.reverse();
-      cavity_delaunay(mesh,X,left_cavity,random),
-      cavity_delaunay(mesh,X,right_cavity,random);
+    // Walk from v0 to v1 again, collecting the two cavities.
+    right_cavity.copy(vec(v0,mesh.dst(cut)));
+    left_cavity .copy(vec(v0,mesh.src(cut)));
+    mesh.erase(mesh.face(e0));
+    for (;;) {
+      const auto n = mesh.reverse(mesh.next(cut)),
+                 p = mesh.reverse(mesh.prev(cut));
+      const auto v = mesh.src(n);
+      mesh.erase(mesh.face(cut));
+      if (v == v1) {
+        left_cavity.append(v);
+        right_cavity.append(v);
+        break;
+      } else if (triangle_oriented(X,v0,v1,v)) {
+        left_cavity.append(v);
+        cut = n;
+      } else {
+        right_cavity.append(v);
+        cut = p;
+      }
     }
-    success:
-    constrained.set(vs);
+
+    // Retriangulate both cavities
+    left_cavity.reverse();
+    cavity_delaunay(mesh,X,left_cavity,random),
+    cavity_delaunay(mesh,X,right_cavity,random);
+  }
+  success:
+  constrained.set(vs);
+}
+
+GEODE_NEVER_INLINE static void add_constraint_edges(MutableTriangleTopology& mesh, RawField<const Perturbed2,VertexId> X,
+                                                    RawArray<const Vector<int,2>> edges, const bool validate) {
+  if (!edges.size())
+    return;
+  IntervalScope scope;
+  Hashtable<Vector<VertexId,2>> constrained;
+  Array<VertexId> left_cavity, right_cavity; // List of vertices for both cavities
+  const auto random = new_<Random>(key+7);
+  for (int i=0;i<edges.size();i++) {
+    // Randomly choose an edge to ensure optimal time complexity
+    const auto edge = edges[int(random_permute(edges.size(),key+5,i))].sorted();
+    add_constraint_edge(mesh,X,constrained,vec(VertexId(edge.x),VertexId(edge.y)),random,left_cavity,right_cavity);
   }
 
   // If desired, check that the final mesh is constrained Delaunay
@@ -764,8 +795,8 @@ static void spatial_sort(RawArray<Perturbed2> X, const int leaf_size, Random& ra
 }
 
 // Prepare a list of points for Delaunay triangulation: randomly assign into logarithmic bins, sort within bins, and add sentinels.
-// For details, see Amenta et al., Incremental Constructions con BRIO.
-static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
+// For details, see Amenta et al., Incremental Constructions con BRIO.  The sentinels are given seeds sentinel_seed+{0,1,2}.
+static Array<Perturbed2> partially_sorted_shuffle(RawArray<const Perturbed2> Xin, const int sentinel_seed) {
   const int n = Xin.size();
   Array<Perturbed2> X(n+3,uninit);
 
@@ -777,7 +808,7 @@ static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
     int j = (int)random_permute(n,key,i);
     const int bin = min(integer_log(j+1),bins-1);
     j = (1<<bin)-1+bin_counts[bin]++;
-    X[j] = Perturbed2(i,Xin[i]);
+    X[j] = Xin[i];
   }
 
   // Spatially sort each bin down to clusters of size 64.
@@ -790,37 +821,434 @@ static Array<Perturbed2> partially_sorted_shuffle(RawArray<const EV> Xin) {
   }
 
   // Add 3 sentinel points at infinity
-  X[n+0] = Perturbed2(n+0,EV(-bound,-bound));
-  X[n+1] = Perturbed2(n+1,EV( bound, 0)    );
-  X[n+2] = Perturbed2(n+2,EV(-bound, bound));
+  X[n+0] = Perturbed2(sentinel_seed+0,EV(-bound,-bound));
+  X[n+1] = Perturbed2(sentinel_seed+1,EV( bound, 0)    );
+  X[n+2] = Perturbed2(sentinel_seed+2,EV(-bound, bound));
 
   return X;
 }
 
-Ref<TriangleTopology> exact_delaunay_points(RawArray<const EV> X, RawArray<const Vector<int,2>> edges,
-                                            const bool validate) {
+// Split X into vertical slabs given by partition_loop(X.size(),slabs,s) for s in [lo,hi), in left to right order.
+// As in spatial_partition, we use exact comparisons so that coincident points are split consistently.
+static void slab_partition(RawArray<Perturbed2> X, const int slabs, const int lo, const int hi) {
+  if (hi-lo<=1)
+    return;
+  const int n = X.size(),
+            mid = (lo+hi)/2;
+  const auto start = X.begin()+partition_loop(n,slabs,lo).lo,
+             end = X.begin()+partition_loop(n,slabs,hi-1).hi,
+             split = X.begin()+partition_loop(n,slabs,mid).lo;
+  std::nth_element(start,split,end,[](const Perturbed2 a, const Perturbed2 b) {
+    return axis_less<0>(a,b);
+  });
+  slab_partition(X,slabs,lo,mid);
+  slab_partition(X,slabs,mid,hi);
+}
+
+// The counterclockwise convex hull of a sentinel free Delaunay triangulation, read off from its boundary.
+static Array<VertexId> delaunay_hull(const TriangleTopology& mesh) {
+  HalfedgeId start;
+  for (const auto e : mesh.boundary_edges()) {
+    start = e;
+    break;
+  }
+  GEODE_ASSERT(start.valid());
+  Array<VertexId> hull;
+  auto e = start;
+  do {
+    hull.append(mesh.src(e));
+    e = mesh.next(e);
+  } while (e!=start);
+  hull.reverse(); // Boundary loops run clockwise
+  return hull;
+}
+
+// Stitch together the Delaunay triangulations of two horizontally separated point sets, given their counterclockwise
+// convex hulls.  The region between the two hulls is triangulated by zipping upwards from the lower common tangent to
+// the upper common tangent, and all new halfedges are pushed onto the stack for later flipping.  Returns the hull of
+// the union.  This is the merge step of Guibas and Stolfi's divide and conquer algorithm, except that we leave
+// restoration of the Delaunay property to edge flips.
+static Array<VertexId> stitch_delaunay(MutableTriangleTopology& mesh, RawField<const Perturbed2,VertexId> X,
+                                       RawArray<const VertexId> left, RawArray<const VertexId> right,
+                                       Array<Tuple<HalfedgeId,Vector<VertexId,2>>>& stack) {
+  const int nl = left.size(),
+            nr = right.size();
+  #define L(i) left[((i)+nl)%nl]
+  #define R(i) right[((i)+nr)%nr]
+  #define ORIENTED(a,b,c) triangle_oriented(X[a],X[b],X[c])
+
+  // Start with the rightmost point of left and the leftmost point of right
+  int a = 0, b = 0;
+  for (const int i : range(1,nl))
+    if (axis_less<0>(X[L(a)],X[L(i)]))
+      a = i;
+  for (const int i : range(1,nr))
+    if (axis_less<0>(X[R(i)],X[R(b)]))
+      b = i;
+
+  // Walk down to the lower common tangent: left moves clockwise, right moves counterclockwise
+  int a0 = a, b0 = b;
+  for (;;) {
+    if (!ORIENTED(L(a0),R(b0),L(a0-1)))
+      a0 = (a0-1+nl)%nl;
+    else if (!ORIENTED(L(a0),R(b0),R(b0+1)))
+      b0 = (b0+1)%nr;
+    else
+      break;
+  }
+
+  // Walk up to the upper common tangent: left moves counterclockwise, right moves clockwise
+  int a1 = a, b1 = b;
+  for (;;) {
+    if (!ORIENTED(R(b1),L(a1),L(a1+1)))
+      a1 = (a1+1)%nl;
+    else if (!ORIENTED(R(b1),L(a1),R(b1-1)))
+      b1 = (b1-1+nr)%nr;
+    else
+      break;
+  }
+
+  // Zip the gap closed from bottom to top.  If both tangents touch the same vertex of one side, the rest of that side
+  // lies inside the merged hull, so its entire boundary faces the gap.  Since any segment between two vertices of the
+  // same side lies inside that side, every triangle in the gap has one edge on one side and its apex on the other, so
+  // at each step we either advance along the left or along the right.  A candidate triangle is valid if it is
+  // positively oriented and no boundary edge of either side pokes into it at one of its corners (the gap may be
+  // pinched, so orientation alone does not suffice).  If both candidates are valid, we choose the Delaunay one.
+  int steps_left = (a1-a0+nl)%nl,
+      steps_right = (b0-b1+nr)%nr;
+  if (!steps_left) steps_left = nl;
+  else if (!steps_right) steps_right = nr;
+  // Is p inside the corner at v of the positively oriented triangle u,v,w?
+  #define INSIDE(u,v,w,p) (ORIENTED(u,v,p) && ORIENTED(v,w,p))
+  for (a=a0,b=b0;steps_left || steps_right;) {
+    const auto la = L(a), rb = R(b),
+               ln = L(a+1), rn = R(b-1);
+    const bool valid_left =    steps_left && ORIENTED(la,rb,ln)
+                            && !INSIDE(la,rb,ln,rn) && !INSIDE(la,rb,ln,R(b+1))
+                            && !INSIDE(rb,ln,la,L(a+2)) && !INSIDE(ln,la,rb,L(a-1)),
+               valid_right =    steps_right && ORIENTED(la,rb,rn)
+                             && !INSIDE(rn,la,rb,L(a-1)) && !INSIDE(rn,la,rb,ln)
+                             && !INSIDE(la,rb,rn,R(b+1)) && !INSIDE(rb,rn,la,R(b-2));
+    GEODE_ASSERT(valid_left || valid_right);
+    const bool use_left = valid_left && (!valid_right || incircle(X[la],X[rb],X[rn],X[ln]));
+    const auto f = mesh.add_face(vec(la,rb,use_left?ln:rn));
+    for (const auto e : mesh.halfedges(f))
+      stack.append(tuple(e,mesh.vertices(e)));
+    if (use_left) {
+      a = (a+1)%nl;
+      steps_left--;
+    } else {
+      b = (b-1+nr)%nr;
+      steps_right--;
+    }
+  }
+  #undef INSIDE
+
+  // The new hull is right from b0 to b1 followed by left from a1 to a0, all counterclockwise
+  Array<VertexId> hull;
+  for (b=b0;;b=(b+1)%nr) {
+    hull.append(R(b));
+    if (b==b1) break;
+  }
+  for (a=a1;;a=(a+1)%nl) {
+    hull.append(L(a));
+    if (a==a0) break;
+  }
+  #undef L
+  #undef R
+  #undef ORIENTED
+  return hull;
+}
+
+// Delaunay triangulate by splitting into vertical slabs, triangulating each slab in parallel, stitching neighboring slabs
+// together, and restoring the Delaunay property by flipping outwards from the stitches.  Since edge flipping converges to
+// the unique (perturbed) Delaunay triangulation, the set of triangles agrees with deterministic_exact_delaunay.  Face
+// and halfedge ids depend on the order of construction, so exact_delaunay_points canonicalizes them.
+GEODE_NEVER_INLINE static Ref<MutableTriangleTopology> parallel_exact_delaunay(RawArray<Perturbed2> X, const int slabs,
+                                                                               const bool validate) {
   const int n = X.size();
-  GEODE_ASSERT(n>=3);
+  slab_partition(X,slabs,0,slabs);
+
+  // Triangulate each slab independently.  Exceptions (e.g., interrupts) can't escape OpenMP regions, so we stash them.
+  vector<Array<const Perturbed2>> slab_X(slabs);
+  vector<Ptr<MutableTriangleTopology>> slab_mesh(slabs);
+  vector<Array<VertexId>> slab_hull(slabs);
+  ExceptionValue error;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(slabs)
+  for (int s=0;s<slabs;s++) {
+    try {
+      const auto r = partition_loop(n,slabs,s);
+      slab_X[s] = partially_sorted_shuffle(X.slice(r.lo,r.hi),n);
+      slab_mesh[s] = deterministic_exact_delaunay(RawField<const Perturbed2,VertexId>(slab_X[s]),validate);
+      slab_hull[s] = delaunay_hull(*slab_mesh[s]);
+    } catch (const std::exception& e) {
+      #pragma omp critical
+      {
+        if (!error)
+          error = ExceptionValue(e);
+      }
+    }
+  }
+  if (error)
+    error.throw_();
+
+  // Concatenate all slabs into one mesh.  Vertices are numbered by slab, then by order within the slab.
+  const auto mesh = new_<MutableTriangleTopology>();
+  Field<Perturbed2,VertexId> Xs(n,uninit);
+  for (const int s : range(slabs)) {
+    const int offset = mesh->add(*slab_mesh[s]).x;
+    Xs.flat.slice(offset,offset+slab_mesh[s]->n_vertices()) = slab_X[s].slice(0,slab_mesh[s]->n_vertices());
+    for (auto& v : slab_hull[s])
+      v.id += offset;
+    slab_X[s].clean_memory();
+    slab_mesh[s].clear();
+  }
+
+  // Stitch slabs together from left to right
+  IntervalScope scope;
+  Array<Tuple<HalfedgeId,Vector<VertexId,2>>> stack;
+  auto hull = slab_hull[0];
+  for (const int s : range(1,slabs))
+    hull = stitch_delaunay(mesh,Xs,hull,slab_hull[s],stack);
+
+  // Fix all non-Delaunay edges
+  check_interrupts();
+  delaunay_flips(mesh,Xs,Tuple<>(),stack);
+
+  // If desired, check that the final mesh is Delaunay
+  if (validate)
+    assert_delaunay("parallel delaunay validate: ",mesh,Xs);
 
-  // Quantize all input points, reorder, and add sentinels
-  Field<const Perturbed2,VertexId> Xp(partially_sorted_shuffle(X));
+  // Restore the original vertex order
+  mesh->permute_vertices(Xs.flat.project<int,&Perturbed2::seed_>().copy());
+  return mesh;
+}
 
-  // Compute Delaunay triangulation
-  const auto mesh = deterministic_exact_delaunay(Xp,validate);
+Ref<TriangleTopology> exact_delaunay_points(RawArray<const EV> X, RawArray<const Vector<int,2>> edges,
+                                            const bool validate, const int threads) {
+  const int n = X.size();
+  GEODE_ASSERT(n>=3 && threads>=0);
+
+  // Attach seeds to all input points
+  Array<Perturbed2> Xp(n,uninit);
+  for (const int i : range(n))
+    Xp[i] = Perturbed2(i,X[i]);
+
+  // Compute Delaunay triangulation, in parallel if desired.  Each slab needs at least three points.
+  const int slabs = min(threads ? threads : omp_get_max_threads(),n/3);
+  Ptr<MutableTriangleTopology> mesh;
+  if (slabs>1)
+    mesh = parallel_exact_delaunay(Xp,slabs,validate);
+  else {
+    // Reorder and add sentinels
+    Field<const Perturbed2,VertexId> Xs(partially_sorted_shuffle(Xp,n));
+    mesh = deterministic_exact_delaunay(Xs,validate);
+
+    // Undo the vertex permutation
+    mesh->permute_vertices(Xs.flat.slice(0,n).project<int,&Perturbed2::seed_>().copy());
+  }
 
-  // Undo the vertex permutation
-  mesh->permute_vertices(Xp.flat.slice(0,n).project<int,&Perturbed2::seed_>().copy());
+  // Renumber faces and halfedges so that the result is identical for every thread count
+  mesh->canonicalize();
 
   // Insert constraint edges in random order
-  add_constraint_edges(mesh,RawField<const EV,VertexId>(X),edges,validate);
+  if (edges.size()) {
+    Field<Perturbed2,VertexId> Xc(n,uninit);
+    for (const int i : range(n))
+      Xc.flat[i] = Perturbed2(i,X[i]);
+    add_constraint_edges(*mesh,Xc,edges,validate);
+  }
 
   // All done!
-  return mesh;
+  return ref(*mesh);
 }
 
 Ref<TriangleTopology> delaunay_points(RawArray<const Vector<real,2>> X, RawArray<const Vector<int,2>> edges,
-                                      const bool validate) {
-  return exact_delaunay_points(amap(quantizer(bounding_box(X)),X).copy(),edges,validate);
+                                      const bool validate, const int threads) {
+  return exact_delaunay_points(amap(quantizer(bounding_box(X)),X).copy(),edges,validate,threads);
+}
+
+GEODE_DEFINE_TYPE(DynamicDelaunay)
+
+DynamicDelaunay::DynamicDelaunay(const Box<TV> box)
+  : box(box)
+  , quant(box)
+  , mesh(new_<MutableTriangleTopology>())
+  , random(new_<Random>(key+11))
+  , hint(0) {
+  // Start with a single triangle of sentinels at infinity, as in deterministic_exact_delaunay
+  GEODE_ASSERT(!box.empty());
+  mesh->add_vertices(3);
+  X.flat.extend(vec(Perturbed2(0,EV(-bound,-bound)),
+                    Perturbed2(1,EV( bound, 0)    ),
+                    Perturbed2(2,EV(-bound, bound))));
+  mesh->add_face(vec(VertexId(0),VertexId(1),VertexId(2)));
+}
+
+DynamicDelaunay::~DynamicDelaunay() {}
+
+Perturbed2 DynamicDelaunay::quantize(const TV x) const {
+  if (!box.lazy_inside(x))
+    throw ValueError(format("DynamicDelaunay: point %s is outside the box %s",str(x),str(box)));
+  return Perturbed2(X.size(),quant(x));
+}
+
+// Stochastic visibility walk from the hint vertex to the face containing x.  See
+//
+//   Olivier Devillers, Sylvain Pion, Monique Teillaud, "Walking in a triangulation".
+//
+// Randomizing the order of edge tests guarantees termination even for constrained triangulations.
+FaceId DynamicDelaunay::walk(const Perturbed2 x) const {
+  auto f = mesh->face(mesh->halfedge(hint));
+  if (!f.valid())
+    f = mesh->face(mesh->reverse(mesh->halfedge(hint)));
+  HalfedgeId e; // The edge we entered f through
+  for (;;) {
+    const int start = random->uniform<int>(0,3);
+    for (const int i : range(3)) {
+      const auto h = mesh->halfedge(f,(start+i)%3);
+      if (h!=e && !triangle_oriented(X,mesh->src(h),mesh->dst(h),x)) {
+        // Sentinel faces cover the plane, so we never walk off the mesh
+        e = mesh->reverse(h);
+        assert(!mesh->is_boundary(e));
+        f = mesh->face(e);
+        goto next;
+      }
+    }
+    return f;
+    next:;
+  }
+}
+
+void DynamicDelaunay::insert_vertex(const VertexId v) {
+  // Split the containing face
+  const auto f = walk(X[v]);
+  const auto vs = mesh->vertices(f);
+  mesh->split_face(f,v);
+
+  // Fix all non-Delaunay edges
+  stack.clear();
+  for (const auto e : vec(vec(vs.x,vs.y),vec(vs.y,vs.z),vec(vs.z,vs.x)))
+    stack.append(tuple(mesh->halfedge(e.x,e.y),e));
+  delaunay_flips(mesh,X,constrained,stack);
+  hint = v;
+}
+
+VertexId DynamicDelaunay::insert(const TV x) {
+  const auto p = quantize(x);
+  IntervalScope scope;
+  const auto v = mesh->add_vertex();
+  GEODE_ASSERT(v.id==p.seed());
+  X.flat.append(p);
+  insert_vertex(v);
+  return v;
+}
+
+Array<VertexId> DynamicDelaunay::insert_many(RawArray<const TV> Xn) {
+  // Quantize everything first so that we fail without making changes
+  const int n = Xn.size();
+  Array<Perturbed2> P(n,uninit);
+  for (const int i : range(n))
+    P[i] = Perturbed2(X.size()+i,quantize(Xn[i]).value());
+
+  // Add vertices, then insert them in spatially sorted order so that walks are short
+  const auto base = mesh->add_vertices(n);
+  GEODE_ASSERT(base.id==X.size());
+  X.flat.extend(P);
+  spatial_sort(P,16,random);
+  IntervalScope scope;
+  for (const auto& p : P)
+    insert_vertex(VertexId(p.seed()));
+  Array<VertexId> vs(n,uninit);
+  for (const int i : range(n))
+    vs[i] = VertexId(base.id+i);
+  return vs;
+}
+
+void DynamicDelaunay::erase(const VertexId v) {
+  if (!mesh->valid(v) || is_sentinel(v) || mesh->isolated(v))
+    throw ValueError(format("DynamicDelaunay::erase: invalid vertex %d",v.id));
+  IntervalScope scope;
+
+  // Forget constraints touching v, and remember the link of v for later flipping
+  stack.clear();
+  for (const auto e : mesh->outgoing(v)) {
+    const auto n = mesh->next(e);
+    stack.append(tuple(n,mesh->vertices(n)));
+    if (constrained.size())
+      constrained.erase(vec(v,mesh->dst(e)).sorted());
+  }
+
+  // Flip edges away from v until it has degree three.  An edge vw can be flipped if the quadrilateral around it is
+  // convex, and since the link of v always has two disjoint ears, at least one such edge exists.
+  for (;;) {
+    int degree = 0;
+    HalfedgeId flip;
+    for (const auto e : mesh->outgoing(v)) {
+      degree++;
+      if (!flip.valid()) {
+        const auto w = mesh->dst(e),
+                   wn = mesh->dst(mesh->left(e)),
+                   wp = mesh->dst(mesh->right(e));
+        if (   triangle_oriented(X,wp,w,wn) && triangle_oriented(X,v,wp,wn)
+            && !mesh->halfedge(wp,wn).valid()) // Two sentinels may already be connected at infinity
+          flip = e;
+      }
+    }
+    if (degree==3)
+      break;
+    GEODE_ASSERT(flip.valid());
+    const auto e = mesh->unsafe_flip_edge(flip);
+    stack.append(tuple(e,mesh->vertices(e)));
+  }
+
+  // Replace the three remaining triangles with one
+  const auto e = mesh->halfedge(v);
+  const auto a = mesh->dst(e),
+             b = mesh->dst(mesh->left(e)),
+             c = mesh->dst(mesh->right(e));
+  while (!mesh->isolated(v)) {
+    const auto h = mesh->halfedge(v);
+    mesh->erase_face_with_reordering(mesh->face(mesh->is_boundary(h) ? mesh->reverse(h) : h));
+  }
+  const auto f = mesh->add_face(vec(a,b,c));
+  for (const auto h : mesh->halfedges(f))
+    stack.append(tuple(h,mesh->vertices(h)));
+  delaunay_flips(mesh,X,constrained,stack);
+  if (hint==v)
+    hint = a;
+}
+
+void DynamicDelaunay::add_constraint(const VertexId v0, const VertexId v1) {
+  for (const auto v : vec(v0,v1))
+    if (!mesh->valid(v) || is_sentinel(v) || mesh->isolated(v))
+      throw ValueError(format("DynamicDelaunay::add_constraint: invalid vertex %d",v.id));
+  if (v0==v1)
+    throw ValueError(format("DynamicDelaunay::add_constraint: degenerate edge (%d,%d)",v0.id,v1.id));
+  IntervalScope scope;
+  add_constraint_edge(mesh,X,constrained,vec(v0,v1).sorted(),random,left_cavity,right_cavity);
+}
+
+FaceId DynamicDelaunay::locate(const TV x) const {
+  const auto p = quantize(x);
+  IntervalScope scope;
+  return walk(p);
+}
+
+Array<Vector<int,3>> DynamicDelaunay::elements() const {
+  Array<Vector<int,3>> tris;
+  for (const auto f : mesh->faces()) {
+    const auto v = mesh->vertices(f);
+    if (!is_sentinel(v.x) && !is_sentinel(v.y) && !is_sentinel(v.z))
+      tris.append(Vector<int,3>(v));
+  }
+  return tris;
+}
+
+void DynamicDelaunay::assert_delaunay() const {
+  mesh->assert_consistent();
+  IntervalScope scope;
+  geode::assert_delaunay("dynamic delaunay: ",mesh,X,constrained,false,false);
 }
 
 // Greedily compute a set of nonintersecting edges in a point cloud for testing purposes
@@ -856,4 +1284,18 @@ void wrap_delaunay() {
   GEODE_FUNCTION_2(delaunay_points_py,delaunay_points)
   GEODE_FUNCTION(greedy_nonintersecting_edges)
   GEODE_FUNCTION(chew_fan_count)
+
+  typedef DynamicDelaunay Self;
+  Class<Self>("DynamicDelaunay")
+    .GEODE_INIT(Box<Vector<real,2>>)
+    .GEODE_FIELD(box)
+    .GEODE_FIELD(mesh)
+    .GEODE_METHOD(insert)
+    .GEODE_METHOD(insert_many)
+    .GEODE_METHOD(erase)
+    .GEODE_METHOD(add_constraint)
+    .GEODE_METHOD(locate)
+    .GEODE_METHOD(elements)
+    .GEODE_METHOD(assert_delaunay)
+    ;
 }
@@ -2,19 +2,85 @@
 #pragma once
 
 #include <geode/exact/config.h>
+#include <geode/exact/quantize.h>
 #include <geode/mesh/TriangleTopology.h>
+#include <geode/random/forward.h>
+#include <geode/structure/Hashtable.h>
 namespace geode {
 
 // Approximately Delaunay triangulate a point set, by first quantizing and performing exact Delaunay.
 // Any edges are used as constraints in constrained Delaunay.  If two edges intersect, ValueError is thrown.
+// If threads is not 1, the unconstrained triangulation is computed in parallel (see exact_delaunay_points).  The result
+// is identical for every thread count.
 GEODE_CORE_EXPORT Ref<TriangleTopology> delaunay_points(RawArray<const Vector<real,2>> X,
                                                         RawArray<const Vector<int,2>> edges=Tuple<>(),
-                                                        const bool validate=false);
+                                                        const bool validate=false, const int threads=1);
 
 // Exactly Delaunay triangulate a quantized point set.
 // Any edges are used as constraints in constrained Delaunay.  If two edges intersect, ValueError is thrown.
+//
+// If threads is not 1, the points are split into vertical slabs which are triangulated concurrently and then
+// stitched together, using up to threads threads (or all available threads if threads is 0).  Since symbolic
+// perturbation makes the Delaunay triangulation unique, the set of triangles is independent of the thread count, and
+// faces and halfedges are numbered canonically from the sorted triangles, so the whole mesh is.
 GEODE_CORE_EXPORT Ref<TriangleTopology> exact_delaunay_points(RawArray<const Vector<Quantized,2>> X,
                                                               RawArray<const Vector<int,2>> edges=Tuple<>(),
-                                                              const bool validate=false);
+                                                              const bool validate=false, const int threads=1);
+
+// A persistent constrained Delaunay triangulation which supports insertion and removal of points and insertion of
+// constraint edges, with cost proportional to the affected region (plus the walk to find inserted points).  Points are
+// quantized once using a fixed box, and must lie inside it.  The mesh is closed off by three sentinel vertices at infinity
+// (vertices 0, 1, and 2), so faces touching a sentinel lie outside the convex hull.  Removed vertices are left isolated,
+// so vertex ids are never reused; face and halfedge ids change with every update.
+class DynamicDelaunay : public Object {
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef real T;
+  typedef Vector<T,2> TV;
+
+  // These are exposed for external access, but should be treated as read-only
+  const Box<TV> box;
+  const Quantizer<T,2> quant;
+  const Ref<MutableTriangleTopology> mesh; // Includes the sentinels
+  Field<exact::Perturbed2,VertexId> X; // Quantized positions, with seeds equal to vertex ids
+protected:
+  Hashtable<Vector<VertexId,2>> constrained; // Sorted constraint edges
+  const Ref<Random> random;
+  VertexId hint; // Walks start here
+  Array<Tuple<HalfedgeId,Vector<VertexId,2>>> stack;
+  Array<VertexId> left_cavity, right_cavity;
+
+  GEODE_CORE_EXPORT DynamicDelaunay(const Box<TV> box);
+public:
+  ~DynamicDelaunay();
+
+  static bool is_sentinel(const VertexId v) { return unsigned(v.id)<3; }
+
+  // Insert a point, returning its vertex id.  Point location walks from the most recently touched vertex.
+  GEODE_CORE_EXPORT VertexId insert(const TV x);
+
+  // Insert many points, returning their vertex ids in order.  The points are spatially sorted before insertion.
+  GEODE_CORE_EXPORT Array<VertexId> insert_many(RawArray<const TV> X);
+
+  // Remove a nonsentinel vertex, leaving it isolated.  Constraints touching it are removed as well.
+  GEODE_CORE_EXPORT void erase(const VertexId v);
+
+  // Constrain an edge to exist.  If it would intersect an existing constraint, ValueError is thrown.
+  GEODE_CORE_EXPORT void add_constraint(const VertexId v0, const VertexId v1);
+
+  // The face containing a point (which may touch a sentinel if the point is outside the convex hull)
+  GEODE_CORE_EXPORT FaceId locate(const TV x) const;
+
+  // All triangles not touching a sentinel
+  GEODE_CORE_EXPORT Array<Vector<int,3>> elements() const;
+
+  // Throw an exception unless the mesh is constrained Delaunay
+  GEODE_CORE_EXPORT void assert_delaunay() const;
+
+private:
+  exact::Perturbed2 quantize(const TV x) const;
+  FaceId walk(const exact::Perturbed2 x) const;
+  void insert_vertex(const VertexId v);
+};
 
 }
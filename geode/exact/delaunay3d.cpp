@@ -0,0 +1,325 @@
+// Randomized incremental 3D Delaunay using simulation of simplicity
+
+#include <geode/exact/delaunay3d.h>
+#include <geode/exact/predicates.h>
+#include <geode/exact/quantize.h>
+#include <geode/exact/scope.h>
+#include <geode/array/amap.h>
+#include <geode/geometry/Box.h>
+#include <geode/math/integer_log.h>
+#include <geode/python/wrap.h>
+#include <geode/random/permute.h>
+#include <geode/random/Random.h>
+#include <geode/structure/Tuple.h>
+#include <geode/utility/interrupts.h>
+#include <geode/utility/format.h>
+#include <algorithm>
+namespace geode {
+
+typedef Vector<real,3> TV;
+typedef Vector<Quantized,3> EV;
+using exact::Perturbed3;
+
+static const uint128_t key = 4128873460107386519u+(uint128_t(1393570581914458463u)<<64);
+
+// BRIO ordering, as in partially_sorted_shuffle in delaunay.cpp, but sorting indices into X.
+
+template<int axis> static inline int spatial_partition(RawArray<const Perturbed3> X, RawArray<int> I, Random& random) {
+  #define LESS(i,j) (i!=j && axis_less<axis>(X[I[i]],X[I[j]]))
+  const int n = I.size();
+  int i0 = random.uniform<int>(0,n),
+      i1 = random.uniform<int>(0,n),
+      i2 = random.uniform<int>(0,n);
+  if (!LESS(i0,i1)) swap(i0,i1);
+  if (!LESS(i1,i2)) swap(i1,i2);
+  if (!LESS(i0,i1)) swap(i0,i1);
+  #undef LESS
+  const auto Xmid = X[I[i1]];
+  swap(I[i1],I.back());
+  int mid = 0;
+  for (const int i : range(n-1))
+    if (axis_less<axis>(X[I[i]],Xmid))
+      swap(I[i],I[mid++]);
+  return mid;
+}
+
+static void spatial_sort(RawArray<const Perturbed3> X, RawArray<int> I, const int leaf_size, Random& random) {
+  const int n = I.size();
+  if (n<=leaf_size)
+    return;
+  Box<EV> box;
+  for (const int i : I)
+    box.enlarge(X[i].value());
+  const int axis = box.sizes().argmax();
+  const int mid = axis==0 ? spatial_partition<0>(X,I,random)
+                : axis==1 ? spatial_partition<1>(X,I,random)
+                          : spatial_partition<2>(X,I,random);
+  spatial_sort(X,I.slice(0,mid),leaf_size,random);
+  spatial_sort(X,I.slice(mid,n),leaf_size,random);
+}
+
+static Array<int> brio_order(RawArray<const Perturbed3> X) {
+  const int n = X.size();
+  Array<int> order(n,uninit);
+  const int bins = integer_log(n);
+  Array<int> bin_counts(bins);
+  for (int i=0;i<n;i++) {
+    int j = (int)random_permute(n,key,i);
+    const int bin = min(integer_log(j+1),bins-1);
+    order[(1<<bin)-1+bin_counts[bin]++] = i;
+  }
+  for (int bin=0;bin<bins;bin++) {
+    const int start = (1<<bin)-1,
+              end = bin==bins-1?n:start+(1<<bin);
+    spatial_sort(X,order.slice(start,end),64,new_<Random>(key+bin));
+  }
+  return order;
+}
+
+namespace {
+// A tetrahedralization closed off by tetrahedra touching the vertex at infinity (inf = X.size()).  All tetrahedra
+// are positively oriented, treating infinity as lying beyond the face opposite it.  Neighbors are stored as
+// 4*tet+face, where face i is opposite vertex i.  Free slots have tets[t].x < 0.
+struct Delaunay3 {
+  RawArray<const Perturbed3> X;
+  const int inf;
+  Array<Vector<int,4>> tets, nbs;
+  Array<int> marks, free;
+  int stamp, hint;
+
+  // Temporaries for insert
+  Array<int> cavity;
+  Array<Vector<int,2>> boundary;
+  Array<Vector<int,4>> fresh;
+  Array<Tuple<uint64_t,int>> links;
+
+  Delaunay3(RawArray<const Perturbed3> X)
+    : X(X), inf(X.size()), stamp(0), hint(0) {}
+
+  // Would tet v be positively oriented with vertex i replaced by p?  The other vertices must be finite.
+  bool oriented_with(const Vector<int,4>& v, const int i, const Perturbed3 p) const {
+    #define Q(j) (i==j ? p : X[v[j]])
+    return tetrahedron_oriented(Q(0),Q(1),Q(2),Q(3));
+    #undef Q
+  }
+
+  // Is p inside the circumsphere of t?  For infinite tets, the sphere is the halfspace beyond the finite face.
+  bool conflict(const int t, const Perturbed3 p) const {
+    const auto& v = tets[t];
+    for (const int i : range(4))
+      if (v[i]==inf)
+        return oriented_with(v,i,p);
+    return insphere(X[v.x],X[v.y],X[v.z],X[v.w],p);
+  }
+
+  int new_tet(const Vector<int,4> v) {
+    if (free.size()) {
+      const int t = free.pop();
+      tets[t] = v;
+      return t;
+    }
+    // Neighbors are encoded as 4*tet+face, so tet indices must stay below 2^29
+    GEODE_ASSERT(tets.size()<(1<<29),"delaunay 3d: too many tets for 32 bit neighbor indices");
+    nbs.append(Vector<int,4>());
+    marks.append(0);
+    return tets.append(v);
+  }
+
+  // Start with one finite tet and four infinite tets around it
+  void initialize(Vector<int,4> v) {
+    if (!tetrahedron_oriented(X[v.x],X[v.y],X[v.z],X[v.w]))
+      swap(v.z,v.w);
+    new_tet(v);
+    for (const int i : range(4)) {
+      auto u = v;
+      u[i] = inf;
+      swap(u[(i+1)&3],u[(i+2)&3]);
+      new_tet(u);
+    }
+    // Link faces with matching vertex sets
+    for (const int t : range(5))
+      for (const int i : range(4)) {
+        const auto f = tets[t].remove_index(i).sorted();
+        for (const int s : range(5))
+          for (const int j : range(4))
+            if (s!=t && tets[s].remove_index(j).sorted()==f)
+              nbs[t][i] = 4*s+j;
+      }
+  }
+
+  // Visibility walk from the hint to a tet in conflict with p.  Choosing a random starting face guarantees termination.
+  int locate(const Perturbed3 p, uint32_t& state) const {
+    int t = hint,
+        came = -1; // Face through which we entered t, which is known to have p on the inside
+    for (;;) {
+      const auto& v = tets[t];
+      const int k = v.find(inf);
+      if (k>=0) {
+        if (k==came || oriented_with(v,k,p))
+          return t;
+        const int c = nbs[t][k];
+        t = c>>2;
+        came = c&3;
+        continue;
+      }
+      state ^= state<<13;
+      state ^= state>>17;
+      state ^= state<<5;
+      const int start = state&3;
+      for (int j=0;j<4;j++) {
+        const int i = (start+j)&3;
+        if (i!=came && !oriented_with(v,i,p)) {
+          const int c = nbs[t][i];
+          t = c>>2;
+          came = c&3;
+          goto next;
+        }
+      }
+      return t;
+      next:;
+    }
+  }
+
+  // Bowyer-Watson insertion: remove all tets in conflict with p, and connect p to the boundary of the hole.
+  void insert(const int vi, uint32_t& state) {
+    const auto p = X[vi];
+    const int start = locate(p,state);
+
+    // Collect the cavity by flood fill from start, marking tested tets with 2*stamp (conflict) or 2*stamp+1 (not)
+    stamp++;
+    const int in = 2*stamp, out = in+1;
+    cavity.clear();
+    boundary.clear();
+    marks[start] = in;
+    cavity.append(start);
+    for (int c=0;c<cavity.size();c++) {
+      const int t = cavity[c];
+      for (const int i : range(4)) {
+        const int u = nbs[t][i]>>2;
+        if (marks[u]==in)
+          continue;
+        if (marks[u]!=out && conflict(u,p)) {
+          marks[u] = in;
+          cavity.append(u);
+        } else {
+          marks[u] = out;
+          boundary.append(vec(t,i));
+        }
+      }
+    }
+
+    // Replace each boundary face's inner vertex with p, reusing cavity slots first.  Grab all data before overwriting.
+    const int nc = cavity.size(),
+              nb = boundary.size();
+    fresh.resize(nb,uninit);
+    for (const int k : range(nb)) {
+      const auto b = boundary[k];
+      fresh[k] = tets[b.x];
+      fresh[k][b.y] = vi;
+      boundary[k] = vec(b.y,nbs[b.x][b.y]); // Replaced vertex and outside neighbor
+    }
+    for (int k=nb;k<nc;k++) {
+      tets[cavity[k]] = Vector<int,4>(-1,-1,-1,-1);
+      free.append(cavity[k]);
+    }
+    links.clear();
+    for (const int k : range(nb)) {
+      const auto& v = fresh[k];
+      const int s = k<nc ? (tets[cavity[k]] = v, cavity[k]) : new_tet(v),
+                i = boundary[k].x,
+                o = boundary[k].y;
+      nbs[s][i] = o;
+      nbs[o>>2][o&3] = 4*s+i;
+      // The face opposite l contains p and an edge of the boundary face, which is shared with exactly one other new tet
+      for (const int l : range(4))
+        if (l!=i) {
+          int a = -1, b = -1;
+          for (const int j : range(4))
+            if (j!=i && j!=l)
+              (a<0 ? a : b) = j;
+          const auto e = vec(v[a],v[b]).sorted();
+          links.append(tuple(uint64_t(e.x)<<32|uint32_t(e.y),4*s+l));
+        }
+    }
+    std::sort(links.begin(),links.end());
+    for (int k=0;k<links.size();k+=2) {
+      assert(links[k].x==links[k+1].x);
+      const int c0 = links[k].y,
+                c1 = links[k+1].y;
+      nbs[c0>>2][c0&3] = c1;
+      nbs[c1>>2][c1&3] = c0;
+    }
+    hint = links[0].y>>2;
+  }
+
+  // Check that all faces are locally Delaunay, which suffices for global Delaunay
+  void assert_delaunay(const char* prefix) const {
+    for (const int t : range(tets.size())) {
+      const auto& v = tets[t];
+      if (v.x<0)
+        continue;
+      if (v.find(inf)<0)
+        GEODE_ASSERT(tetrahedron_oriented(X[v.x],X[v.y],X[v.z],X[v.w]));
+      for (const int i : range(4)) {
+        const int c = nbs[t][i],
+                  u = c>>2;
+        GEODE_ASSERT(tets[u].x>=0 && nbs[u][c&3]==4*t+i);
+        const int o = tets[u][c&3];
+        if (o!=inf && conflict(t,X[o]))
+          throw RuntimeError(format("%snon delaunay face: t%d, v%d v%d v%d",prefix,t,
+                                    v[(i+1)&3],v[(i+2)&3],v[(i+3)&3]));
+      }
+    }
+  }
+
+  // Finite tets, compacted
+  Array<Vector<int,4>> elements() const {
+    Array<Vector<int,4>> result;
+    for (const auto& v : tets)
+      if (v.x>=0 && v.find(inf)<0)
+        result.append(v);
+    return result;
+  }
+};
+}
+
+Array<Vector<int,4>> exact_delaunay_points_3d(RawArray<const Vector<Quantized,3>> X, const bool validate) {
+  const int n = X.size();
+  // About 6.7n tets, each encoded in neighbor indices as 4*tet+face, must fit in an int.  new_tet also checks the
+  // actual count, since degenerate inputs can have more.
+  GEODE_ASSERT(n<(1<<26),"Too many points for 32 bit tet neighbor indices");
+  if (n<4)
+    return Array<Vector<int,4>>();
+  IntervalScope scope;
+  Array<Perturbed3> Xp(n,uninit);
+  for (const int i : range(n))
+    Xp[i] = Perturbed3(i,X[i]);
+  const auto order = brio_order(Xp);
+
+  // A Delaunay tetrahedralization with n vertices has about 6.7n tets on average
+  Delaunay3 D(Xp);
+  D.tets.preallocate(7*n+16);
+  D.nbs.preallocate(7*n+16);
+  D.marks.preallocate(7*n+16);
+  D.initialize(vec(order[0],order[1],order[2],order[3]));
+  uint32_t state = 2463534242u;
+  for (const int i : range(4,n)) {
+    D.insert(order[i],state);
+    if (!(i&0xffff))
+      check_interrupts();
+  }
+  if (validate)
+    D.assert_delaunay("delaunay 3d validate: ");
+  return D.elements();
+}
+
+Array<Vector<int,4>> delaunay_points_3d(RawArray<const TV> X, const bool validate) {
+  return exact_delaunay_points_3d(amap(quantizer(bounding_box(X)),X).copy(),validate);
+}
+
+}
+using namespace geode;
+
+void wrap_delaunay3d() {
+  GEODE_FUNCTION_2(delaunay_points_3d_py,delaunay_points_3d)
+}
@@ -0,0 +1,22 @@
+// Randomized incremental 3D Delaunay using simulation of simplicity
+#pragma once
+
+#include <geode/exact/config.h>
+#include <geode/array/Array.h>
+#include <geode/vector/Vector.h>
+namespace geode {
+
+// Approximately Delaunay tetrahedralize a point set, by first quantizing and performing exact Delaunay.
+// The result is a compact array of positively oriented tetrahedra covering the convex hull.  Since symbolic
+// perturbation puts the points in general position, degenerate inputs (e.g., coplanar, cospherical, or duplicate
+// points) are handled, but may produce zero volume tetrahedra.  For points in general position the result is a
+// valid rest state for StrainMeasure<T,3>, but StrainMeasure rejects zero volume tetrahedra as degenerate.
+GEODE_CORE_EXPORT Array<Vector<int,4>> delaunay_points_3d(RawArray<const Vector<real,3>> X,
+                                                          const bool validate=false);
+
+// Exactly Delaunay tetrahedralize a quantized point set.  Points are inserted in BRIO order (see Amenta et al.,
+// Incremental Constructions con BRIO), and the convex hull is closed off with tetrahedra touching a vertex at infinity.
+GEODE_CORE_EXPORT Array<Vector<int,4>> exact_delaunay_points_3d(RawArray<const Vector<Quantized,3>> X,
+                                                                const bool validate=false);
+
+}
@@ -139,6 +139,77 @@ GEODE_PURE static inline Exact<15> operator-(const Exact<15> x, const Exact<15>
   ADDER(-,0) ADDER(-,1) ADDER(-,2) ADDER(-,3) ADDER(-,4) ADDER(-,5) ADDER(-,6) ADDER(-,7) ADDER(-,8) ADDER(-,9) ADDER(-,10) ADDER(-,11) ADDER(-,12) ADDER(-,13) ADDER(-,14)
   return r;
 }
+
+#define NEGATER(i) { \
+  const auto t = __uint128_t(~x.n[i]) + carry; \
+  carry = t>>64; \
+  r.n[i] = uint64_t(t); }
+GEODE_PURE static inline Exact<1> operator-(const Exact<1> x) {
+  Exact<1> r(uninit);
+  bool carry = 1;
+  NEGATER(0)
+  return r;
+}
+GEODE_PURE static inline Exact<2> operator-(const Exact<2> x) {
+  Exact<2> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1)
+  return r;
+}
+GEODE_PURE static inline Exact<3> operator-(const Exact<3> x) {
+  Exact<3> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2)
+  return r;
+}
+GEODE_PURE static inline Exact<4> operator-(const Exact<4> x) {
+  Exact<4> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3)
+  return r;
+}
+GEODE_PURE static inline Exact<5> operator-(const Exact<5> x) {
+  Exact<5> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4)
+  return r;
+}
+GEODE_PURE static inline Exact<6> operator-(const Exact<6> x) {
+  Exact<6> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5)
+  return r;
+}
+GEODE_PURE static inline Exact<7> operator-(const Exact<7> x) {
+  Exact<7> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5) NEGATER(6)
+  return r;
+}
+GEODE_PURE static inline Exact<8> operator-(const Exact<8> x) {
+  Exact<8> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5) NEGATER(6) NEGATER(7)
+  return r;
+}
+GEODE_PURE static inline Exact<9> operator-(const Exact<9> x) {
+  Exact<9> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5) NEGATER(6) NEGATER(7) NEGATER(8)
+  return r;
+}
+GEODE_PURE static inline Exact<12> operator-(const Exact<12> x) {
+  Exact<12> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5) NEGATER(6) NEGATER(7) NEGATER(8) NEGATER(9) NEGATER(10) NEGATER(11)
+  return r;
+}
+GEODE_PURE static inline Exact<15> operator-(const Exact<15> x) {
+  Exact<15> r(uninit);
+  bool carry = 1;
+  NEGATER(0) NEGATER(1) NEGATER(2) NEGATER(3) NEGATER(4) NEGATER(5) NEGATER(6) NEGATER(7) NEGATER(8) NEGATER(9) NEGATER(10) NEGATER(11) NEGATER(12) NEGATER(13) NEGATER(14)
+  return r;
+}
 GEODE_PURE static inline Exact<2> operator*(const Exact<1> x, const Exact<1> y) {
   Exact<2> r(uninit);
   typedef __uint128_t B;
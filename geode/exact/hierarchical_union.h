@@ -0,0 +1,119 @@
+// Parallel hierarchical union shared by polygon_csg and circle_csg
+#pragma once
+
+// The input contours are grouped into shapes: a contour with nonnegative signed area followed by any
+// contours with negative area (its holes).  Shapes are sorted into a balanced kd-tree by bounding box
+// center, each leaf is unioned independently, and sibling results are merged pairwise up the tree.
+// Since every merge requantizes its inputs, results agree with a single union only up to quantization.
+
+#include <geode/array/Nested.h>
+#include <geode/geometry/Box.h>
+#include <geode/python/ExceptionValue.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
+#include <vector>
+namespace geode {
+
+// area(RawArray<const T>) is the signed area of one contour, box(RawArray<const T>) its bounding box,
+// and split(Nested<const T>) unions a set of contours.
+template<class T,class Area,class Bound,class Split>
+Nested<T> hierarchical_union(Nested<const T> contours, const int threads,
+                             const Area& area, const Bound& box, const Split& split) {
+  typedef Vector<real,2> TV;
+
+  // Group contours into shapes
+  Array<int> shapes; // shapes[s] is the first contour of shape s, with a final sentinel
+  for (const int c : range(contours.size()))
+    if (contours.size(c) && (!shapes.size() || area(contours[c])>=0))
+      shapes.append(c);
+  const int n = shapes.size();
+  shapes.append(contours.size());
+  const int nt = threads ? threads : omp_get_max_threads();
+  if (nt==1 || n<2)
+    return split(contours);
+
+  // Sort shapes into a complete kd-tree with at most 4*nt leaves
+  Array<TV> centers(n,uninit);
+  for (const int s : range(n)) {
+    Box<TV> b;
+    for (int c=shapes[s];c<shapes[s+1];c++)
+      b.enlarge(box(contours[c]));
+    centers[s] = b.center();
+  }
+  int levels = 0;
+  while ((2<<levels)<=min(n,4*nt))
+    levels++;
+  const int leaves = 1<<levels;
+  // Each node covers a contiguous run of leaves, and is split at the boundary between its two halves.  The leaf ranges
+  // below come from the same partition_loop, so every leaf task is exactly one subtree.
+  const auto start = [=](const int leaf) { return leaf<leaves ? partition_loop(n,leaves,leaf).lo : n; };
+  Array<int> order = arange(n).copy();
+  for (int level=0;level<levels;level++)
+    for (int node=0;node<(1<<level);node++) {
+      const int span = leaves>>level,
+                lo = start(node*span),
+                mid = start(node*span+span/2),
+                hi = start((node+1)*span);
+      Box<TV> b;
+      for (const int s : order.slice(lo,hi))
+        b.enlarge(centers[s]);
+      const int axis = b.sizes().argmax();
+      std::nth_element(order.begin()+lo,order.begin()+mid,order.begin()+hi,[&](const int a, const int b) {
+        return centers[a][axis]<centers[b][axis];
+      });
+    }
+
+  // Union each leaf.  Exceptions can't escape an OpenMP region, so we stash the first one and rethrow it after.
+  std::vector<Nested<T>> parts(leaves);
+  ExceptionValue error;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int leaf=0;leaf<leaves;leaf++) {
+    try {
+      const auto r = partition_loop(n,leaves,leaf);
+      Array<int> lengths;
+      for (const int s : order.slice(r.lo,r.hi))
+        for (int c=shapes[s];c<shapes[s+1];c++)
+          if (contours.size(c))
+            lengths.append(contours.size(c));
+      Nested<T> group(lengths,uninit);
+      int i = 0;
+      for (const int s : order.slice(r.lo,r.hi))
+        for (int c=shapes[s];c<shapes[s+1];c++)
+          for (const auto& x : contours[c])
+            group.flat[i++] = x;
+      parts[leaf] = split(group);
+    } catch (const std::exception& e) {
+      #pragma omp critical
+      {
+        if (!error)
+          error = ExceptionValue(e);
+      }
+    }
+  }
+  if (error)
+    error.throw_();
+
+  // Merge siblings up the tree, writing each level into a fresh vector since merge i would otherwise overwrite
+  // parts[i] while merge i/2 reads it
+  for (int size=leaves/2;size;size/=2) {
+    std::vector<Nested<T>> merged(size);
+    #pragma omp parallel for schedule(dynamic,1) num_threads(min(nt,size))
+    for (int i=0;i<size;i++) {
+      try {
+        merged[i] = split(concatenate(parts[2*i],parts[2*i+1]).freeze());
+      } catch (const std::exception& e) {
+        #pragma omp critical
+        {
+          if (!error)
+            error = ExceptionValue(e);
+        }
+      }
+    }
+    if (error)
+      error.throw_();
+    parts.swap(merged);
+  }
+  return parts[0];
+}
+
+}
@@ -10,6 +10,7 @@
 #include <geode/exact/simple_triangulate.h>
 #include <geode/array/amap.h>
 #include <geode/array/ConstantMap.h>
+#include <geode/array/IndirectArray.h>
 #include <geode/array/RawField.h>
 #include <geode/array/reversed.h>
 #include <geode/array/sort.h>
@@ -18,14 +19,18 @@
 #include <geode/math/mean.h>
 #include <geode/math/optimal_sort.h>
 #include <geode/mesh/TriangleSoup.h>
+#include <geode/python/Class.h>
+#include <geode/python/ExceptionValue.h>
 #include <geode/python/function.h>
 #include <geode/python/wrap.h>
 #include <geode/random/permute.h>
 #include <geode/random/Random.h>
 #include <geode/structure/Hashtable.h>
 #include <geode/structure/UnionFind.h>
+#include <geode/utility/openmp.h>
 #include <geode/utility/Unique.h>
 #include <geode/vector/Matrix.h>
+#include <vector>
 namespace geode {
 
 // Algorithm explanation:
@@ -727,56 +732,81 @@ template<int up> struct PolicyUp : public Policy {
 };
 }
 
-// Find all intersection vertices and edges
-static Tuple<Nested<const EdgeFaceVertex>,Array<const FaceFaceEdge>>
-intersection_simplices(const SimplexTree<EV,2>& face_tree) {
-  const auto X = face_tree.X;
-  const TriangleSoup& faces = face_tree.mesh;
-  const SegmentSoup& edges = faces.segment_soup();
-  GEODE_ASSERT(face_tree.leaf_size==1);
-
-  // Find edge-face intersections
-  Nested<EdgeFaceVertex> ef_vertices; // Edge-face intersection vertices
-  {
-    // Find ef_vertices
-    struct {
-      const Ref<const SimplexTree<EV,1>> edge_tree;
-      const SimplexTree<EV,2>& face_tree;
-      const RawArray<const EV> X;
-      Array<EdgeFaceVertex> ef_vertices;
-
-      bool cull(const int ne, const int nf) const { return false; }
-
-      void leaf(const int ne, const int nf) {
-        const int edge = edge_tree->prims(ne)[0],
-                  face = face_tree.prims(nf)[0];
-        const auto ev = edge_tree->mesh->elements[edge];
-        const auto fv = face_tree.mesh->elements[face];
-        if (!(fv.contains(ev.x) || fv.contains(ev.y))) {
-          const auto e0 = Xi(ev.x), e1 = Xi(ev.y),
-                     f0 = Xi(fv.x), f1 = Xi(fv.y), f2 = Xi(fv.z);
-          if (segment_triangle_intersect(e0,e1,f0,f1,f2)) {
-            const auto c = perturbed_construct<ConstructEF>(tolerance,e0,e1,f0,f1,f2);
-            ef_vertices.append(EdgeFaceVertex(edge,face,!c.y,c.x));
-          }
-        }
+// Run body(i) for i in [0,n) on up to nt threads.  Exceptions can't escape OpenMP regions, so we stash the first.
+template<class Body> static void parallel_for(const int nt, const int n, const Body& body) {
+  ExceptionValue error;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int i=0;i<n;i++) {
+    try {
+      body(i);
+    } catch (const std::exception& e) {
+      #pragma omp critical
+      {
+        if (!error)
+          error = ExceptionValue(e);
       }
-    } helper({new_<SimplexTree<EV,1>>(edges,X,1),face_tree,X});
-    double_traverse(*helper.edge_tree,face_tree,helper);
+    }
+  }
+  if (error)
+    error.throw_();
+}
 
-    // Bucket edge face vertices by edge
-    Array<int> counts(edges.elements.size());
-    for (const auto& ef : helper.ef_vertices)
-      counts[ef.edge]++;
-    ef_vertices = Nested<EdgeFaceVertex>(counts,uninit);
-    for (const auto& ef : helper.ef_vertices)
-      ef_vertices(ef.edge,--counts[ef.edge]) = ef;
+namespace {
+// Edge-face intersection vertices found by traversing the edge and face trees.  The interval scope is set up once per
+// thread by parallel_double_traverse (see traverse_scope below).
+struct EdgeFaceVisitor {
+  const SimplexTree<EV,1>& edge_tree;
+  const SimplexTree<EV,2>& face_tree;
+  const RawArray<const EV> X;
+  Array<EdgeFaceVertex> ef_vertices;
+
+  EdgeFaceVisitor clone() const {
+    return EdgeFaceVisitor({edge_tree,face_tree,X});
   }
 
-  // Sort ef_vertices along each edge
-  for (const int e : range(edges.elements.size())) {
-    const auto e0 = Xi(edges.elements[e].x),
-               e1 = Xi(edges.elements[e].y);
+  void merge(const EdgeFaceVisitor& other) {
+    ef_vertices.extend(other.ef_vertices);
+  }
+
+  bool cull(const int ne, const int nf) const { return false; }
+
+  GEODE_NEVER_INLINE void leaf(const int ne, const int nf) {
+    const int edge = edge_tree.prims(ne)[0],
+              face = face_tree.prims(nf)[0];
+    const auto ev = edge_tree.mesh->elements[edge];
+    const auto fv = face_tree.mesh->elements[face];
+    if (!(fv.contains(ev.x) || fv.contains(ev.y))) {
+      const auto e0 = Xi(ev.x), e1 = Xi(ev.y),
+                 f0 = Xi(fv.x), f1 = Xi(fv.y), f2 = Xi(fv.z);
+      if (segment_triangle_intersect(e0,e1,f0,f1,f2)) {
+        const auto c = perturbed_construct<ConstructEF>(tolerance,e0,e1,f0,f1,f2);
+        ef_vertices.append(EdgeFaceVertex(edge,face,!c.y,c.x));
+      }
+    }
+  }
+};
+}
+template<> struct traverse_mergeable<EdgeFaceVisitor> : public mpl::true_ {};
+template<> struct traverse_scope<EdgeFaceVisitor> { typedef IntervalScope type; };
+
+// Find all edge-face intersections between two trees, traversing independent pieces of the trees in parallel.
+// The pieces are concatenated in order, so the result depends on thread count only through the order within each
+// edge, which callers fix by sorting.  Edge and face indices are tree primitives.
+static Array<EdgeFaceVertex>
+find_edge_face_vertices(const SimplexTree<EV,1>& edge_tree, const SimplexTree<EV,2>& face_tree, const int nt) {
+  EdgeFaceVisitor visitor({edge_tree,face_tree,face_tree.X});
+  parallel_double_traverse(edge_tree,face_tree,visitor,nt);
+  return visitor.ef_vertices;
+}
+
+// Sort ef_vertices along each edge in the given range
+GEODE_NEVER_INLINE static void
+sort_edge_face_vertices(RawArray<const EV> X, RawArray<const Vector<int,3>> faces, RawArray<const Vector<int,2>> edges,
+                        Nested<EdgeFaceVertex> ef_vertices, const Range<int> range) {
+  IntervalScope scope;
+  for (const int e : range) {
+    const auto e0 = Xi(edges[e].x),
+               e1 = Xi(edges[e].y);
     struct {
       RawArray<const Vector<int,3>> faces;
       RawArray<const EV> X;
@@ -799,9 +829,87 @@ intersection_simplices(const SimplexTree<EV,2>& face_tree) {
                                   i0,f0.x,f0.y,f0.z,i1,f1.x,f1.y,f1.z));
         return segment_triangle_intersections_ordered(e0,e1,FX(f0),FX(f1));
       }
-    } less({faces.elements,X,e0,e1,iv(e1)-iv(e0)});
+    } less({faces,X,e0,e1,iv(e1)-iv(e0)});
     sort(ef_vertices[e],less);
   }
+}
+
+static Array<const FaceFaceEdge>
+face_face_edges(const TriangleSoup& faces, RawArray<const EV> X, Nested<const EdgeFaceVertex> ef_vertices);
+
+// Find all intersection vertices and edges.  If active is nonempty, only intersections between active faces
+// and edges of active faces are considered; the caller guarantees that no others exist.
+static Tuple<Nested<const EdgeFaceVertex>,Array<const FaceFaceEdge>>
+intersection_simplices(const SimplexTree<EV,2>& face_tree, RawArray<const bool> active, const int nt) {
+  const auto X = face_tree.X;
+  const TriangleSoup& faces = face_tree.mesh;
+  const SegmentSoup& edges = faces.segment_soup();
+  GEODE_ASSERT(face_tree.leaf_size==1);
+
+  // Find edge-face intersections
+  Nested<EdgeFaceVertex> ef_vertices; // Edge-face intersection vertices
+  {
+    // If we're restricted to active faces, build trees over active faces and their edges only.
+    // Primitives of these trees are mapped back to the full mesh via face_ids and edge_ids.
+    Array<int> face_ids, edge_ids;
+    if (active.size()) {
+      GEODE_ASSERT(active.size()==faces.elements.size());
+      const auto face_edges = faces.triangle_edges();
+      Array<bool> edge_active(edges.elements.size());
+      for (const int f : range(active.size()))
+        if (active[f]) {
+          face_ids.append(f);
+          for (const int e : face_edges[f])
+            edge_active[e] = true;
+        }
+      for (const int e : range(edge_active.size()))
+        if (edge_active[e])
+          edge_ids.append(e);
+    }
+    const auto search_tree = active.size() ? new_<const SimplexTree<EV,2>>(
+                                               *new_<const TriangleSoup>(faces.elements.subset(face_ids).copy()),X,1)
+                                           : ref(face_tree);
+    const auto edge_tree = new_<const SimplexTree<EV,1>>(
+      active.size() ? *new_<const SegmentSoup>(edges.elements.subset(edge_ids).copy()) : edges,X,1);
+
+    // Find ef_vertices.  The order within each edge is fixed by sorting below, so the result does not depend on
+    // thread count.
+    const auto found = find_edge_face_vertices(edge_tree,search_tree,nt);
+    if (active.size())
+      for (auto& ef : found) {
+        ef.edge = edge_ids[ef.edge];
+        ef.face = face_ids[ef.face];
+      }
+
+    // Bucket edge face vertices by edge
+    Array<int> counts(edges.elements.size());
+    for (const auto& ef : found)
+      counts[ef.edge]++;
+    ef_vertices = Nested<EdgeFaceVertex>(counts,uninit);
+    for (const auto& ef : found)
+      ef_vertices(ef.edge,--counts[ef.edge]) = ef;
+  }
+
+  // Sort ef_vertices along each edge
+  {
+    const int chunks = min(edges.elements.size(),16*nt);
+    parallel_for(nt,chunks,[&](const int c) {
+      sort_edge_face_vertices(X,faces.elements,edges.elements,ef_vertices,
+                              partition_loop(edges.elements.size(),chunks,c));
+    });
+  }
+
+  // Find intersection edges
+  const auto ff_edges = face_face_edges(faces,X,ef_vertices);
+
+  // Simplices computed!
+  return tuple(ef_vertices.const_(),ff_edges);
+}
+
+// Find all intersection edges given the edge-face intersection vertices
+static Array<const FaceFaceEdge>
+face_face_edges(const TriangleSoup& faces, RawArray<const EV> X, Nested<const EdgeFaceVertex> ef_vertices) {
+  const SegmentSoup& edges = faces.segment_soup();
 
   // Map from original vertices to faces
   const auto incident_faces = faces.incident_elements();
@@ -879,9 +987,7 @@ intersection_simplices(const SimplexTree<EV,2>& face_tree) {
                                   cross(IV(X[b.y])-IV(X[b.x]),IV(X[b.z])-IV(X[b.x])),
                                   Xi2(e.y)-Xi2(e.x))) >= 0);
     }
-
-  // Simplices computed!
-  return tuple(ef_vertices.const_(),ff_edges.const_());
+  return ff_edges;
 }
 
 namespace {
@@ -950,10 +1056,39 @@ struct DepthUnionFind {
     }
   }
 };
+
+// A log of DepthUnionFind operations recorded while retriangulating a block of faces, so that blocks can be processed
+// in parallel and then replayed in order.  Indices at or above base refer to cut faces, relative to the block start.
+struct DepthMerges {
+  int base, size;
+  Array<Vector<int,3>> merges; // i,j,depth(j)-depth(i)
+
+  DepthMerges(const int base)
+    : base(base), size(0) {}
+
+  int append() {
+    return extend(1);
+  }
+
+  int extend(const int n) {
+    size += n;
+    return base+size-n;
+  }
+
+  void merge(const int i, const int j, const int dij) {
+    merges.append(vec(i,j,dij));
+  }
+
+  void replay(DepthUnionFind& union_find) const {
+    const int shift = union_find.extend(size)-base;
+    for (const auto& m : merges)
+      union_find.merge(m.x+(m.x>=base?shift:0),m.y+(m.y>=base?shift:0),m.z);
+  }
+};
 }
 
 template<int up> static void
-retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &original_face_index, DepthUnionFind* const union_find,
+retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &original_face_index, DepthMerges* const merges,
                    const int face, Vector<int,3> e, RawArray<int> interior,
                    RawArray<const FaceFaceEdge> ff_edges, RawArray<const int> ffs) {
   // Sort vertices in upwards order, keeping track of permutation parity.
@@ -1058,9 +1193,9 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
                          vertices[v.z]));
   }
 
-  if (union_find) {
+  if (merges) {
     // Absorb depth information at the start of all three original edges
-    const int base = union_find->extend(mesh->n_faces());
+    const int base = merges->extend(mesh->n_faces());
     const auto h = vec(mesh->halfedge(lo),
                        mesh->halfedge(vy),
                        mesh->halfedge(hi));
@@ -1068,7 +1203,7 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
     for (int i=0;i<3;i++) {
       const int j = (i+shift+3)%3,
                 k = (j+shift+3)%3;
-      union_find->merge(e[i],base+mesh->face(S.edges[e[i]].x==v[k] ? mesh->left(h[k]) : mesh->reverse(h[j])).id,0);
+      merges->merge(e[i],base+mesh->face(S.edges[e[i]].x==v[k] ? mesh->left(h[k]) : mesh->reverse(h[j])).id,0);
     }
 
     // Absorb depth information in the interior of the cut triangle.
@@ -1086,12 +1221,12 @@ retriangulate_face(State& S, Array<Vector<int,3>>& cut_faces, Array<int> &origin
                       start = ff_edges[ff].nodes.x,
                       face2 = ff_edges[ff].faces.x == face ? ff_edges[ff].faces.y : ff_edges[ff].faces.x;
             const int ddepth = S.depth_weight[face2];
-            union_find->merge(base+f0.id,base+f1.id,flip?-ddepth:ddepth);
+            merges->merge(base+f0.id,base+f1.id,flip?-ddepth:ddepth);
             if (   start==P.vertices[mesh->src(e)]
                 || start==P.vertices[mesh->dst(e)])
-              union_find->merge(ff_base+ff,base+f0.id,flip?ddepth:0);
+              merges->merge(ff_base+ff,base+f0.id,flip?ddepth:0);
           } else {
-            union_find->merge(base+f0.id,base+f1.id,0);
+            merges->merge(base+f0.id,base+f1.id,0);
           }
         }
       }
@@ -1109,68 +1244,220 @@ static inline bool oriented_with_x(const P p0, const P p1, const P p2) {
   return perturbed_predicate<OrientedWithX>(p0,p1,p2);
 }}
 
-// Retriangulate each face w.r.t. the other faces which cut it
-static Tuple<Array<const FaceFaceFaceVertex>,Array<Vector<int,3>>,Array<int>>
-retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_weight, DepthUnionFind* const union_find,
-                   Nested<const EdgeFaceVertex> ef_vertices, RawArray<const FaceFaceEdge> ff_edges) {
-  GEODE_ASSERT(face_tree.leaf_size==1);
-  const auto X = face_tree.X;
-  const TriangleSoup& faces = face_tree.mesh;
+namespace {
+// Faces in a contiguous block, retriangulated independently of other blocks.  Face-face-face vertices are numbered in
+// order of creation within the block, and renumbered globally when blocks are concatenated in order.
+struct RetriangulatedBlock {
+  Array<FaceFaceFaceVertex> fff_vertices;
+  Hashtable<Vector<int,3>,int> faces_to_fff;
+  Array<Vector<int,3>> cut_faces;
+  Array<int> original_face_index;
+  DepthMerges merges;
+  Array<Vector<int,2>> offsets; // Start of each face's cut faces and merges
+
+  RetriangulatedBlock(const int base)
+    : merges(base) {}
+
+  void clean_memory() {
+    fff_vertices.clean_memory();
+    faces_to_fff.clean_memory();
+    cut_faces.clean_memory();
+    original_face_index.clean_memory();
+    merges.merges.clean_memory();
+    offsets.clean_memory();
+  }
+};
 
-  // Group edge-face vertices by face
-  Nested<int> face_to_ef;
-  {
-    Array<int> counts(faces.elements.size());
-    for (const auto& ef : ef_vertices.flat)
-      counts[ef.face]++;
-    face_to_ef = Nested<int>(counts,uninit);
-    for (const int i : range(ef_vertices.flat.size())) {
-      const int f = ef_vertices.flat[i].face;
-      face_to_ef(f,--counts[f]) = i;
-    }
+// Let e1,e2,e3 be two infinitesimals, with 1 >> e1 >> e2 >> e3.  We will trace a ray from
+//
+//   q = v0+e1*(v1-v0)+e2*(v2-v0)+e3*normal
+//
+// to infinity along the positive x axis.  Away from an infinitesimal neighborhood
+// of v0, this is equivalent to a ray from v0 to infinity, so any triangle that does
+// not touch v0 can be handled accordingly.  Triangles that touch v0 must be handled
+// specially.  By the choice of q, the depth that we compute will be accurate
+// immediately outside edge v01.  Note that it is *not* necessarily correct anywhere
+// else, since triangle v012 may be cut arbitrarily.
+struct RayVisitor {
+  const SimplexTree<EV,2>& face_tree;
+  RawArray<const EV> X;
+  const RawArray<const int> depth_weight;
+  const P v0,v1,v2;
+  const bool orient_v012; // orient_with_x(v0,v1,v2)
+  const Quantized limit; // Ignore boxes entirely beyond this x coordinate
+  int depth;
+
+  RayVisitor(const SimplexTree<EV,2>& face_tree, const int face, const Vector<int,3> v, const RawArray<const int> depth_weight,
+             const Quantized limit=inf)
+    : face_tree(face_tree)
+    , X(face_tree.X)
+    , depth_weight(depth_weight)
+    , v0(Xi(v.x))
+    , v1(Xi(v.y))
+    , v2(Xi(v.z))
+    , orient_v012(oriented_with_x(v0,v1,v2))
+    , limit(limit)
+    , depth(0) {}
+
+  bool cull(const int n) const {
+    const auto box = face_tree.boxes[n];
+    return                        box.max.x<v0.value().x || limit<box.min.x
+           || v0.value().y<box.min.y || box.max.y<v0.value().y
+           || v0.value().z<box.min.z || box.max.z<v0.value().z;
   }
 
-  // Group face-face edges by face
-  Nested<int> face_to_ff;
-  {
-    Array<int> counts(faces.elements.size());
-    for (const auto& ff : ff_edges) {
-      counts[ff.faces.x]++;
-      counts[ff.faces.y]++;
-    }
-    face_to_ff = Nested<int>(counts,uninit);
-    for (const int i : range(ff_edges.size())) {
-      const auto f = ff_edges[i].faces;
-      face_to_ff(f.x,--counts[f.x]) = i;
-      face_to_ff(f.y,--counts[f.y]) = i;
+  void leaf(const int n) {
+    const int face_idx = face_tree.prims(n)[0];
+    const auto f = face_tree.mesh->elements[face_idx];
+    const P p0 = Xi(f.x),
+            p1 = Xi(f.y),
+            p2 = Xi(f.z);
+    const bool with_x = oriented_with_x(p0,p1,p2);
+    if (!f.contains(v0.seed())) {
+      // Triangle doesn't touch v0, so computation is infinitesimal free
+      if (   with_x != tetrahedron_oriented(p0,p1,p2,v0)
+          && with_x == oriented_with_x(v0,p0,p1)
+          && with_x == oriented_with_x(v0,p1,p2)
+          && with_x == oriented_with_x(v0,p2,p0))
+        goto hit;
+    } else if (!f.contains(v1.seed())) {
+      // Triangle shares v0 but not v1.  It suffices to consider q = v0+e1*(v1-v0).  The
+      // computation is equivalent to firing a ray from v1 -> v1+inf*x against the partially
+      // infinite triangle p0+a(p1-p0)+b(p2-p0), {a,b}>=0, as can be seen by scaling around
+      // v0 by 1/e1.  This is the same as the no v0 case above except that we do not check
+      // against the edge p12, which is now infinitely far away.
+      if (   with_x != tetrahedron_oriented(p0,p1,p2,v1)
+          && (f.z==v0.seed() || with_x==oriented_with_x(v1,p0,p1))
+          && (f.x==v0.seed() || with_x==oriented_with_x(v1,p1,p2))
+          && (f.y==v0.seed() || with_x==oriented_with_x(v1,p2,p0)))
+        goto hit;
+    } else if (!f.contains(v2.seed())) {
+      // Triangle shares v0,v1 but not v2.  We must consider the full q = v0+e1*(v1-v0)+e2*(v2-v0).
+      // Shift v0 to 0, so that q = e1*v1+e2*v2.
+      if (   with_x == (orient_v012 ^ flipped_in(vec(v0.seed(),v1.seed()),f))
+          && with_x != tetrahedron_oriented(p0,p1,p2,v2))
+        goto hit;
+    } else {
+      // If f contains v0,v1,v2, we're the start triangle, and we hit iff we're oriented against x.
+      if (!with_x)
+        goto hit;
     }
+    return;
+    hit:
+    depth += depth_weight[face_idx] * (with_x ? 1 : -1);
   }
+};
 
-  // Grab edge information
-  const SegmentSoup& edges = faces.segment_soup();
-  const auto face_edges = faces.triangle_edges();
+// Approximate weighted generalized winding numbers of a face soup, using exact triangle solid angles near the query
+// and first order (dipole plus first moment) far field expansions elsewhere (Barill et al., "Fast winding numbers for
+// soups and clouds").  For a closed soup the result is the depth of the query point, so rounding gives the exact
+// answer unless the error is large.  The error is not certified: a rigorous bound on the far field truncation is too
+// loose to be useful at any reasonable opening distance, which is why approximate ray depths are opt-in.  Each node
+// stores its area weighted center, the sum of its weighted area vectors, the first moment of the area vectors about
+// the center, and a radius bounding the node's box around the center.
+struct WindingTree {
+  const SimplexTree<EV,2>& tree;
+  const RawArray<const int> depth_weight;
+  Array<TV> center, area;
+  Array<Matrix<real,3>> moment;
+  Array<real> radius;
+  static constexpr real beta = 2; // Nodes are far if they are beta radii away
 
-  // Newly created faces
-  Array<Vector<int,3>> cut_faces;
-  Array<int> original_face_index;
+  WindingTree(const SimplexTree<EV,2>& tree, RawArray<const int> depth_weight)
+    : tree(tree)
+    , depth_weight(depth_weight)
+    , center(tree.nodes(),uninit)
+    , area(tree.nodes(),uninit)
+    , moment(tree.nodes(),uninit)
+    , radius(tree.nodes(),uninit) {
+    const auto X = tree.X;
+    Array<real> mass(tree.nodes(),uninit);
+    for (int n=tree.nodes()-1;n>=0;n--) {
+      TV c, a;
+      Matrix<real,3> M;
+      real m = 0;
+      if (tree.is_leaf(n)) {
+        for (const int t : tree.prims(n)) {
+          const auto f = tree.mesh->elements[t];
+          const real mt = magnitude(cross(X[f.y]-X[f.x],X[f.z]-X[f.x]));
+          c += mt*(X[f.x]+X[f.y]+X[f.z]);
+          m += mt;
+        }
+        c = m ? c/(3*m) : tree.boxes[n].center();
+        for (const int t : tree.prims(n)) {
+          const auto f = tree.mesh->elements[t];
+          const TV at = depth_weight[t]*cross(X[f.y]-X[f.x],X[f.z]-X[f.x])/2;
+          a += at;
+          M += outer_product((X[f.x]+X[f.y]+X[f.z])/3-c,at);
+        }
+      } else {
+        const int c0 = 2*n+1, c1 = 2*n+2;
+        m = mass[c0]+mass[c1];
+        c = m ? (mass[c0]*center[c0]+mass[c1]*center[c1])/m : tree.boxes[n].center();
+        a = area[c0]+area[c1];
+        M = moment[c0]+outer_product(center[c0]-c,area[c0])
+          + moment[c1]+outer_product(center[c1]-c,area[c1]);
+      }
+      const auto& box = tree.boxes[n];
+      mass[n] = m;
+      center[n] = c;
+      area[n] = a;
+      moment[n] = M;
+      radius[n] = box.empty() ? 0 : magnitude(TV::componentwise_max(c-box.min,box.max-c));
+    }
+  }
 
-  // Depth and connectivity information for (1) original edges, (2) ff edges, and (3) cut faces, indexed back to back.
-  // The depth of an edge is defined as the depth of its infinitesimal starting section in the cut mesh.
-  // In all cases, the depths are for slightly outside the feature in question.  For faces this means a slight
-  // motion along the normal, for original edges a slight motion along the edge normal (a vector with positive
-  // dot product with both incident triangles), and for ff edges a motion so that we're slightly above both of
-  // the intersecting triangles.
-  if (union_find) {
-    GEODE_ASSERT(!union_find->info.size());
-    union_find->extend(edges.elements.size()+ff_edges.size());
+  real operator()(const TV q) const {
+    const auto X = tree.X;
+    const int internal = tree.leaves.lo;
+    RawStack<int> stack(GEODE_RAW_ALLOCA(tree.depth,int));
+    real w = 0;
+    stack.push(0);
+    while (stack.size()) {
+      const int n = stack.pop();
+      const TV r = center[n]-q;
+      const real r2 = sqr_magnitude(r);
+      if (r2 > sqr(beta*radius[n])) {
+        // Far field: gradient and hessian of the Green's function contracted against the expansion
+        const real ir2 = 1/r2,
+                   ir3 = sqrt(ir2)*ir2;
+        const auto& M = moment[n];
+        w += ir3*(dot(r,area[n])+M.trace()-3*ir2*dot(r,M*r));
+      } else if (n < internal) {
+        stack.push(2*n+1);
+        stack.push(2*n+2);
+      } else {
+        for (const int t : tree.prims(n)) {
+          // Exact solid angle (Van Oosterom and Strackee)
+          const auto f = tree.mesh->elements[t];
+          const TV a = X[f.x]-q, b = X[f.y]-q, c = X[f.z]-q;
+          const real la = magnitude(a), lb = magnitude(b), lc = magnitude(c);
+          w += 2*depth_weight[t]*atan2(det(a,b,c),la*lb*lc+dot(a,b)*lc+dot(a,c)*lb+dot(b,c)*la);
+        }
+      }
+    }
+    return w/(4*pi);
   }
+};
+}
 
-  // Retriangulate each face
-  Array<FaceFaceFaceVertex> fff_vertices;
-  Hashtable<Vector<int,3>,int> faces_to_fff;
-  State S(X,ef_vertices,fff_vertices,faces_to_fff,faces.elements,edges.elements,depth_weight);
-  for (const int f : range(faces.elements.size())) {
+// Retriangulate the given faces in order, recording new vertices, faces, and depth merges in block
+template<class Faces> GEODE_NEVER_INLINE static void
+retriangulate_block(RetriangulatedBlock& block, const SimplexTree<EV,2>& face_tree, RawArray<const int> depth_weight,
+                    const bool depths, Nested<const EdgeFaceVertex> ef_vertices, RawArray<const FaceFaceEdge> ff_edges,
+                    Nested<int> face_to_ef, Nested<const int> face_to_ff, RawArray<const Vector<int,3>> face_edges,
+                    const Faces& range) {
+  IntervalScope scope;
+  const auto X = face_tree.X;
+  const TriangleSoup& faces = face_tree.mesh;
+  const SegmentSoup& edges = faces.segment_soup();
+  auto& cut_faces = block.cut_faces;
+  auto& original_face_index = block.original_face_index;
+  const auto merges = depths ? &block.merges : 0;
+  State S(X,ef_vertices,block.fff_vertices,block.faces_to_fff,faces.elements,edges.elements,depth_weight);
+  for (const int f : range) {
     const auto v = faces.elements[f];
+    block.offsets.append(vec(cut_faces.size(),block.merges.merges.size()));
 
     // Find the three edges bounding this face
     const auto fe = face_edges[f]; // v01,v12,v20
@@ -1183,11 +1470,11 @@ retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_we
                          && !ef_vertices.size(e.z)) {
       original_face_index.append(f);
       cut_faces.append(v);
-      if (union_find) {
-        const int i = union_find->append();
-        union_find->merge(i,e.x,0);
-        union_find->merge(i,e.y,0);
-        union_find->merge(i,e.z,0);
+      if (merges) {
+        const int i = merges->append();
+        merges->merge(i,e.x,0);
+        merges->merge(i,e.y,0);
+        merges->merge(i,e.z,0);
       }
       continue;
     }
@@ -1196,104 +1483,218 @@ retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_we
     // since it does not affect correctness.
     const int up = bounding_box(X[v.x],X[v.y],X[v.z]).sizes().dominant_axis();
     const auto ffs = face_to_ff[f];
-    if (up==0)      retriangulate_face<0>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
-    else if (up==1) retriangulate_face<1>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
-    else            retriangulate_face<2>(S,cut_faces,original_face_index,union_find,f,e,interior,ff_edges,ffs);
+    if (up==0)      retriangulate_face<0>(S,cut_faces,original_face_index,merges,f,e,interior,ff_edges,ffs);
+    else if (up==1) retriangulate_face<1>(S,cut_faces,original_face_index,merges,f,e,interior,ff_edges,ffs);
+    else            retriangulate_face<2>(S,cut_faces,original_face_index,merges,f,e,interior,ff_edges,ffs);
   }
+}
 
-  // Add one union-find node at infinity, and fire rays until everything is connected to it
-  if (union_find) {
-    const int infinity = union_find->append();
-    const auto incident_faces = faces.incident_elements();
-    for (const int f : range(faces.elements.size())) {
-      const auto e = face_edges[f];
-      if (union_find->same(infinity,e.x))
-        continue;
-      // Organize the face so that that v0 is the start of edge e.x.
-      // We will not use the orientation of v0,v1,v2 in the following, so we don't keep track.
-      auto v = faces.elements[f];
-      if (edges.elements[e.x].x != v.x)
-        swap(v.x,v.y);
-      assert(edges.elements[e.x] == v.xy());
-      // Let e1,e2,e3 be two infinitesimals, with 1 >> e1 >> e2 >> e3.  We will trace a ray from
-      //
-      //   q = v0+e1*(v1-v0)+e2*(v2-v0)+e3*normal
-      //
-      // to infinity along the positive x axis.  Away from an infinitesimal neighborhood
-      // of v0, this is equivalent to a ray from v0 to infinity, so any triangle that does
-      // not touch v0 can be handled accordingly.  Triangles that touch v0 must be handled
-      // specially.  By the choice of q, the depth that we compute will be accurate
-      // immediately outside edge v01.  Note that it is *not* necessarily correct anywhere
-      // else, since triangle v012 may be cut arbitrarily.
-      struct Visitor {
-        const SimplexTree<EV,2>& face_tree;
-        RawArray<const EV> X;
-        const RawArray<const int> depth_weight;
-        const P v0,v1,v2;
-        const bool orient_v012; // orient_with_x(v0,v1,v2)
-        int depth;
-
-        Visitor(const SimplexTree<EV,2>& face_tree, const int face, const Vector<int,3> v, const RawArray<const int> depth_weight)
-          : face_tree(face_tree)
-          , X(face_tree.X)
-          , depth_weight(depth_weight)
-          , v0(Xi(v.x))
-          , v1(Xi(v.y))
-          , v2(Xi(v.z))
-          , orient_v012(oriented_with_x(v0,v1,v2))
-          , depth(0) {}
-
-        bool cull(const int n) const {
-          const auto box = face_tree.boxes[n];
-          return                        box.max.x<v0.value().x
-                 || v0.value().y<box.min.y || box.max.y<v0.value().y
-                 || v0.value().z<box.min.z || box.max.z<v0.value().z;
-        }
+namespace {
+// Collect the x extents of leaf boxes touching the line through p along x, between p.x and p.x+length
+struct LineVisitor {
+  const BoxTree<EV>& tree;
+  const EV p;
+  const Quantized length;
+  Array<Vector<Quantized,2>> extents;
+
+  LineVisitor(const BoxTree<EV>& tree, const EV p, const Quantized length)
+    : tree(tree), p(p), length(length) {}
+
+  bool cull(const int n) const {
+    const auto box = tree.boxes[n];
+    return    box.max.x<p.x || p.x+length<box.min.x
+           || p.y<box.min.y || box.max.y<p.y
+           || p.z<box.min.z || box.max.z<p.z;
+  }
 
-        void leaf(const int n) {
-          const int face_idx = face_tree.prims(n)[0];
-          const auto f = face_tree.mesh->elements[face_idx];
-          const P p0 = Xi(f.x),
-                  p1 = Xi(f.y),
-                  p2 = Xi(f.z);
-          const bool with_x = oriented_with_x(p0,p1,p2);
-          if (!f.contains(v0.seed())) {
-            // Triangle doesn't touch v0, so computation is infinitesimal free
-            if (   with_x != tetrahedron_oriented(p0,p1,p2,v0)
-                && with_x == oriented_with_x(v0,p0,p1)
-                && with_x == oriented_with_x(v0,p1,p2)
-                && with_x == oriented_with_x(v0,p2,p0))
-              goto hit;
-          } else if (!f.contains(v1.seed())) {
-            // Triangle shares v0 but not v1.  It suffices to consider q = v0+e1*(v1-v0).  The
-            // computation is equivalent to firing a ray from v1 -> v1+inf*x against the partially
-            // infinite triangle p0+a(p1-p0)+b(p2-p0), {a,b}>=0, as can be seen by scaling around
-            // v0 by 1/e1.  This is the same as the no v0 case above except that we do not check
-            // against the edge p12, which is now infinitely far away.
-            if (   with_x != tetrahedron_oriented(p0,p1,p2,v1)
-                && (f.z==v0.seed() || with_x==oriented_with_x(v1,p0,p1))
-                && (f.x==v0.seed() || with_x==oriented_with_x(v1,p1,p2))
-                && (f.y==v0.seed() || with_x==oriented_with_x(v1,p2,p0)))
-              goto hit;
-          } else if (!f.contains(v2.seed())) {
-            // Triangle shares v0,v1 but not v2.  We must consider the full q = v0+e1*(v1-v0)+e2*(v2-v0).
-            // Shift v0 to 0, so that q = e1*v1+e2*v2.
-            if (   with_x == (orient_v012 ^ flipped_in(vec(v0.seed(),v1.seed()),f))
-                && with_x != tetrahedron_oriented(p0,p1,p2,v2))
-              goto hit;
-          } else {
-            // If f contains v0,v1,v2, we're the start triangle, and we hit iff we're oriented against x.
-            if (!with_x)
-              goto hit;
-          }
-          return;
-          hit:
-          depth += depth_weight[face_idx] * (with_x ? 1 : -1);
+  void leaf(const int n) {
+    const auto box = tree.boxes[n];
+    extents.append(vec(box.min.x,box.max.x));
+  }
+};
+}
+
+// Find x > p.x such that no leaf box touching the line through p straddles x, searching outwards from p.  Returns
+// inf if no such gap exists short of the far end of the tree.
+static Quantized ray_gap(const BoxTree<EV>& tree, const EV p, Quantized length) {
+  const auto end = tree.bounding_box().max.x;
+  for (;p.x+length<end;length *= 4) {
+    LineVisitor visitor(tree,p,length);
+    single_traverse(tree,visitor);
+    auto& extents = visitor.extents;
+    sort(extents,[](const Vector<Quantized,2> a, const Vector<Quantized,2> b) { return a.x<b.x; });
+    Quantized lo = p.x;
+    for (const auto& e : extents) {
+      if (lo < e.x)
+        return (lo+e.x)/2;
+      lo = max(lo,e.y);
+    }
+    if (lo < p.x+length)
+      return (lo+p.x+length)/2;
+  }
+  return inf;
+}
+
+// Compute ray depths for the given faces.  If a winding tree is given, each ray is cut short at the first gap between
+// face boxes along its path, and the depth at the gap is computed approximately and rounded.  Since no face straddles
+// the gap, the exact part of the ray is unaffected.  If the approximation is not close to an integer, we fire the
+// whole ray instead.  The closeness test is a heuristic, so this is used only if approximate depths are requested.
+
+GEODE_NEVER_INLINE static void
+fire_rays(const SimplexTree<EV,2>& face_tree, const WindingTree* winding, RawArray<const int> depth_weight,
+          RawArray<const Vector<int,3>> face_edges, RawArray<const int> ray_faces, RawArray<int> ray_depths) {
+  IntervalScope scope;
+  const TriangleSoup& faces = face_tree.mesh;
+  const SegmentSoup& edges = faces.segment_soup();
+  const auto X = face_tree.X;
+  for (const int i : range(ray_faces.size())) {
+    const int f = ray_faces[i];
+    const auto e = face_edges[f];
+    // Organize the face so that that v0 is the start of edge e.x.
+    // We will not use the orientation of v0,v1,v2 in the following, so we don't keep track.
+    auto v = faces.elements[f];
+    if (edges.elements[e.x].x != v.x)
+      swap(v.x,v.y);
+    assert(edges.elements[e.x] == v.xy());
+    if (winding) {
+      const auto p = X[v.x];
+      const auto gap = ray_gap(face_tree,p,4*bounding_box(X[v.x],X[v.y],X[v.z]).sizes().max()+1);
+      if (gap < inf) {
+        const real w = (*winding)(vec(gap,p.y,p.z));
+        const int n = int(round(w));
+        if (abs(w-n) < .1) {
+          RayVisitor visitor(face_tree,f,v,depth_weight,gap);
+          single_traverse(face_tree,visitor);
+          ray_depths[i] = visitor.depth+n;
+          continue;
         }
-      } visitor(face_tree,f,v,depth_weight);
-      single_traverse(face_tree,visitor);
-      union_find->merge(infinity,e.x,visitor.depth);
+      }
+    }
+    RayVisitor visitor(face_tree,f,v,depth_weight);
+    single_traverse(face_tree,visitor);
+    ray_depths[i] = visitor.depth;
+  }
+}
+
+// Group edge-face vertices by face
+static Nested<int> edge_face_vertices_by_face(const int nf, Nested<const EdgeFaceVertex> ef_vertices) {
+  Array<int> counts(nf);
+  for (const auto& ef : ef_vertices.flat)
+    counts[ef.face]++;
+  Nested<int> face_to_ef(counts,uninit);
+  for (const int i : range(ef_vertices.flat.size())) {
+    const int f = ef_vertices.flat[i].face;
+    face_to_ef(f,--counts[f]) = i;
+  }
+  return face_to_ef;
+}
+
+// Group face-face edges by face
+static Nested<int> face_face_edges_by_face(const int nf, RawArray<const FaceFaceEdge> ff_edges) {
+  Array<int> counts(nf);
+  for (const auto& ff : ff_edges) {
+    counts[ff.faces.x]++;
+    counts[ff.faces.y]++;
+  }
+  Nested<int> face_to_ff(counts,uninit);
+  for (const int i : range(ff_edges.size())) {
+    const auto f = ff_edges[i].faces;
+    face_to_ff(f.x,--counts[f.x]) = i;
+    face_to_ff(f.y,--counts[f.y]) = i;
+  }
+  return face_to_ff;
+}
+
+// Retriangulate each face w.r.t. the other faces which cut it
+static Tuple<Array<const FaceFaceFaceVertex>,Array<Vector<int,3>>,Array<int>>
+retriangulate_soup(const SimplexTree<EV,2>& face_tree, Array<const int> depth_weight, DepthUnionFind* const union_find,
+                   Nested<const EdgeFaceVertex> ef_vertices, RawArray<const FaceFaceEdge> ff_edges, const int nt,
+                   const bool approximate_depths) {
+  GEODE_ASSERT(face_tree.leaf_size==1);
+  const auto X = face_tree.X;
+  const TriangleSoup& faces = face_tree.mesh;
+  const int nf = faces.elements.size();
+
+  // Group edge-face vertices and face-face edges by face
+  const auto face_to_ef = edge_face_vertices_by_face(nf,ef_vertices);
+  const Nested<const int> face_to_ff = face_face_edges_by_face(nf,ff_edges);
+
+  // Grab edge information
+  const SegmentSoup& edges = faces.segment_soup();
+  const auto face_edges = faces.triangle_edges();
+
+  // Newly created faces
+  Array<Vector<int,3>> cut_faces;
+  Array<int> original_face_index;
+
+  // Depth and connectivity information for (1) original edges, (2) ff edges, and (3) cut faces, indexed back to back.
+  // The depth of an edge is defined as the depth of its infinitesimal starting section in the cut mesh.
+  // In all cases, the depths are for slightly outside the feature in question.  For faces this means a slight
+  // motion along the normal, for original edges a slight motion along the edge normal (a vector with positive
+  // dot product with both incident triangles), and for ff edges a motion so that we're slightly above both of
+  // the intersecting triangles.
+  const int base = edges.elements.size()+ff_edges.size();
+  if (union_find) {
+    GEODE_ASSERT(!union_find->info.size());
+    union_find->extend(base);
+  }
+
+  // Retriangulate each face.  Blocks of faces are processed in parallel, then concatenated in order so that
+  // face-face-face vertices and depth merges are numbered exactly as in a serial pass.
+  const int blocks = min(nf,16*nt);
+  vector<RetriangulatedBlock> block;
+  block.reserve(blocks);
+  for (int b=0;b<blocks;b++)
+    block.emplace_back(base);
+  parallel_for(nt,blocks,[&](const int b) {
+    retriangulate_block(block[b],face_tree,depth_weight,union_find!=0,ef_vertices,ff_edges,face_to_ef,face_to_ff,
+                        face_edges,partition_loop(nf,blocks,b));
+  });
+  Array<FaceFaceFaceVertex> fff_vertices;
+  Hashtable<Vector<int,3>,int> faces_to_fff;
+  const int nn = X.size()+ef_vertices.flat.size();
+  for (auto& B : block) {
+    // Map block local face-face-face vertices to global indices, keeping the first copy of each
+    Array<int> fff_map(B.fff_vertices.size(),uninit);
+    for (const int i : range(B.fff_vertices.size())) {
+      const auto& v = B.fff_vertices[i];
+      const int n = fff_vertices.size();
+      fff_map[i] = faces_to_fff.get_or_insert(v.faces.sorted(),n);
+      if (fff_map[i] == n)
+        fff_vertices.append(v);
+    }
+    for (auto& f : B.cut_faces)
+      for (auto& v : f)
+        if (v >= nn)
+          v = nn+fff_map[v-nn];
+    cut_faces.extend(B.cut_faces);
+    original_face_index.extend(B.original_face_index);
+    if (union_find)
+      B.merges.replay(*union_find);
+    B.clean_memory();
+  }
+
+  // Add one union-find node at infinity, and fire rays until everything is connected to it.  Components other than
+  // infinity are only ever merged with infinity, so we fire one ray from the first face of each component, which is
+  // exactly the set of rays a serial pass would fire.
+  if (union_find) {
+    const int infinity = union_find->append();
+    Array<int> ray_faces;
+    {
+      Hashtable<int> seen;
+      for (const int f : range(nf))
+        if (seen.set(union_find->find(face_edges[f].x).p))
+          ray_faces.append(f);
     }
+    Array<int> ray_depths(ray_faces.size(),uninit);
+    const Unique<const WindingTree> winding(approximate_depths ? new WindingTree(face_tree,depth_weight) : 0);
+    const int chunks = min(ray_faces.size(),16*nt);
+    parallel_for(nt,chunks,[&](const int c) {
+      const auto r = partition_loop(ray_faces.size(),chunks,c);
+      fire_rays(face_tree,winding.get(),depth_weight,face_edges,ray_faces.slice(r.lo,r.hi),ray_depths.slice(r.lo,r.hi));
+    });
+    for (const int i : range(ray_faces.size()))
+      union_find->merge(infinity,face_edges[ray_faces[i]].x,ray_depths[i]);
   }
 
   // Done!
@@ -1362,19 +1763,24 @@ static void fix_loops(RawArray<Vector<int,3>> faces, Array<EV>& X, const int n,
 }
 
 Tuple<Ref<const TriangleSoup>,Array<EV>>
-exact_split_soup(const TriangleSoup& faces, Array<const EV> X, const int depth) {
+exact_split_soup(const TriangleSoup& faces, Array<const EV> X, const int depth, const int threads,
+                 const bool approximate_depths) {
   Array<int> depth_weight(faces.elements.size(), uninit);
   depth_weight.fill(1);
-  return exact_split_soup(faces, X, depth_weight, depth);
+  return exact_split_soup(faces, X, depth_weight, depth, threads, approximate_depths);
 }
 
-Tuple<Ref<const TriangleSoup>,Array<EV>>
-exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int> depth_weight, const int depth) {
+// Split a soup, considering only intersections between active faces if active is nonempty
+static Tuple<Ref<const TriangleSoup>,Array<EV>>
+split_soup_helper(const TriangleSoup& faces, Array<const EV> X, Array<const int> depth_weight, const int depth,
+                  RawArray<const bool> active, const int threads, const bool approximate_depths) {
+  GEODE_ASSERT(threads>=0);
+  const int nt = threads ? threads : omp_get_max_threads();
   IntervalScope scope;
 
   // Find ef_vertices and ff_halfedges
   const auto face_tree = new_<SimplexTree<EV,2>>(faces,X,1);
-  const auto A = intersection_simplices(face_tree);
+  const auto A = intersection_simplices(face_tree,active,nt);
   const auto ef_vertices = A.x;
   const auto ff_edges = A.y;
 
@@ -1384,7 +1790,8 @@ exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int>
     union_find.reset(new DepthUnionFind);
 
   // Retriangulate mesh and compute depths
-  const auto B = retriangulate_soup(face_tree,depth_weight,union_find.get(),ef_vertices,ff_edges);
+  const auto B = retriangulate_soup(face_tree,depth_weight,union_find.get(),ef_vertices,ff_edges,nt,
+                                    approximate_depths);
   const auto fff_vertices = B.x;
   const auto cut_faces = B.y;
   const auto original_face_index = B.z;
@@ -1421,16 +1828,646 @@ exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int>
   return tuple(new_<const TriangleSoup>(pruned_faces),Xs);
 }
 
-Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, Array<const int> depth_weight, const int depth) {
+Tuple<Ref<const TriangleSoup>,Array<EV>>
+exact_split_soup(const TriangleSoup& faces, Array<const EV> X, Array<const int> depth_weight, const int depth,
+                 const int threads, const bool approximate_depths) {
+  return split_soup_helper(faces,X,depth_weight,depth,RawArray<const bool>(),threads,approximate_depths);
+}
+
+Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, Array<const int> depth_weight, const int depth,
+                                                    const int threads, const bool approximate_depths) {
   const auto quant = quantizer(bounding_box(X));
-  const auto S = exact_split_soup(faces,amap(quant,X).copy(),depth_weight,depth);
+  const auto S = exact_split_soup(faces,amap(quant,X).copy(),depth_weight,depth,threads,approximate_depths);
   return tuple(S.x,amap(quant.inverse,S.y).copy());
 }
 
-Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, const int depth) {
+Tuple<Ref<const TriangleSoup>,Array<TV>> split_soup(const TriangleSoup& faces, Array<const TV> X, const int depth,
+                                                    const int threads, const bool approximate_depths) {
   Array<int> depth_weight(faces.elements.size(), uninit);
   depth_weight.fill(1);
-  return split_soup(faces, X, depth_weight, depth);
+  return split_soup(faces, X, depth_weight, depth, threads, approximate_depths);
+}
+
+namespace {
+// Mark faces of one operand whose boxes touch faces of the other
+struct OverlapVisitor {
+  const SimplexTree<EV,2>& tree0;
+  const SimplexTree<EV,2>& tree1;
+  RawArray<const int> faces0, faces1; // Map from tree primitives to faces of the combined soup
+  RawArray<bool> active;
+
+  bool cull(const int n0, const int n1) const { return false; }
+
+  void leaf(const int n0, const int n1) {
+    active[faces0[tree0.prims(n0)[0]]] = true;
+    active[faces1[tree1.prims(n1)[0]]] = true;
+  }
+};
+}
+
+// Faces in the given range whose boxes touch box
+static Array<int> faces_touching(RawArray<const EV> X, RawArray<const Vector<int,3>> faces, const Range<int> range,
+                                 const Box<EV> box) {
+  Array<int> touching;
+  for (const int f : range) {
+    const auto v = faces[f];
+    if (bounding_box(X[v.x],X[v.y],X[v.z]).intersects(box))
+      touching.append(f);
+  }
+  return touching;
+}
+
+// Combine two closed soups and split at the given depth, resolving intersections only where their face boxes overlap
+static Tuple<Ref<const TriangleSoup>,Array<TV>>
+soup_boolean(const TriangleSoup& faces0, RawArray<const TV> X0, const TriangleSoup& faces1, RawArray<const TV> X1,
+             const bool flip1, const int depth, const int threads) {
+  GEODE_ASSERT(faces0.nodes()<=X0.size() && faces1.nodes()<=X1.size());
+  const int n0 = X0.size(),
+            f0 = faces0.elements.size(),
+            f1 = faces1.elements.size();
+
+  // Quantize both operands together
+  const auto quant = quantizer(Box<TV>::combine(bounding_box(X0),bounding_box(X1)));
+  Array<EV> X(n0+X1.size(),uninit);
+  for (const int i : range(n0))
+    X[i] = quant(X0[i]);
+  for (const int i : range(X1.size()))
+    X[n0+i] = quant(X1[i]);
+  Array<Vector<int,3>> elements(f0+f1,uninit);
+  elements.slice(0,f0) = faces0.elements;
+  for (const int f : range(f1)) {
+    const auto v = n0+faces1.elements[f];
+    elements[f0+f] = flip1 ? vec(v.x,v.z,v.y) : v;
+  }
+  const auto faces = new_<const TriangleSoup>(elements,X.size());
+
+  // Only faces whose boxes touch a face of the other operand can be cut, since each operand is free of self
+  // intersections.  We find them by prefiltering each operand against the other's bounding box, so that trees are
+  // built only near the overlap.  Inactive faces pass through retriangulation untouched, and components made
+  // entirely of them get their depth from a single ray.
+  Array<bool> active(f0+f1);
+  {
+    IntervalScope scope;
+    const auto cand0 = faces_touching(X,elements,range(f0),bounding_box(X.slice(n0,X.size()))),
+               cand1 = faces_touching(X,elements,range(f0,f0+f1),bounding_box(X.slice(0,n0)));
+    if (cand0.size() && cand1.size()) {
+      const auto tree0 = new_<SimplexTree<EV,2>>(*new_<const TriangleSoup>(elements.subset(cand0).copy(),X.size()),X,1),
+                 tree1 = new_<SimplexTree<EV,2>>(*new_<const TriangleSoup>(elements.subset(cand1).copy(),X.size()),X,1);
+      double_traverse(*tree0,*tree1,OverlapVisitor({tree0,tree1,cand0,cand1,active}));
+    }
+  }
+
+  Array<int> depth_weight(f0+f1,uninit);
+  depth_weight.fill(1);
+  const auto S = split_soup_helper(faces,X,depth_weight,depth,active,threads,false);
+  return tuple(S.x,amap(quant.inverse,S.y).copy());
+}
+
+Tuple<Ref<const TriangleSoup>,Array<TV>>
+soup_union(const TriangleSoup& faces0, Array<const TV> X0, const TriangleSoup& faces1, Array<const TV> X1,
+           const int threads) {
+  return soup_boolean(faces0,X0,faces1,X1,false,0,threads);
+}
+
+Tuple<Ref<const TriangleSoup>,Array<TV>>
+soup_intersection(const TriangleSoup& faces0, Array<const TV> X0, const TriangleSoup& faces1, Array<const TV> X1,
+                  const int threads) {
+  return soup_boolean(faces0,X0,faces1,X1,false,1,threads);
+}
+
+Tuple<Ref<const TriangleSoup>,Array<TV>>
+soup_difference(const TriangleSoup& faces0, Array<const TV> X0, const TriangleSoup& faces1, Array<const TV> X1,
+                const int threads) {
+  // Reversing the second operand makes its interior depth -1, so 0 - A\B has depth 1 and everything else 0 or less
+  return soup_boolean(faces0,X0,faces1,X1,true,0,threads);
+}
+
+// Leaf node containing each simplex of a tree with leaf size 1
+template<int d> static Array<int> leaf_nodes(const SimplexTree<EV,d>& tree) {
+  Array<int> leaf(tree.mesh->elements.size(),uninit);
+  for (const int n : tree.leaves)
+    leaf[tree.prims(n)[0]] = n;
+  return leaf;
+}
+
+// Update a tree after one of its simplices moves
+template<int d> static void update_simplex(const SimplexTree<EV,d>& tree, RawArray<const int> leaf, const int s) {
+  const auto v = tree.mesh->elements[s];
+  tree.simplices[s] = typename SimplexTree<EV,d>::Simplex(tree.X.subset(v));
+  int n = leaf[s];
+  tree.boxes[n] = bounding_box(tree.X.subset(v));
+  while (n) {
+    n = (n-1)/2;
+    tree.boxes[n] = Box<EV>::combine(tree.boxes[2*n+1],tree.boxes[2*n+2]);
+  }
+}
+
+// Could a ray fired from p along the positive x axis touch box?
+static inline bool ray_touches(const Box<EV>& box, const EV p) {
+  return    p.x<=box.max.x
+         && box.min.y<=p.y && p.y<=box.max.y
+         && box.min.z<=p.z && p.z<=box.max.z;
+}
+
+// Cached state for DynamicMeshCSG.  The cut faces and depth merges of each original face are stored back to back in
+// face order.  Merges refer to original edges by index, to ff edges by edges.size()+ff, and to the face's own cut faces
+// by -k-1, so that the merges of unchanged faces survive renumbering of ff edges and cut faces.
+struct DynamicMeshCSG::Cache {
+  const TriangleSoup& faces;
+  const Array<const Vector<int,2>> edges;
+  const Array<const Vector<int,3>> face_edges;
+  const Nested<const int> incident_faces;
+  const RawArray<const int> depth_weight;
+  const int nt;
+  const bool approximate_depths;
+  const Array<EV> X;
+  Ptr<SimplexTree<EV,2>> face_tree;
+  Ptr<SimplexTree<EV,1>> edge_tree;
+  Array<int> face_leaf, edge_leaf;
+  Nested<const EdgeFaceVertex> ef_vertices;
+  Array<const FaceFaceEdge> ff_edges;
+  Array<FaceFaceFaceVertex> fff_vertices;
+  Hashtable<Vector<int,3>,int> faces_to_fff;
+  Array<int> cut_offsets, merge_offsets; // Ranges of each face in cut_faces and merges
+  Array<Vector<int,3>> cut_faces, merges;
+  Hashtable<int,int> ray_depths; // Ray depths keyed by starting face
+  DepthUnionFind union_find;
+
+  Cache(const TriangleSoup& faces, RawArray<const int> depth_weight, const int nt, const bool approximate_depths,
+        const Array<EV> X)
+    : faces(faces)
+    , edges(faces.segment_soup()->elements)
+    , face_edges(faces.triangle_edges())
+    , incident_faces(faces.incident_elements())
+    , depth_weight(depth_weight)
+    , nt(nt)
+    , approximate_depths(approximate_depths)
+    , X(X) {}
+
+  // Compute everything from scratch
+  void rebuild() {
+    IntervalScope scope;
+    face_tree = new_<SimplexTree<EV,2>>(faces,X,1);
+    edge_tree = new_<SimplexTree<EV,1>>(*faces.segment_soup(),X,1);
+    face_leaf = leaf_nodes(*face_tree);
+    edge_leaf = leaf_nodes(*edge_tree);
+    const auto A = intersection_simplices(*face_tree,RawArray<const bool>(),nt);
+    ef_vertices = A.x;
+    ff_edges = A.y;
+    fff_vertices = Array<FaceFaceFaceVertex>();
+    faces_to_fff = Hashtable<Vector<int,3>,int>();
+    ray_depths = Hashtable<int,int>();
+    retriangulate(arange(faces.elements.size()).copy(),Array<const int>(),Array<const int>(),Array<const int>(),0);
+    depths();
+  }
+
+  // Move vertices, returning the number of retriangulated faces
+  int move(RawArray<const int> vertices, RawArray<const EV> positions) {
+    // Collect vertices whose quantized positions change, and the faces and edges they touch
+    Hashtable<int> moved;
+    Array<int> moved_vertices;
+    for (const int i : range(vertices.size()))
+      if (X[vertices[i]]!=positions[i] && moved.set(vertices[i]))
+        moved_vertices.append(vertices[i]);
+    Array<int> moved_faces, moved_edges;
+    {
+      Hashtable<int> seen_faces, seen_edges;
+      for (const int v : moved_vertices)
+        for (const int f : incident_faces[v])
+          if (seen_faces.set(f)) {
+            moved_faces.append(f);
+            for (const int e : face_edges[f])
+              if ((moved.contains(edges[e].x) || moved.contains(edges[e].y)) && seen_edges.set(e))
+                moved_edges.append(e);
+          }
+    }
+    sort(moved_faces);
+    sort(moved_edges);
+
+    // Record old positions and face boxes, then move
+    Array<Box<EV>> boxes;
+    for (const int f : moved_faces) {
+      const auto v = faces.elements[f];
+      boxes.append(bounding_box(X[v.x],X[v.y],X[v.z]));
+    }
+    const auto old = X.subset(moved_vertices).copy();
+    for (const int i : range(vertices.size()))
+      X[vertices[i]] = positions[i];
+    if (!moved_faces.size())
+      return 0;
+
+    // Large edits are faster from scratch
+    const int nf = faces.elements.size();
+    if (4*moved_faces.size() > nf) {
+      rebuild();
+      return nf;
+    }
+
+    try {
+      return update(moved_faces,moved_edges,boxes);
+    } catch (...) {
+      // Restore the previous state
+      X.subset(moved_vertices) = old;
+      rebuild();
+      throw;
+    }
+  }
+
+  // Re-resolve intersections and depths after the given faces and edges have moved.  boxes holds the old boxes of
+  // the moved faces.
+  int update(RawArray<const int> moved_faces, RawArray<const int> moved_edges, Array<Box<EV>>& boxes) {
+    IntervalScope scope;
+    const int ne = edges.size(),
+              nX = X.size();
+    Hashtable<int> moved_face_set, moved_edge_set;
+    for (const int f : moved_faces) {
+      moved_face_set.set(f);
+      update_simplex(*face_tree,face_leaf,f);
+      const auto v = faces.elements[f];
+      boxes.append(bounding_box(X[v.x],X[v.y],X[v.z]));
+    }
+    for (const int e : moved_edges) {
+      moved_edge_set.set(e);
+      update_simplex(*edge_tree,edge_leaf,e);
+    }
+
+    // Find edge-face vertices on moved edges or faces
+    Array<EdgeFaceVertex> added;
+    {
+      const auto edge_tree = new_<SimplexTree<EV,1>>(*new_<const SegmentSoup>(edges.subset(moved_edges).copy()),X,1);
+      for (auto ef : find_edge_face_vertices(edge_tree,*face_tree,nt)) {
+        ef.edge = moved_edges[ef.edge];
+        added.append(ef);
+      }
+      const auto face_tree = new_<SimplexTree<EV,2>>(
+        *new_<const TriangleSoup>(faces.elements.subset(moved_faces).copy()),X,1);
+      for (auto ef : find_edge_face_vertices(*this->edge_tree,face_tree,nt))
+        if (!moved_edge_set.contains(ef.edge)) {
+          ef.face = moved_faces[ef.face];
+          added.append(ef);
+        }
+    }
+
+    // Faces whose retriangulation might change
+    Hashtable<int> dirty_set;
+    Array<int> dirty;
+    const auto mark = [&](const int f) {
+      if (dirty_set.set(f))
+        dirty.append(f);
+    };
+    for (const int f : moved_faces)
+      mark(f);
+    Hashtable<int> changed_edges;
+    const auto change_edge = [&](const int e) {
+      if (changed_edges.set(e)) {
+        const auto ev = edges[e];
+        for (const int f : incident_faces[ev.x])
+          if (faces.elements[f].contains(ev.y))
+            mark(f);
+      }
+    };
+
+    // Drop stale edge-face vertices and add new ones, keeping track of where the survivors go
+    const int old_nef = ef_vertices.flat.size();
+    Array<int> ef_map(old_nef,uninit);
+    Nested<EdgeFaceVertex> new_ef;
+    Array<int> added_edges;
+    {
+      Array<int> counts(ne,uninit);
+      for (const int e : range(ne)) {
+        counts[e] = ef_vertices.size(e);
+        const bool moved_e = moved_edge_set.contains(e);
+        for (const auto& ef : ef_vertices[e])
+          if (moved_e || moved_face_set.contains(ef.face)) {
+            counts[e]--;
+            change_edge(e);
+            mark(ef.face);
+          }
+      }
+      const auto kept = counts.copy();
+      for (const auto& ef : added) {
+        if (counts[ef.edge]++==kept[ef.edge])
+          added_edges.append(ef.edge);
+        change_edge(ef.edge);
+        mark(ef.face);
+      }
+      new_ef = Nested<EdgeFaceVertex>(counts,uninit);
+      for (const int e : range(ne)) {
+        int k = new_ef.offsets[e];
+        const bool moved_e = moved_edge_set.contains(e);
+        for (const int i : ef_vertices.range(e)) {
+          const auto& ef = ef_vertices.flat[i];
+          if (moved_e || moved_face_set.contains(ef.face))
+            ef_map[i] = -1;
+          else {
+            ef_map[i] = k;
+            new_ef.flat[k++] = ef;
+          }
+        }
+      }
+      for (const auto& ef : added)
+        new_ef(ef.edge,kept[ef.edge]++) = ef;
+    }
+
+    // Sort edges which gained vertices, and find the new positions of their surviving vertices
+    for (const int e : added_edges) {
+      sort_edge_face_vertices(X,faces.elements,edges,new_ef,range(e,e+1));
+      const auto r = new_ef.range(e);
+      for (const int i : ef_vertices.range(e))
+        if (ef_map[i] >= 0)
+          for (const int k : r)
+            if (new_ef.flat[k].face==ef_vertices.flat[i].face) {
+              ef_map[i] = k;
+              break;
+            }
+    }
+
+    // Recompute intersection edges, which is purely combinatorial.  Two faces intersect in at most one edge.
+    const auto new_ff = face_face_edges(faces,X,new_ef);
+    Array<int> ff_map(ff_edges.size(),uninit);
+    {
+      Hashtable<Vector<int,2>,int> pairs;
+      for (const int i : range(new_ff.size()))
+        pairs.set(new_ff[i].faces.sorted(),i);
+      for (const int i : range(ff_edges.size()))
+        ff_map[i] = pairs.get_default(ff_edges[i].faces.sorted(),-1);
+    }
+
+    // Drop face-face-face vertices touching moved faces
+    Array<int> fff_map(fff_vertices.size(),uninit);
+    Array<FaceFaceFaceVertex> new_fff;
+    Hashtable<Vector<int,3>,int> new_faces_to_fff;
+    for (const int i : range(fff_vertices.size())) {
+      const auto& v = fff_vertices[i];
+      if (   moved_face_set.contains(v.faces.x)
+          || moved_face_set.contains(v.faces.y)
+          || moved_face_set.contains(v.faces.z))
+        fff_map[i] = -1;
+      else {
+        fff_map[i] = new_fff.size();
+        new_faces_to_fff.set(v.faces.sorted(),new_fff.size());
+        new_fff.append(v);
+      }
+    }
+
+    // Invalidate cached rays that might touch an old or new position of a moved face
+    Array<int> stale;
+    {
+      Box<EV> all;
+      for (const auto& b : boxes)
+        all.enlarge(b);
+      for (const auto& r : ray_depths) {
+        const int f = r.x;
+        const auto p = X[edges[face_edges[f].x].x];
+        if (moved_face_set.contains(f))
+          stale.append(f);
+        else if (ray_touches(all,p))
+          for (const auto& b : boxes)
+            if (ray_touches(b,p)) {
+              stale.append(f);
+              break;
+            }
+      }
+    }
+
+    // Commit and finish
+    ef_vertices = new_ef;
+    ff_edges = new_ff;
+    fff_vertices = new_fff;
+    faces_to_fff = new_faces_to_fff;
+    for (const int f : stale)
+      ray_depths.erase(f);
+    sort(dirty);
+    retriangulate(dirty,ef_map,ff_map,fff_map,nX+old_nef);
+    depths();
+    return dirty.size();
+  }
+
+  // Retriangulate the given sorted list of dirty faces, and reuse the stored results of all other faces.  The maps take
+  // edge-face vertices, ff edges, and face-face-face vertices in the previous state to current indices, and old_nn is
+  // the previous index of the first face-face-face vertex.
+  void retriangulate(RawArray<const int> dirty, RawArray<const int> ef_map, RawArray<const int> ff_map,
+                     RawArray<const int> fff_map, const int old_nn) {
+    const int nf = faces.elements.size(),
+              ne = edges.size(),
+              nX = X.size(),
+              nn = nX+ef_vertices.flat.size(),
+              base = ne+ff_edges.size();
+    const auto face_to_ef = edge_face_vertices_by_face(nf,ef_vertices);
+    const Nested<const int> face_to_ff = face_face_edges_by_face(nf,ff_edges);
+
+    // Retriangulate dirty faces in parallel blocks
+    const int blocks = min(dirty.size(),16*nt);
+    vector<RetriangulatedBlock> block;
+    block.reserve(blocks);
+    for (int b=0;b<blocks;b++)
+      block.emplace_back(base);
+    parallel_for(nt,blocks,[&](const int b) {
+      const auto r = partition_loop(dirty.size(),blocks,b);
+      retriangulate_block(block[b],*face_tree,depth_weight,true,ef_vertices,ff_edges,face_to_ef,face_to_ff,face_edges,
+                          dirty.slice(r.lo,r.hi));
+    });
+
+    // Give new face-face-face vertices global indices.  Rounding depends on which face constructs a vertex, so we
+    // match a full recompute by preferring the version built from the lowest face.
+    vector<Array<int>> fff_maps(blocks);
+    for (const int b : range(blocks))
+      for (const auto& v : block[b].fff_vertices) {
+        const auto sorted = v.faces.sorted();
+        const int n = fff_vertices.size(),
+                  i = faces_to_fff.get_or_insert(sorted,n);
+        if (i==n)
+          fff_vertices.append(v);
+        else if (v.faces.x==sorted.x)
+          fff_vertices[i] = v;
+        fff_maps[b].append(i);
+      }
+
+    // Combine stored and new results in face order
+    Array<int> new_cut_offsets(nf+1,uninit),
+               new_merge_offsets(nf+1,uninit);
+    Array<Vector<int,3>> new_cut_faces, new_merges;
+    new_cut_faces.preallocate(cut_faces.size());
+    new_merges.preallocate(merges.size());
+    int d = 0, b = 0, lo = 0; // Next dirty face, its block, and the block's start in dirty
+    for (const int f : range(nf)) {
+      new_cut_offsets[f] = new_cut_faces.size();
+      new_merge_offsets[f] = new_merges.size();
+      if (d<dirty.size() && dirty[d]==f) {
+        while (d-lo >= block[b].offsets.size())
+          lo += block[b++].offsets.size();
+        const auto& B = block[b];
+        const int j = d++-lo;
+        const auto start = B.offsets[j],
+                   end = j+1<B.offsets.size() ? B.offsets[j+1]
+                                              : vec(B.cut_faces.size(),B.merges.merges.size());
+        for (int i=start.x;i<end.x;i++) {
+          auto t = B.cut_faces[i];
+          for (auto& v : t)
+            if (v >= nn)
+              v = nn+fff_maps[b][v-nn];
+          new_cut_faces.append(t);
+        }
+        for (int i=start.y;i<end.y;i++) {
+          auto m = B.merges.merges[i];
+          for (int k=0;k<2;k++)
+            if (m[k] >= base)
+              m[k] = -1-(m[k]-base-start.x);
+          new_merges.append(m);
+        }
+      } else {
+        for (int i=cut_offsets[f];i<cut_offsets[f+1];i++) {
+          auto t = cut_faces[i];
+          for (auto& v : t)
+            if (v >= nX)
+              v = v<old_nn ? nX+ef_map[v-nX] : nn+fff_map[v-old_nn];
+          new_cut_faces.append(t);
+        }
+        for (int i=merge_offsets[f];i<merge_offsets[f+1];i++) {
+          auto m = merges[i];
+          for (int k=0;k<2;k++)
+            if (m[k] >= ne)
+              m[k] = ne+ff_map[m[k]-ne];
+          new_merges.append(m);
+        }
+      }
+    }
+    new_cut_offsets[nf] = new_cut_faces.size();
+    new_merge_offsets[nf] = new_merges.size();
+    cut_offsets = new_cut_offsets;
+    merge_offsets = new_merge_offsets;
+    cut_faces = new_cut_faces;
+    merges = new_merges;
+  }
+
+  // Replay all depth merges, and fire rays from components without a cached ray
+  void depths() {
+    const int nf = faces.elements.size(),
+              base = edges.size()+ff_edges.size();
+    DepthUnionFind union_find;
+    union_find.extend(base+cut_faces.size());
+    for (const int f : range(nf)) {
+      const int fb = base+cut_offsets[f]-1;
+      for (int i=merge_offsets[f];i<merge_offsets[f+1];i++) {
+        const auto m = merges[i];
+        union_find.merge(m.x<0 ? fb-m.x : m.x,
+                         m.y<0 ? fb-m.y : m.y,m.z);
+      }
+    }
+
+    // Fire one ray from the first face of each component
+    const int infinity = union_find.append();
+    Array<int> ray_faces, new_rays;
+    {
+      Hashtable<int> seen;
+      for (const int f : range(nf))
+        if (seen.set(union_find.find(face_edges[f].x).p)) {
+          ray_faces.append(f);
+          if (!ray_depths.contains(f))
+            new_rays.append(f);
+        }
+    }
+    Array<int> new_depths(new_rays.size(),uninit);
+    const Unique<const WindingTree> winding(approximate_depths ? new WindingTree(*face_tree,depth_weight) : 0);
+    const int chunks = min(new_rays.size(),16*nt);
+    parallel_for(nt,chunks,[&](const int c) {
+      const auto r = partition_loop(new_rays.size(),chunks,c);
+      fire_rays(*face_tree,winding.get(),depth_weight,face_edges,new_rays.slice(r.lo,r.hi),new_depths.slice(r.lo,r.hi));
+    });
+    for (const int i : range(new_rays.size()))
+      ray_depths.set(new_rays[i],new_depths[i]);
+    for (const int f : ray_faces)
+      union_find.merge(infinity,face_edges[f].x,ray_depths.get(f));
+    this->union_find = union_find;
+  }
+
+  Tuple<Ref<const TriangleSoup>,Array<EV>> result(const int depth) const {
+    // Extract cut faces at the right depth
+    Array<Vector<int,3>> pruned_faces;
+    if (depth != all_depths) {
+      const int infinity = union_find.info.size()-1,
+                base = edges.size()+ff_edges.size();
+      for (const int f : range(faces.elements.size())) {
+        const int weight = depth_weight[f];
+        for (int i=cut_offsets[f];i<cut_offsets[f+1];i++) {
+          const int fdepth = union_find.delta(infinity,base+i);
+          if (depth-weight < fdepth && fdepth <= depth)
+            pruned_faces.append(cut_faces[i]);
+        }
+      }
+    } else
+      pruned_faces = cut_faces.copy();
+
+    // Concatenate vertices together
+    Array<EV> Xs;
+    Xs.preallocate(X.size()+ef_vertices.flat.size()+fff_vertices.size());
+    Xs.extend(X);
+    for (const auto& v : ef_vertices.flat)
+      Xs.append_assuming_enough_space(v.rounded);
+    for (const auto& v : fff_vertices)
+      Xs.append_assuming_enough_space(v.rounded);
+    if (depth != all_depths)
+      fix_loops(pruned_faces,Xs,X.size(),ff_edges);
+    return tuple(new_<const TriangleSoup>(pruned_faces),Xs);
+  }
+};
+
+GEODE_DEFINE_TYPE(DynamicMeshCSG)
+
+static Array<EV> quantize_inside(const Box<TV>& box, const Quantizer<real,3>& quant, RawArray<const TV> X) {
+  Array<EV> Q(X.size(),uninit);
+  for (const int i : range(X.size())) {
+    if (!box.lazy_inside(X[i]))
+      throw ValueError(format("DynamicMeshCSG: point %s is outside the box %s",str(X[i]),str(box)));
+    Q[i] = quant(X[i]);
+  }
+  return Q;
+}
+
+static Array<const int> unit_weights_if_empty(Array<const int> weights, const int n) {
+  if (weights.size())
+    return weights;
+  Array<int> ones(n,uninit);
+  ones.fill(1);
+  return ones;
+}
+
+static int check_threads(const int threads) {
+  GEODE_ASSERT(threads>=0);
+  return threads ? threads : omp_get_max_threads();
+}
+
+DynamicMeshCSG::DynamicMeshCSG(const TriangleSoup& faces, RawArray<const TV> X, Array<const int> depth_weight,
+                               const Box<TV> box, const int threads, const bool approximate_depths)
+  : box(box)
+  , quant(box)
+  , faces(ref(faces))
+  , depth_weight(unit_weights_if_empty(depth_weight,faces.elements.size()))
+  , threads(check_threads(threads))
+  , approximate_depths(approximate_depths)
+  , cache(new Cache(faces,this->depth_weight,this->threads,approximate_depths,quantize_inside(box,quant,X))) {
+  GEODE_ASSERT(faces.nodes()<=X.size());
+  GEODE_ASSERT(this->depth_weight.size()==faces.elements.size());
+  cache->rebuild();
+}
+
+DynamicMeshCSG::~DynamicMeshCSG() {}
+
+int DynamicMeshCSG::move(RawArray<const int> vertices, RawArray<const TV> positions) {
+  GEODE_ASSERT(vertices.size()==positions.size());
+  for (const int v : vertices)
+    if (!cache->X.valid(v))
+      throw ValueError(format("DynamicMeshCSG::move: invalid vertex %d",v));
+  return cache->move(vertices,quantize_inside(box,quant,positions));
+}
+
+Array<TV> DynamicMeshCSG::positions() const {
+  return amap(quant.inverse,cache->X).copy();
+}
+
+Tuple<Ref<const TriangleSoup>,Array<TV>> DynamicMeshCSG::result(const int depth) const {
+  const auto S = cache->result(depth);
+  return tuple(S.x,amap(quant.inverse,S.y).copy());
 }
 
 // A random looking polynomial vector field for testing purposes.  Doing this in numpy was terribly slow.
@@ -1476,15 +2513,31 @@ static double mesh_signature(const TriangleSoup& mesh, RawArray<const TV> X) {
 using namespace geode;
 
 void wrap_mesh_csg() {
-  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_fn)(const TriangleSoup&, Array<const Vector<double,3>>, const int);
+  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_fn)(const TriangleSoup&, Array<const Vector<double,3>>, const int, const int, const bool);
   GEODE_OVERLOADED_FUNCTION(split_fn,split_soup)
-  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_fn)(const TriangleSoup&, Array<const exact::Vec3>, const int);
+  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_fn)(const TriangleSoup&, Array<const exact::Vec3>, const int, const int, const bool);
   GEODE_OVERLOADED_FUNCTION(exact_split_fn,exact_split_soup)
 
-  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_depth_fn)(const TriangleSoup&, Array<const Vector<double,3>>, Array<const int>, const int);
+  typedef Tuple<Ref<const TriangleSoup>,Array<Vec3>> (*split_depth_fn)(const TriangleSoup&, Array<const Vector<double,3>>, Array<const int>, const int, const int, const bool);
   GEODE_OVERLOADED_FUNCTION_2(split_depth_fn,"split_soup_with_weight",split_soup)
-  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_depth_fn)(const TriangleSoup&, Array<const exact::Vec3>, Array<const int>, const int);
+  typedef Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>> (*exact_split_depth_fn)(const TriangleSoup&, Array<const exact::Vec3>, Array<const int>, const int, const int, const bool);
   GEODE_OVERLOADED_FUNCTION_2(exact_split_depth_fn,"exact_split_soup_with_weight",exact_split_soup)
 
+  GEODE_FUNCTION_2(soup_union_py,soup_union)
+  GEODE_FUNCTION_2(soup_intersection_py,soup_intersection)
+  GEODE_FUNCTION_2(soup_difference_py,soup_difference)
   GEODE_FUNCTION(mesh_signature)
+
+  typedef DynamicMeshCSG Self;
+  Class<Self>("DynamicMeshCSG")
+    .GEODE_INIT(const TriangleSoup&,RawArray<const Vec3>,Array<const int>,Box<Vec3>,int,bool)
+    .GEODE_FIELD(box)
+    .GEODE_FIELD(faces)
+    .GEODE_FIELD(depth_weight)
+    .GEODE_FIELD(threads)
+    .GEODE_FIELD(approximate_depths)
+    .GEODE_METHOD(move)
+    .GEODE_METHOD(positions)
+    .GEODE_METHOD(result)
+    ;
 }
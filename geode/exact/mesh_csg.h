@@ -2,23 +2,94 @@
 #pragma once
 
 #include <geode/exact/config.h>
+#include <geode/exact/quantize.h>
 #include <geode/mesh/TriangleSoup.h>
+#include <geode/utility/Unique.h>
 namespace geode {
 
 // If depth is this, faces at all depths are returned
 const int all_depths = std::numeric_limits<int>::min();
 
-// Resolve all intersections between triangle soups.
+// Resolve all intersections between triangle soups.  If threads is not 1, intersection finding, face retriangulation,
+// and ray casting for depths run in parallel using up to threads threads (or all available threads if threads is 0).
+// The result is identical regardless of thread count.
+//
+// If approximate_depths is true, ray depths are found by casting only to the first gap between faces along each ray,
+// and estimating the depth there with a fast winding number.  This is much faster for soups with many components
+// lined up along the rays, but the estimate is rounded without a certified error bound, so depths could in principle
+// be wrong.
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
-split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, const int depth);
+split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, const int depth, const int threads=1,
+           const bool approximate_depths=false);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
-split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, Array<const int> depth_weights, const int depth);
+split_soup(const TriangleSoup& faces, Array<const Vector<double,3>> X, Array<const int> depth_weights, const int depth,
+           const int threads=1, const bool approximate_depths=false);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>>
-exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, const int depth);
+exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, const int depth, const int threads=1,
+                 const bool approximate_depths=false);
 
 GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<exact::Vec3>>
-exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, Array<const int> depth_weights, const int depth);
+exact_split_soup(const TriangleSoup& faces, Array<const exact::Vec3> X, Array<const int> depth_weights, const int depth,
+                 const int threads=1, const bool approximate_depths=false);
+
+// Boolean operations on two closed triangle soups, each free of self intersections.  Intersections are resolved only
+// among faces whose boxes touch the other operand, and components away from the overlap are classified with one ray
+// each, so the number of exact predicates scales with the size of the overlap plus the number of components.  The
+// rest of the work (quantization, box prefiltering, component labeling, and assembling the output) is still linear
+// in the total size of the meshes, so this beats split_soup only when the overlap is a small part of the input.
+// The result is the same as split_soup applied to the concatenated soups (with the second reversed for difference).
+GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
+soup_union(const TriangleSoup& faces0, Array<const Vec3> X0, const TriangleSoup& faces1, Array<const Vec3> X1,
+           const int threads=1);
+
+GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
+soup_intersection(const TriangleSoup& faces0, Array<const Vec3> X0, const TriangleSoup& faces1, Array<const Vec3> X1,
+                  const int threads=1);
+
+GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<Vec3>>
+soup_difference(const TriangleSoup& faces0, Array<const Vec3> X0, const TriangleSoup& faces1, Array<const Vec3> X1,
+                const int threads=1);
+
+// A persistent split_soup whose vertices can be moved, with cost proportional to the edited region.  The intersection
+// simplices, per face retriangulations, and ray depths are kept between edits.  Moving vertices recomputes only the
+// intersections touching the moved faces, retriangulates only faces whose intersections change, and fires rays only
+// for depth components whose cached ray might have been affected.  Depths are then recovered by replaying the cached
+// union-find merges, which is linear in the size of the cut mesh but involves no geometric predicates.  Positions are
+// quantized once using a fixed box, and must stay inside it.  As with depth computation in split_soup, the soup must
+// be closed.  If threads is not 1, intersection finding and retriangulation run in parallel as in split_soup, and
+// approximate_depths is also as in split_soup.
+class DynamicMeshCSG : public Object {
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef real T;
+  typedef Vector<T,3> TV;
+
+  const Box<TV> box;
+  const Quantizer<T,3> quant;
+  const Ref<const TriangleSoup> faces;
+  const Array<const int> depth_weight;
+  const int threads;
+  const bool approximate_depths;
+protected:
+  struct Cache;
+  const Unique<Cache> cache;
+
+  GEODE_CORE_EXPORT DynamicMeshCSG(const TriangleSoup& faces, RawArray<const TV> X, Array<const int> depth_weight,
+                                   const Box<TV> box, const int threads, const bool approximate_depths=false);
+public:
+  ~DynamicMeshCSG();
+
+  // Move vertices to new positions, re-resolving the affected region.  Returns the number of faces retriangulated.
+  // If the edit touches a large fraction of the mesh, everything is recomputed from scratch.
+  GEODE_CORE_EXPORT int move(RawArray<const int> vertices, RawArray<const TV> positions);
+
+  // Current vertex positions, after quantization
+  GEODE_CORE_EXPORT Array<TV> positions() const;
+
+  // The split soup at the given depth (or all_depths), as for split_soup
+  GEODE_CORE_EXPORT Tuple<Ref<const TriangleSoup>,Array<TV>> result(const int depth) const;
+};
 
 }
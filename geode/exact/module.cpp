@@ -11,6 +11,9 @@ void wrap_exact() {
   GEODE_WRAP(predicates)
   GEODE_WRAP(constructions)
   GEODE_WRAP(delaunay)
+  GEODE_WRAP(triangle_locator)
+  GEODE_WRAP(polygon_locator)
+  GEODE_WRAP(delaunay3d)
   GEODE_WRAP(polygon_csg)
   GEODE_WRAP(circle_csg)
   GEODE_WRAP(simple_triangulate)
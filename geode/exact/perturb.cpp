@@ -6,10 +6,15 @@
 #include <geode/array/alloca.h>
 #include <geode/array/Array2d.h>
 #include <geode/array/Array3d.h>
+#include <geode/python/stl.h>
 #include <geode/python/wrap.h>
 #include <geode/random/counter.h>
 #include <geode/utility/move.h>
 #include <geode/vector/Matrix.h>
+#include <mutex>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
 namespace geode {
 
 // Our function is defined by
@@ -92,6 +97,151 @@ template<int m> static inline Vector<ExactInt,m> to_exact(const Vector<Quantized
   return r;
 }
 
+/********** Memoization **********/
+
+// Inputs with many coplanar or cocircular features send the same points through perturbed_sign again and again, so we
+// keep small per thread caches of perturbation vectors and of resolved degenerate signs.  Both are direct mapped tables
+// keyed by the complete inputs, so results never depend on cache state.  The sign memo costs tens of nanoseconds per
+// miss and hits rarely in typical workloads (e.g., 0.1% for Delaunay on a grid), so it is off by default.  The
+// perturbation cache measured neutral on the benchmarks we have, so it is off by default as well.
+static bool memoize_perturbations = false;
+static bool memoize_signs = false;
+static const int perturbation_cache_bits = 10;
+static const int sign_cache_bits = 8;
+static const int sign_cache_max_args = 10;
+
+void set_perturbation_memoization(const bool perturbations, const bool signs) {
+  memoize_perturbations = perturbations;
+  memoize_signs = signs;
+}
+
+static uint64_t cache_counts[4]; // Perturbation hits, perturbation misses, sign hits, sign misses
+
+#if PREDICATE_COUNTERS
+static inline void count_cache(const int i) {
+  fetch_and_add(&cache_counts[i],uint64_t(1));
+}
+#else
+static inline void count_cache(const int i) {}
+#endif
+
+// Counts are read and cleared between computations, so plain loads and stores suffice
+Tuple<uint64_t,uint64_t,uint64_t,uint64_t> perturbation_cache_counts() {
+  return tuple(cache_counts[0],cache_counts[1],cache_counts[2],cache_counts[3]);
+}
+
+void clear_perturbation_cache_counts() {
+  for (int i=0;i<4;i++)
+    cache_counts[i] = 0;
+}
+
+// Flatten seeds and values into 64 bit words for hashing and exact comparison
+static inline int memo_words(uint64_t* w, const int x) {
+  w[0] = uint32_t(x);
+  return 1;
+}
+template<int m> static inline int memo_words(uint64_t* w, const Vector<Quantized,m>& x) {
+  static_assert(sizeof(x)==m*sizeof(uint64_t),"");
+  memcpy(w,&x,sizeof(x));
+  return m;
+}
+
+static inline bool memo_equal(const uint64_t* a, const uint64_t* b, const int n) {
+  for (int i=0;i<n;i++)
+    if (a[i]!=b[i])
+      return false;
+  return true;
+}
+
+// Multiplicative hashing, returning the high bits for use as a table index.  Short keys use independent products,
+// which are cheaper than a serial chain but mix less.
+static inline int memo_hash(const int bits, const uint64_t* w, const int n) {
+  uint64_t h = 0;
+  for (int i=0;i<n;i++)
+    h = (h+w[i])*0x9e3779b97f4a7c15u;
+  return int(h>>(64-bits));
+}
+static inline int short_memo_hash(const int bits, const uint64_t* w, const int n) {
+  uint64_t h = 0;
+  for (int i=0;i<n;i++)
+    h ^= w[i]*(0x9e3779b97f4a7c15u+2*i);
+  return int(h>>(64-bits));
+}
+
+// The tables are plain old data so that thread local storage needs no dynamic initialization
+template<int m,class Seed> static Vector<ExactInt,m> cached_perturbation(const int level, const Seed seed) {
+  if (!memoize_perturbations)
+    return perturbation<m>(level,seed);
+  struct Entry {
+    uint64_t key[4]; // Level, then seed.  Level zero marks empty entries, since cached levels start at one.
+    ExactInt y[m];
+  };
+  static GEODE_THREAD_LOCAL Entry table[1<<perturbation_cache_bits];
+  uint64_t key[4] = {uint64_t(level),0,0,0};
+  memo_words(key+1,seed);
+  auto& e = table[short_memo_hash(perturbation_cache_bits,key,4)];
+  Vector<ExactInt,m> y;
+  if (memo_equal(e.key,key,4)) {
+    count_cache(0);
+    for (int i=0;i<m;i++)
+      y[i] = e.y[i];
+    return y;
+  }
+  count_cache(1);
+  y = perturbation<m>(level,seed);
+  memcpy(e.key,key,sizeof(key));
+  for (int i=0;i<m;i++)
+    e.y[i] = y[i];
+  return y;
+}
+
+// Memo of perturbed_sign results for degenerate inputs.  The key includes the predicate, its degree, and the seeds and
+// (for explicit perturbations) values of all arguments in order, since perturbed predicates are not in general symmetric.
+template<class PerturbedT> struct SignMemo {
+  typedef void (*Predicate)(RawArray<mp_limb_t>,RawArray<const Vector<Exact<1>,PerturbedT::m>>);
+  static const bool explicit_ = PerturbedT::ps==Perturbation::Explicit;
+  static const int key_words = 2+sign_cache_max_args*((sizeof(decltype(declval<PerturbedT>().seed()))+7)/8
+                                                      +explicit_*PerturbedT::m); // Predicate, degree and n, then arguments
+  struct Entry {
+    int words; // Zero for empty entries
+    bool sign;
+    uint64_t key[key_words];
+  };
+  Entry* entry;
+  bool hit;
+  int words;
+  uint64_t key[key_words];
+
+  SignMemo(const Predicate predicate, const int degree, RawArray<const PerturbedT> X)
+    : entry(0), hit(false), words(0) {
+    const int n = X.size();
+    if (!memoize_signs || n>sign_cache_max_args)
+      return;
+    static GEODE_THREAD_LOCAL Entry table[1<<sign_cache_bits];
+    key[0] = uint64_t(size_t(predicate));
+    key[1] = uint64_t(uint32_t(degree))|uint64_t(n)<<32;
+    words = 2;
+    for (const auto& x : X)
+      words += memo_words(key+words,x.seed());
+    const int hashed = words; // Seeds almost always determine values, so we hash only those
+    if (explicit_)
+      for (const auto& x : X)
+        words += memo_words(key+words,x.value());
+    entry = &table[memo_hash(sign_cache_bits,key,hashed)];
+    hit = entry->words==words && memo_equal(entry->key,key,words);
+    count_cache(hit ? 2 : 3);
+  }
+
+  bool store(const bool sign) {
+    if (entry) {
+      entry->words = words;
+      entry->sign = sign;
+      memcpy(entry->key,key,sizeof(uint64_t)*words);
+    }
+    return sign;
+  }
+};
+
 static bool last_nonzero(RawArray<const mp_limb_t> x) {
   return mpz_nonzero(x);
 }
@@ -120,35 +270,22 @@ assert_last_nonzero(void(*const polynomial)(R,RawArray<const Vector<Exact<1>,Per
   throw AssertionError(format("%s (there is likely a bug in the calling code), X = %s",message,str(X)));
 }
 
-template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<mp_limb_t>,RawArray<const Vector<Exact<1>,PerturbedT::m>>),
-                                                      const int degree, RawArray<const PerturbedT> X) {
+// The perturbed part of perturbed_sign, called only if the unperturbed predicate is zero
+template<class PerturbedT> static bool
+perturbed_sign_degenerate(void(*const predicate)(RawArray<mp_limb_t>,RawArray<const Vector<Exact<1>,PerturbedT::m>>),
+                          const int degree, RawArray<const PerturbedT> X) {
   const int m = PerturbedT::m;
   typedef Vector<Exact<1>,m> EV;
-  if (check)
-    GEODE_WARNING("Expensive consistency checking enabled");
-
   const int n = X.size();
-  if (verbose)
-    cout << "perturbed_sign:\n  degree = "<<degree<<"\n  X = "<<X<<endl;
-
-  // Check if the predicate is nonsingular without perturbation
   const auto Z = GEODE_RAW_ALLOCA(n,EV);
   const int precision = degree*Exact<1>::ratio;
-  {
-    for (int i=0;i<n;i++)
-      Z[i] = EV(to_exact(X[i].value()));
-    const auto R = GEODE_RAW_ALLOCA(precision,mp_limb_t);
-    predicate(R,Z);
-    if (const int sign = mpz_sign(R))
-      return sign>0;
-  }
 
   // Check the first perturbation level with specialized code
   vector<Vector<ExactInt,m>> Y(n); // perturbations
   {
     // Compute the first level of perturbations
     for (int i=0;i<n;i++)
-      Y[i] = perturbation<m>(1,X[i].seed());
+      Y[i] = cached_perturbation<m>(1,X[i].seed());
     if (verbose)
       cout << "  Y = "<<Y<<endl;
 
@@ -184,7 +321,7 @@ template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<m
       // Compute the next level of perturbations
       Y.resize(d*n);
       for (int i=0;i<n;i++)
-        Y[(d-1)*n+i] = perturbation<m>(d,X[i].seed());
+        Y[(d-1)*n+i] = cached_perturbation<m>(d,X[i].seed());
 
       // Evaluate polynomial at every point in an "easy corner"
       const auto lambda = monomials(degree,d);
@@ -225,6 +362,37 @@ template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<m
   }
 }
 
+template<class PerturbedT> bool perturbed_sign(void(*const predicate)(RawArray<mp_limb_t>,RawArray<const Vector<Exact<1>,PerturbedT::m>>),
+                                                      const int degree, RawArray<const PerturbedT> X) {
+  const int m = PerturbedT::m;
+  typedef Vector<Exact<1>,m> EV;
+  if (check)
+    GEODE_WARNING("Expensive consistency checking enabled");
+  clear_avx_state();
+
+  const int n = X.size();
+  if (verbose)
+    cout << "perturbed_sign:\n  degree = "<<degree<<"\n  X = "<<X<<endl;
+
+  // Check if the predicate is nonsingular without perturbation
+  const auto Z = GEODE_RAW_ALLOCA(n,EV);
+  const int precision = degree*Exact<1>::ratio;
+  {
+    for (int i=0;i<n;i++)
+      Z[i] = EV(to_exact(X[i].value()));
+    const auto R = GEODE_RAW_ALLOCA(precision,mp_limb_t);
+    predicate(R,Z);
+    if (const int sign = mpz_sign(R))
+      return sign>0;
+  }
+
+  // The predicate is degenerate, so check the memo before perturbing
+  SignMemo<PerturbedT> memo(predicate,degree,X);
+  if (memo.hit)
+    return memo.entry->sign;
+  return memo.store(perturbed_sign_degenerate(predicate,degree,X));
+}
+
 static inline RawArray<mp_limb_t> sqrt_helper(RawArray<mp_limb_t> result, RawArray<const mp_limb_t> x) {
   const auto s = result.slice(0,(1+x.size())/2);
   mpn_sqrtrem(s.data(),0,x.data(),x.size());
@@ -315,6 +483,7 @@ void snap_divs(RawArray<Quantized> result, RawArray<mp_limb_t,2> values, const b
 template<class PerturbedT> bool perturbed_ratio(RawArray<Quantized> result, void(*const ratio)(RawArray<mp_limb_t,2>,RawArray<const Vector<Exact<1>,PerturbedT::m>>), const int degree, RawArray<const PerturbedT> X, const bool take_sqrt) {
   const int m = PerturbedT::m;
   typedef Vector<Exact<1>,m> EV;
+  clear_avx_state();
   const int n = X.size();
   const int r = result.size();
 
@@ -340,7 +509,7 @@ template<class PerturbedT> bool perturbed_ratio(RawArray<Quantized> result, void
   {
     // Compute the first level of perturbations
     for (int i=0;i<n;i++)
-      Y[i] = perturbation<m>(1,X[i].seed());
+      Y[i] = cached_perturbation<m>(1,X[i].seed());
     if (verbose)
       cout << "  Y = "<<Y<<endl;
 
@@ -381,7 +550,7 @@ template<class PerturbedT> bool perturbed_ratio(RawArray<Quantized> result, void
       // Compute the next level of perturbations
       Y.resize(d*n);
       for (int i=0;i<n;i++)
-        Y[(d-1)*n+i] = perturbation<m>(d,X[i].seed());
+        Y[(d-1)*n+i] = cached_perturbation<m>(d,X[i].seed());
 
       // Evaluate polynomial at every point in an "easy corner"
       const auto lambda = monomials(degree,d);
@@ -560,6 +729,40 @@ static void perturbed_ratio_test() {
     }
 }
 
+static std::mutex predicate_counters_mutex;
+static PredicateCounters* predicate_counters = 0;
+
+PredicateCounters::PredicateCounters(const char* name)
+  : name(name) {
+  memset(tiers,0,sizeof(tiers));
+  std::lock_guard<std::mutex> lock(predicate_counters_mutex);
+  next = predicate_counters;
+  predicate_counters = this;
+}
+
+std::vector<Tuple<string,uint64_t,uint64_t,uint64_t>> predicate_tier_counts() {
+  std::vector<Tuple<string,uint64_t,uint64_t,uint64_t>> counts;
+  std::lock_guard<std::mutex> lock(predicate_counters_mutex);
+  for (auto c=predicate_counters;c;c=c->next) {
+    string name = c->name;
+#ifdef __GNUC__
+    int status;
+    if (char* demangled = abi::__cxa_demangle(c->name,0,0,&status)) {
+      name = demangled;
+      free(demangled);
+    }
+#endif
+    counts.push_back(tuple(name,c->tiers[0],c->tiers[1],c->tiers[2]));
+  }
+  return counts;
+}
+
+void clear_predicate_tier_counts() {
+  std::lock_guard<std::mutex> lock(predicate_counters_mutex);
+  for (auto c=predicate_counters;c;c=c->next)
+    memset(c->tiers,0,sizeof(c->tiers));
+}
+
 #define INSTANTIATE(m) \
   template Vector<ExactInt,m> perturbation(const int, const int); \
   template Vector<ExactInt,m> packed_perturbation(const int, const Vector<Quantized,m>); \
@@ -583,6 +786,11 @@ template bool perturbed_sign(void(*const)(RawArray<mp_limb_t>,RawArray<const Vec
 using namespace geode;
 
 void wrap_perturb() {
+  GEODE_FUNCTION(predicate_tier_counts)
+  GEODE_FUNCTION(clear_predicate_tier_counts)
+  GEODE_FUNCTION(perturbation_cache_counts)
+  GEODE_FUNCTION(clear_perturbation_cache_counts)
+  GEODE_FUNCTION(set_perturbation_memoization)
   GEODE_FUNCTION_2(perturbed_sign_test_1,perturbed_sign_test<1>)
   GEODE_FUNCTION_2(perturbed_sign_test_2,perturbed_sign_test<2>)
   GEODE_FUNCTION_2(perturbed_sign_test_3,perturbed_sign_test<3>)
@@ -4,16 +4,24 @@
 #include <geode/exact/config.h>
 #include <geode/exact/debug.h>
 #include <geode/exact/Exact.h>
+#include <geode/exact/Filtered.h>
 #include <geode/exact/Interval.h>
 #include <geode/exact/irreducible.h>
 #include <geode/structure/Tuple.h>
 #include <geode/utility/IRange.h>
 #include <geode/vector/Vector.h>
+#include <string>
+#include <typeinfo>
+#include <vector>
 namespace geode {
 
 // sys/termios.h on Mac was defining B0 as a macro.  Don't.
 #undef B0
 
+// Turn on to count how often each tier of perturbed_predicate (floating point filter, interval, exact) decides the
+// sign, per predicate.  The counts are available via predicate_tier_counts.
+#define PREDICATE_COUNTERS 0
+
 // Evaluate predicate(X+epsilon)>0 for a certain infinitesimal perturbation epsilon.  The predicate must be a
 // multivariate polynomial of at most the given degree.  The permutation chosen is deterministic, independent
 // of the predicate, and guaranteed to work for all possible polynomials.  Each coordinate of the X array contains
@@ -71,6 +79,55 @@ wrap_predicate(Types<entries...>) -> decltype(&wrapped_predicate<F,d,entries...>
   return &wrapped_predicate<F,d,entries...>;
 }
 
+// Per predicate tier counts, active only if PREDICATE_COUNTERS is on
+struct PredicateCounters {
+  const char* const name;
+  PredicateCounters* next;
+  uint64_t tiers[3]; // Filter, interval, exact
+
+  GEODE_CORE_EXPORT PredicateCounters(const char* name); // Registers with predicate_tier_counts
+};
+#if PREDICATE_COUNTERS
+template<class F> static inline void count_predicate_tier(const int tier) {
+  static PredicateCounters counters(typeid(F).name());
+  fetch_and_add(&counters.tiers[tier],uint64_t(1));
+}
+#else
+template<class F> static inline void count_predicate_tier(const int tier) {}
+#endif
+
+// (name,filter,interval,exact) for each predicate evaluated so far, if PREDICATE_COUNTERS is on
+GEODE_CORE_EXPORT std::vector<Tuple<std::string,uint64_t,uint64_t,uint64_t>> predicate_tier_counts();
+GEODE_CORE_EXPORT void clear_predicate_tier_counts();
+
+// Turn the per thread caches of perturbation vectors and of degenerate predicate signs on or off.  Results are
+// identical either way.  Not thread safe: call only when no predicates are running.  Defaults to (false,false).
+GEODE_CORE_EXPORT void set_perturbation_memoization(const bool perturbations, const bool signs);
+
+// Hit and miss counts for the caches, if PREDICATE_COUNTERS is on, as
+// (perturbation hits, perturbation misses, sign hits, sign misses)
+GEODE_CORE_EXPORT Tuple<uint64_t,uint64_t,uint64_t,uint64_t> perturbation_cache_counts();
+GEODE_CORE_EXPORT void clear_perturbation_cache_counts();
+
+// The interval and exact tiers of perturbed_predicate, for use once the floating point filter has failed
+template<class F,class... Args> static inline bool perturbed_predicate_unfiltered(const Args... args) {
+  typedef typename First<Args...>::type PerturbedT;
+  const int d = PerturbedT::m;
+  typedef decltype(F::eval(Vector<Exact<1>,d>(args.value())...)) Result;
+  const int degree = Result::degree;
+
+  // Try again with conservative interval arithmetic, which is tighter for long expressions
+  if (const int s = weak_sign(F::eval(Vector<Interval,d>(args.value())...))) {
+    count_predicate_tier<F>(1);
+    return s>0;
+  }
+
+  // Fall back to exact integer evaluation with symbolic perturbation
+  count_predicate_tier<F>(2);
+  const PerturbedT X[sizeof...(Args)] = {args...};
+  return perturbed_sign(wrap_predicate<F,d>(IRange<sizeof...(Args)>()),degree,asarray(X));
+}
+
 // Given F s.t. F::eval exactly computes a polynomial in its input arguments, compute the perturbed sign of F(args).
 // This is the standard way of turning an expression into a perturbed predicate.  For examples, see predicates.cpp.
 template<class F,class... Args> GEODE_ALWAYS_INLINE static inline bool perturbed_predicate(const Args... args) {
@@ -80,17 +137,77 @@ template<class F,class... Args> GEODE_ALWAYS_INLINE static inline bool perturbed
   const int degree = Result::degree;
 
   // Check irreducibility if desired
-  const auto f = wrap_predicate<F,d>(IRange<sizeof...(Args)>());
   if (IRREDUCIBLE)
-    inexact_assert_irreducible(f,degree,sizeof...(Args),typeid(F).name());
+    inexact_assert_irreducible(wrap_predicate<F,d>(IRange<sizeof...(Args)>()),degree,sizeof...(Args),typeid(F).name());
 
-  // Evaluate with conservative interval arithmetic, hoping for a clear nonzero
-  if (const int s = weak_sign(F::eval(Vector<Interval,d>(args.value())...)))
+  // Evaluate in floating point with a semi-static error bound, hoping for a clear nonzero
+  static const double threshold = filter_threshold(F::eval(Vector<FilterDepth,d>(args.value())...));
+  if (const int s = filter_sign(F::eval(Vector<Filtered,d>(args.value())...),threshold)) {
+    count_predicate_tier<F>(0);
     return s>0;
+  }
+  return perturbed_predicate_unfiltered<F>(args...);
+}
 
-  // Fall back to exact integer evaluation with symbolic perturbation
-  const PerturbedT X[sizeof...(Args)] = {args...};
-  return perturbed_sign(f,degree,asarray(X));
+// Unpack argument tuples for perturbed_predicates
+template<class F,class TV,int n,class... entries> GEODE_ALWAYS_INLINE static inline auto
+eval_entries(const TV (&X)[n], Types<entries...>) -> decltype(F::eval(X[entries::value]...)) {
+  return F::eval(X[entries::value]...);
+}
+template<class F,int d,class... entries> static inline auto filter_depth_entries(Types<entries...>)
+  -> decltype(F::eval(declval<typename First<Vector<FilterDepth,d>,entries>::type>()...)) {
+  return F::eval(typename First<Vector<FilterDepth,d>,entries>::type(Vector<Quantized,d>())...);
+}
+template<class F,class PerturbedT,int n,class... entries> static inline bool
+perturbed_predicate_entries(const Vector<PerturbedT,n>& args, Types<entries...>) {
+  return perturbed_predicate<F>(args[entries::value]...);
+}
+template<class F,class PerturbedT,int n,class... entries> static inline bool
+perturbed_predicate_unfiltered_entries(const Vector<PerturbedT,n>& args, Types<entries...>) {
+  return perturbed_predicate_unfiltered<F>(args[entries::value]...);
+}
+
+// Evaluate the floating point filter of perturbed_predicate<F> for filter_lanes argument tuples at once, where arg(k,j)
+// is the jth argument of the kth tuple.  signs[k] is set as in filter_sign, so zero means the caller must fall back
+// to perturbed_predicate_unfiltered.
+template<class F,int n,class Arg> GEODE_ALWAYS_INLINE static inline void
+perturbed_filter_signs(int signs[filter_lanes], const Arg& arg) {
+  typedef typename remove_const_reference<decltype(arg(0,0))>::type PerturbedT;
+  const int d = PerturbedT::m;
+  const IRange<n> entries;
+  static const double threshold = filter_threshold(filter_depth_entries<F,d>(entries));
+  Vector<FilteredLanes,d> X[n];
+  for (int j=0;j<n;j++)
+    for (int k=0;k<filter_lanes;k++) {
+      const auto x = arg(k,j).value();
+      for (int a=0;a<d;a++) {
+        X[j][a].v[k] = x[a];
+        X[j][a].m[k] = fabs(x[a]);
+      }
+    }
+  filter_signs(signs,eval_entries<F>(X,entries),threshold);
+}
+
+// Evaluate result[i] = perturbed_predicate<F>(args[i]...) for many argument tuples.  The floating point filter runs
+// filter_lanes tuples at a time with SIMD arithmetic, and only tuples it leaves undecided fall back to scalar code.
+template<class F,class PerturbedT,int n> static inline void
+perturbed_predicates(RawArray<bool> result, RawArray<const Vector<PerturbedT,n>> args) {
+  GEODE_ASSERT(result.size()==args.size());
+  const IRange<n> entries;
+  const int full = args.size()/filter_lanes*filter_lanes;
+  for (int i=0;i<full;i+=filter_lanes) {
+    int signs[filter_lanes];
+    perturbed_filter_signs<F,n>(signs,[=](const int k, const int j) { return args[i+k][j]; });
+    for (int k=0;k<filter_lanes;k++) {
+      if (signs[k]) {
+        count_predicate_tier<F>(0);
+        result[i+k] = signs[k]>0;
+      } else
+        result[i+k] = perturbed_predicate_unfiltered_entries<F>(args[i+k],entries);
+    }
+  }
+  for (int i=full;i<args.size();i++)
+    result[i] = perturbed_predicate_entries<F>(args[i],entries);
 }
 
 template<class F,class... Args> struct PerturbedConstruct {
@@ -2,6 +2,7 @@
 #include <geode/array/ConstantMap.h>
 #include <geode/exact/polygon_csg.h>
 #include <geode/exact/constructions.h>
+#include <geode/exact/hierarchical_union.h>
 #include <geode/exact/ExactSegmentGraph.h>
 #include <geode/exact/predicates.h>
 #include <geode/exact/perturb.h>
@@ -9,14 +10,14 @@
 #include <geode/exact/scope.h>
 #include <geode/array/amap.h>
 #include <geode/array/sort.h>
-#include <geode/geometry/BoxTree.h>
 #include <geode/geometry/polygon.h>
-#include <geode/geometry/traverse.h>
 #include <geode/python/wrap.h>
 #include <geode/structure/Hashtable.h>
 #include <geode/utility/Log.h>
 #include <geode/utility/str.h>
 #include <geode/utility/time.h>
+#include <queue>
+#include <set>
 
 namespace geode {
 
@@ -34,13 +35,6 @@ using exact::Perturbed2;
 using Log::cout;
 using std::endl;
 
-static Array<Box<EV>> segment_boxes(RawArray<const int> next, RawArray<const EV> X) {
-  Array<Box<EV>> boxes(X.size(),uninit);
-  for (int i=0;i<X.size();i++)
-    boxes[i] = bounding_box(X[i],X[next[i]]);
-  return boxes;
-}
-
 // Does x1 + t*dir head outwards from the local polygon portion x0,x1,x2?
 // A version of local_outwards specialized to dir = (1,0): does x1 + t*(1,0) head outwards from x0,x1,x2?
 static inline bool local_outwards_x_axis(const Perturbed2 x0, const Perturbed2 x1, const Perturbed2 x2) {
@@ -51,102 +45,222 @@ static inline bool local_outwards_x_axis(const Perturbed2 x0, const Perturbed2 x
   return out0==out1 ? out0 : triangle_oriented(x0,x1,x2);
 }
 
+namespace {
+// Bentley-Ottmann sweep upwards through segments indexed by their first point, finding all intersecting pairs and
+// the depth to the right of each vertex.  Symbolic perturbation rules out all degeneracies except shared endpoints
+// of consecutive segments, which never intersect elsewhere.
+//
+// Each segment in the sweep status stores the depth immediately to its right, measured as if the sweep line had
+// depth zero at its left end.  This is well defined since every horizontal line crosses contours upwards and
+// downwards equally often.  Inserting, removing, or swapping adjacent segments leaves the depths of all other
+// segments unchanged, so each event is O(log n) work.
+struct Sweep {
+  RawArray<const int> next;
+  RawArray<const EV> X;
+  Array<bool> up; // Does segment i point upwards?
+  Array<int> right_depth; // For segments in the status, the depth immediately to the right
+  int inserting; // The segment currently being inserted into the status
+
+  struct Less {
+    const Sweep& S;
+    bool operator()(const int s, const int t) const {
+      return s==t                ? false
+           : s==S.inserting ?  S.left_of(s,t)
+                            : !S.left_of(t,s);
+    }
+  };
+  typedef std::set<int,Less> Status;
+  Status status;
+  Array<typename Status::iterator> position;
+
+  // Scheduled intersections, lowest first
+  struct Above {
+    const Sweep& S;
+    bool operator()(const Vector<int,2> e, const Vector<int,2> f) const {
+      return segment_intersections_above(S.P(e.x),S.P(S.next[e.x]),S.P(e.y),S.P(S.next[e.y]),
+                                         S.P(f.x),S.P(S.next[f.x]),S.P(f.y),S.P(S.next[f.y]));
+    }
+  };
+  std::priority_queue<Vector<int,2>,std::vector<Vector<int,2>>,Above> events;
+  Hashtable<Vector<int,2>> scheduled;
+  Array<Vector<int,2>> pairs; // Intersecting pairs
+  Array<int> depths; // Depth to the right of each vertex, ignoring its own segments
+
+  Sweep(RawArray<const int> next, RawArray<const EV> X)
+    : next(next), X(X), up(X.size(),uninit), right_depth(X.size(),uninit), inserting(-1)
+    , status(Less{*this}), position(X.size()), events(Above{*this}), depths(X.size(),uninit) {
+    for (const int i : range(X.size()))
+      up[i] = upwards(P(i),P(next[i]));
+  }
+
+  Perturbed2 P(const int i) const { return Perturbed2(i,X[i]); }
+  int lo(const int s) const { return up[s] ? s : next[s]; }
+  int hi(const int s) const { return up[s] ? next[s] : s; }
+  int sign(const int s) const { return up[s] ? 1 : -1; }
+
+  // Is segment s, starting at the current sweep vertex, left of segment t in the status?
+  bool left_of(const int s, const int t) const {
+    const int v = lo(s), t0 = lo(t);
+    return t0==v ? triangle_oriented(P(v),P(hi(t)),P(hi(s)))
+                 : triangle_oriented(P(t0),P(hi(t)),P(v));
+  }
+
+  int depth_left(const typename Status::iterator it) const {
+    return it==status.begin() ? 0 : right_depth[*std::prev(it)];
+  }
+
+  // Schedule the intersection of adjacent segments s,t if they cross
+  void check(const int s, const int t) {
+    if (s==next[t] || t==next[s])
+      return;
+    if (   !scheduled.contains(vec(s,t).sorted())
+        && segments_intersect(P(s),P(next[s]),P(t),P(next[t]))) {
+      scheduled.set(vec(s,t).sorted());
+      events.push(vec(s,t));
+    }
+  }
+  void check_left(const typename Status::iterator it) {
+    if (it!=status.begin())
+      check(*std::prev(it),*it);
+  }
+  void check_right(const typename Status::iterator it) {
+    const auto n = std::next(it);
+    if (n!=status.end())
+      check(*it,*n);
+  }
+
+  void insert(const int s) {
+    inserting = s;
+    position[s] = status.insert(s).first;
+    inserting = -1;
+  }
+
+  // Process vertex v, the end of segment a and the start of segment v
+  void vertex(const int a, const int v) {
+    const int b = v;
+    const bool a_ends = up[a],
+               b_ends = !up[b];
+    if (a_ends != b_ends) {
+      // The polygon passes through v, so the outgoing segment replaces the incoming one in place
+      const int old = a_ends ? a : b,
+                s = a_ends ? b : a;
+      const auto it = position[old];
+      depths[v] = right_depth[old];
+      const_cast<int&>(*it) = s;
+      position[s] = it;
+      right_depth[s] = right_depth[old];
+      check_left(it);
+      check_right(it);
+    } else if (a_ends) {
+      // Local maximum: a and b are adjacent, and their contributions cancel
+      auto l = position[a], r = position[b];
+      if (std::next(r)==l)
+        swap(l,r);
+      assert(std::next(l)==r);
+      depths[v] = right_depth[*r];
+      status.erase(l);
+      const auto n = status.erase(r);
+      if (n!=status.begin() && n!=status.end())
+        check(*std::prev(n),*n);
+    } else {
+      // Local minimum: insert both segments
+      insert(a);
+      insert(b);
+      auto l = position[a], r = position[b];
+      if (std::next(r)==l)
+        swap(l,r);
+      assert(std::next(l)==r);
+      depths[v] = depth_left(l);
+      right_depth[*l] = depths[v]-sign(*l);
+      right_depth[*r] = right_depth[*l]-sign(*r);
+      check_left(l);
+      check_right(r);
+    }
+  }
+
+  // Process the intersection of adjacent segments a,b, with a on the left
+  void cross(const Vector<int,2> e) {
+    const int a = e.x, b = e.y;
+    const auto ia = position[a], ib = position[b];
+    GEODE_ASSERT(std::next(ia)==ib);
+    pairs.append(e);
+    const_cast<int&>(*ia) = b;
+    const_cast<int&>(*ib) = a;
+    position[a] = ib;
+    position[b] = ia;
+    right_depth[b] = depth_left(ia)-sign(b);
+    right_depth[a] = right_depth[b]-sign(a);
+    check_left(ia);
+    check_right(ib);
+  }
+
+  // Sweep through all vertices and intersections from bottom to top
+  void run(RawArray<const int> previous) {
+    const int n = X.size();
+    Array<int> order = arange(n).copy();
+    sort(order,[this](const int i, const int j) { return upwards(P(i),P(j)); });
+    for (int k=0;;) {
+      if (events.size()) {
+        const auto e = events.top();
+        if (k==n || !segment_intersection_above_point(P(e.x),P(next[e.x]),P(e.y),P(next[e.y]),P(order[k]))) {
+          events.pop();
+          cross(e);
+          continue;
+        }
+      }
+      if (k==n)
+        break;
+      const int v = order[k++];
+      vertex(previous[v],v);
+    }
+  }
+};
+}
+
 Nested<EV> exact_split_polygons(Nested<const EV> polys, const int depth) {
   IntervalScope scope;
   RawArray<const EV> X = polys.flat;
 
-  // We index segments by the index of their first point in X.  For convenience, we make an array to keep track of wraparounds.
-  Array<int> next = (arange(X.size())+1).copy();
+  // We index segments by the index of their first point in X.  For convenience, we make arrays to keep track of wraparounds.
+  Array<int> next = (arange(X.size())+1).copy(),
+             previous = (arange(X.size())-1).copy();
   for (int i=0;i<polys.size();i++) {
     GEODE_ASSERT(polys.size(i)>=3,"Degenerate polygons are not allowed");
     next[polys.offsets[i+1]-1] = polys.offsets[i];
+    previous[polys.offsets[i]] = polys.offsets[i+1]-1;
   }
 
-  // Compute all nontrivial intersections between segments
-  struct Pairs {
-    const BoxTree<EV>& tree;
-    RawArray<const int> next;
-    RawArray<const EV> X;
-    Array<Vector<int,2>> pairs;
-
-    Pairs(const BoxTree<EV>& tree, RawArray<const int> next, RawArray<const EV> X)
-      : tree(tree), next(next), X(X) {}
-
-    bool cull(const int n) const { return false; }
-    bool cull(const int n0, const int box1) const { return false; }
-    void leaf(const int n) const { assert(tree.prims(n).size()==1); }
-
-    void leaf(const int n0, const int n1) {
-      assert(tree.prims(n0).size()==1 && tree.prims(n1).size()==1);
-      const int i0 = tree.prims(n0)[0], i1 = next[i0],
-                j0 = tree.prims(n1)[0], j1 = next[j0];
-      if (!(i0==j0 || i0==j1 || i1==j0 || i1==j1)) {
-        const auto a0 = Perturbed2(i0,X[i0]), a1 = Perturbed2(i1,X[i1]),
-                   b0 = Perturbed2(j0,X[j0]), b1 = Perturbed2(j1,X[j1]);
-        if (segments_intersect(a0,a1,b0,b1))
-          pairs.append(vec(i0,j0));
-      }
-    }
-  };
-  const auto tree = new_<BoxTree<EV>>(segment_boxes(next,X),1);
-  Pairs pairs(tree,next,X);
-  double_traverse(*tree,pairs);
+  // Sweep to find intersections and depths
+  Sweep sweep(next,X);
+  sweep.run(previous);
 
   // Group intersections by segment.  Each pair is added twice: once for each order.
   Array<int> counts(X.size());
-  for (auto pair : pairs.pairs) {
+  for (auto pair : sweep.pairs) {
     counts[pair.x]++;
     counts[pair.y]++;
   }
   Nested<int> others(counts,uninit);
-  for (auto pair : pairs.pairs) {
+  for (auto pair : sweep.pairs) {
     others(pair.x,--counts[pair.x]) = pair.y;
     others(pair.y,--counts[pair.y]) = pair.x;
   }
-  pairs.pairs.clean_memory();
+  sweep.pairs.clean_memory();
   counts.clean_memory();
 
   // Walk all original polygons, recording which subsegments occur in the final result
   Hashtable<Vector<int,2>,int> graph; // If (i,j) -> k, the output contains the portion of segment j from ij to jk
   for (const int p : range(polys.size())) {
     const auto poly = range(polys.offsets[p],polys.offsets[p+1]);
-    // Compute the depth of the first point in the polygon by firing a ray along the positive x axis.
-    struct Depth {
-      const BoxTree<EV>& tree;
-      RawArray<const int> next;
-      RawArray<const EV> X;
-      const Perturbed2 start;
-      int depth;
-
-      Depth(const BoxTree<EV>& tree, RawArray<const int> next, RawArray<const EV> X, const int prev, const int i)
-        : tree(tree), next(next), X(X)
-        , start(i,X[i])
-        // If we intersect no other segments, the depth depends on the orientation of direction = (1,0) relative to segments prev and i
-        , depth(-!local_outwards_x_axis(Perturbed2(prev,X[prev]),start,Perturbed2(next[i],X[next[i]]))) {}
-
-      bool cull(const int n) const {
-        const auto box = tree.boxes(n);
-        return box.max.x<start.value().x || box.max.y<start.value().y || box.min.y>start.value().y;
-      }
-
-      void leaf(const int n) {
-        assert(tree.prims(n).size()==1);
-        const int i0 = tree.prims(n)[0], i1 = next[i0];
-        if (start.seed()!=i0 && start.seed()!=i1) {
-          const auto a0 = Perturbed2(i0,X[i0]),
-                     a1 = Perturbed2(i1,X[i1]);
-          const bool above0 = upwards(start,a0),
-                     above1 = upwards(start,a1);
-          if (above0!=above1 && above1==triangle_oriented(a0,a1,start))
-            depth += above1 ? 1 : -1;
-        }
-      }
-    };
-    Depth ray(tree,next,X,poly.back(),poly[0]);
-    single_traverse(*tree,ray);
+    // The depth of the first point in the polygon is the depth to its right, adjusted according to the orientation
+    // of direction = (1,0) relative to its two segments.
+    const int start = poly[0];
+    const int start_depth = sweep.depths[start]
+                          - !local_outwards_x_axis(Perturbed2(previous[start],X[previous[start]]),Perturbed2(start,X[start]),
+                                                   Perturbed2(next[start],X[next[start]]));
 
     // Walk around the polygon, recording all subsegments at the desired depth
-    int delta = ray.depth-depth;
+    int delta = start_depth-depth;
     int prev = poly.back();
     for (const int i : poly) {
       const int j = next[i];
@@ -221,6 +335,13 @@ Nested<Vec2> split_polygons(Nested<const Vec2> polys, const int depth) {
   return amap(quant.inverse,exact_split_polygons(amap(quant,polys),depth));
 }
 
+Nested<Vec2> parallel_polygon_union(Nested<const Vec2> polys, const int threads) {
+  return hierarchical_union(polys,threads,
+    [](RawArray<const Vec2> p) { return polygon_area(p); },
+    [](RawArray<const Vec2> p) { return bounding_box(p); },
+    [](Nested<const Vec2> p) { return split_polygons(p,0); });
+}
+
 Nested<Vec2> exact_split_polygons_with_rule(Nested<const Vec2> polys, const int depth, const FillRule rule) {
   const auto g = ExactSegmentGraph(polys);
   const auto edge_windings = Field<int, EdgeId>(constant_map(g.topology->n_edges(), 1).copy());
@@ -295,5 +416,6 @@ void wrap_polygon_csg() {
   GEODE_FUNCTION(split_polygons_greater)
   GEODE_FUNCTION(split_polygons_parity)
   GEODE_FUNCTION(split_polygons_neq)
+  GEODE_FUNCTION(parallel_polygon_union)
   GEODE_FUNCTION(compare_splitting_algorithms)
 }
@@ -6,8 +6,8 @@
 // Since any newly constructed points are inexactly quantized, the CSG routines are not necessarily idempotent:
 // calling polygon_union multiple times may add more and more points.
 //
-// Warning: The worst case complexity of these algorithms is quadratic, since O(n) arbitrary line segments may
-// have up to O(n^2) intersections, and contour depth is computed in a worst case O(n^2) fashion.
+// Intersections and contour depths are found with a single sweep in O((n+k) log n) time, where k is the number
+// of intersections.  Warning: O(n) arbitrary line segments may still have up to O(n^2) intersections.
 
 #include <geode/exact/config.h>
 #include <geode/array/Nested.h>
@@ -29,6 +29,10 @@ template<class... Polys> static inline Nested<Vec2> polygon_intersection(const P
   return split_polygons(concatenate(polys...),sizeof...(Polys)-1);
 }
 
+// Union many polygons by unioning spatially coherent groups in parallel and merging the results pairwise.
+// Holes must immediately follow the contour containing them.  threads = 0 uses all available threads.
+GEODE_CORE_EXPORT Nested<Vec2> parallel_polygon_union(Nested<const Vec2> polys, const int threads);
+
 enum class FillRule { Greater, Parity, NotEqual };
 GEODE_CORE_EXPORT std::string str(const FillRule rule);
 GEODE_CORE_EXPORT Nested<Vec2> split_polygons_with_rule(Nested<const Vec2> polys, const int depth, const FillRule rule);
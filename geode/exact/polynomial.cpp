@@ -94,6 +94,7 @@ static inline void mpz_div_exact_ui(RawArray<mp_limb_t> x, const mp_limb_t s) {
 }
 
 void in_place_interpolating_polynomial(const int degree, RawArray<const uint8_t,2> lambda, Subarray<mp_limb_t,2> A) {
+  clear_avx_state();
   // For now we are lazy, and index using a rectangular helper array mapping multi-indices to flat indices
   const int n = lambda.n;
   Array<int> powers(n+1,uninit);
@@ -161,6 +162,7 @@ void in_place_interpolating_polynomial(const int degree, RawArray<const uint8_t,
 
 void scaled_univariate_in_place_interpolating_polynomial(Subarray<mp_limb_t,2> A) {
   const int degree = A.m;
+  clear_avx_state();
   // Multiply by the inverse of the lower triangular part.
   // Equivalently, iterate divided differences for degree passes, but skip the divisions to preserve integers.
   // Since pass p would divide by p, skipping them all multiplies the result by degree!.
@@ -5,9 +5,11 @@
 #include <geode/exact/math.h>
 #include <geode/exact/perturb.h>
 #include <geode/exact/scope.h>
-#include <geode/array/RawArray.h>
+#include <geode/array/Array.h>
+#include <geode/python/stl.h>
 #include <geode/python/wrap.h>
 #include <geode/random/Random.h>
+#include <geode/utility/time.h>
 namespace geode {
 
 using exact::Perturbed;
@@ -101,6 +103,24 @@ bool segment_intersection_above_point(const P2 a0, const P2 a1, const P2 b0, con
        ^ segment_directions_oriented(b0,b1,a0,a1);
 }
 
+namespace {
+struct SegmentIntersectionsAbove { template<class TV> static inline PredicateType<5,TV> eval(const TV a0, const TV a1, const TV b0, const TV b1, const TV c0, const TV c1, const TV d0, const TV d1) {
+  const auto da = a1-a0,
+             db = b1-b0,
+             dc = c1-c0,
+             dd = d1-d0;
+  // intersect(a,b).y = a0.y + da.y*edet(b0-a0,db)/edet(da,db), and similarly for c,d
+  const auto ab = edet(da,db),
+             cd = edet(dc,dd);
+  return (a0.y-c0.y)*ab*cd+da.y*edet(b0-a0,db)*cd-dc.y*edet(d0-c0,dd)*ab;
+}};}
+bool segment_intersections_above(const P2 a0, const P2 a1, const P2 b0, const P2 b1,
+                                 const P2 c0, const P2 c1, const P2 d0, const P2 d1) {
+  return perturbed_predicate<SegmentIntersectionsAbove>(a0,a1,b0,b1,c0,c1,d0,d1)
+       ^ segment_directions_oriented(a0,a1,b0,b1)
+       ^ segment_directions_oriented(c0,c1,d0,d1);
+}
+
 namespace {
 struct RayIntersectionsRightwards { template<class TV> static inline PredicateType<3,TV> eval(const TV a0, const TV a1, const TV b0, const TV b1, const TV c) {
   const auto da = a1 - a0;
@@ -144,6 +164,20 @@ bool tetrahedron_oriented(const P3 p0, const P3 p1, const P3 p2, const P3 p3) {
   return perturbed_predicate<TetrahedronOriented>(p0,p1,p2,p3);
 }
 
+namespace {
+struct Insphere { template<class TV> static inline PredicateType<5,TV> eval(const TV p0, const TV p1, const TV p2, const TV p3, const TV p4) {
+  const auto d0 = p0-p4,
+             d1 = p1-p4,
+             d2 = p2-p4,
+             d3 = p3-p4;
+  // Expand the 4x4 determinant along the quadratic column, as in Incircle
+  return esqr_magnitude(d0)*edet(d1,d2,d3)-esqr_magnitude(d1)*edet(d0,d2,d3)
+        +esqr_magnitude(d2)*edet(d0,d1,d3)-esqr_magnitude(d3)*edet(d0,d1,d2);
+}};}
+bool insphere(const P3 p0, const P3 p1, const P3 p2, const P3 p3, const P3 p4) {
+  return perturbed_predicate<Insphere>(p0,p1,p2,p3,p4);
+}
+
 namespace {
 struct SegmentTriangleOriented {
   template<class TV> static inline PredicateType<3,TV> eval(const TV a0, const TV a1,
@@ -199,6 +233,47 @@ bool triangles_oriented(const P3 a0, const P3 a1, const P3 a2,
   return perturbed_predicate<TrianglesOriented>(a0,a1,a2,b0,b1,b2,c0,c1,c2);
 }
 
+// Batch predicates
+
+void triangle_oriented(RawArray<bool> result, RawArray<const Vector<P2,3>> args) {
+  perturbed_predicates<TriangleOriented>(result,args);
+}
+
+void incircle(RawArray<bool> result, RawArray<const Vector<P2,4>> args) {
+  perturbed_predicates<Incircle>(result,args);
+}
+
+void tetrahedron_oriented(RawArray<bool> result, RawArray<const Vector<P3,4>> args) {
+  perturbed_predicates<TetrahedronOriented>(result,args);
+}
+
+void insphere(RawArray<bool> result, RawArray<const Vector<P3,5>> args) {
+  perturbed_predicates<Insphere>(result,args);
+}
+
+void segments_intersect(RawArray<bool> result, RawArray<const Vector<P2,4>> args) {
+  GEODE_ASSERT(result.size()==args.size());
+  // Most candidate pairs are separated by the line through one of the segments, so filter that test in bulk
+  const int full = args.size()/filter_lanes*filter_lanes;
+  for (int i=0;i<full;i+=filter_lanes) {
+    #define SIGNS(s,a0,a1,b) \
+      int s[filter_lanes]; \
+      perturbed_filter_signs<TriangleOriented,3>(s,[=](const int k, const int j) { \
+        return args[i+k][j==0 ? a0 : j==1 ? a1 : b]; });
+    SIGNS(s0,0,1,2) SIGNS(s1,0,1,3)
+    #undef SIGNS
+    for (int k=0;k<filter_lanes;k++) {
+      const auto& a = args[i+k];
+      result[i+k] = s0[k] && s0[k]==s1[k] ? false // b lies on one side of a
+                                          : segments_intersect(a[0],a[1],a[2],a[3]);
+    }
+  }
+  for (int i=full;i<args.size();i++) {
+    const auto& a = args[i];
+    result[i] = segments_intersect(a[0],a[1],a[2],a[3]);
+  }
+}
+
 // Unit tests.  Warning: These do not check the geometric correctness of the predicates, only properties of exact computation and perturbation.
 
 static void predicate_tests() {
@@ -236,6 +311,174 @@ static void predicate_tests() {
     GEODE_ASSERT(!incircle(p0,p1,p2,p3));
     GEODE_ASSERT( incircle(p0,p1,p3,p2));
   }
+
+  // Check insphere against a positively oriented corner tetrahedron, then against approximate floating point
+  typedef Vector<double,3> TV3;
+  typedef Vector<Quantized,3> QV3;
+  for (const int i : range(1,exact::log_bound-1)) {
+    const auto b = ExactInt(1)<<i;
+    const auto q0 = P3(0,QV3(0,0,0)), q1 = P3(1,QV3(b,0,0)), q2 = P3(2,QV3(0,b,0)), q3 = P3(3,QV3(0,0,b));
+    GEODE_ASSERT(tetrahedron_oriented(q0,q1,q2,q3));
+    GEODE_ASSERT( insphere(q0,q1,q2,q3,P3(4,QV3(b/4,b/4,b/4))));
+    GEODE_ASSERT(!insphere(q0,q1,q2,q3,P3(4,QV3(-b,-b,-b))));
+    GEODE_ASSERT(!insphere(q0,q1,q3,q2,P3(4,QV3(b/4,b/4,b/4))));
+  }
+  for (int step=0;step<100;step++) {
+    #define MAKE3(i) \
+      const auto q##i = P3(i,QV3(random->uniform<Vector<ExactInt,3>>(-exact::bound,exact::bound))); \
+      const TV3 y##i(q##i.value());
+    MAKE3(0) MAKE3(1) MAKE3(2) MAKE3(3) MAKE3(4)
+    const auto e0 = y0-y4, e1 = y1-y4, e2 = y2-y4, e3 = y3-y4;
+    const double s = esqr_magnitude(e0)*edet(e1,e2,e3)-esqr_magnitude(e1)*edet(e0,e2,e3)
+                    +esqr_magnitude(e2)*edet(e0,e1,e3)-esqr_magnitude(e3)*edet(e0,e1,e2);
+    GEODE_ASSERT(insphere(q0,q1,q2,q3,q4)==(s>0));
+  }
+
+  // Compare segment_intersections_above against approximate floating point, skipping nearly equal heights
+  for (int step=0;step<100;step++) {
+    MAKE(0) MAKE(1) MAKE(2) MAKE(3)
+    #define MAKE_SEGMENT(i,j) \
+      const auto p##i = P2(i,QV2(random->uniform<Vector<ExactInt,2>>(-exact::bound,exact::bound))); \
+      const TV2 x##i(p##i.value()); \
+      const auto p##j = P2(j,QV2(random->uniform<Vector<ExactInt,2>>(-exact::bound,exact::bound))); \
+      const TV2 x##j(p##j.value());
+    MAKE_SEGMENT(4,5) MAKE_SEGMENT(6,7)
+    #undef MAKE_SEGMENT
+    const auto height = [](const TV2 a0, const TV2 a1, const TV2 b0, const TV2 b1) {
+      return a0.y+(a1-a0).y*edet(b0-a0,b1-b0)/edet(a1-a0,b1-b0);
+    };
+    const double ab = height(x0,x1,x2,x3),
+                 cd = height(x4,x5,x6,x7);
+    if (abs(ab-cd) > 1e-6*max(abs(ab),abs(cd))) {
+      GEODE_ASSERT(segment_intersections_above(p0,p1,p2,p3,p4,p5,p6,p7)==(ab>cd));
+      GEODE_ASSERT(segment_intersections_above(p4,p5,p6,p7,p0,p1,p2,p3)==(cd>ab));
+    }
+    // Intersections sharing a segment
+    GEODE_ASSERT(segment_intersections_above(p0,p1,p2,p3,p0,p1,p4,p5)!=segment_intersections_above(p0,p1,p4,p5,p0,p1,p2,p3));
+  }
+
+  // Compare batch predicates against scalar versions, using small coordinates so that many lanes are degenerate
+  for (const int scale : vec(3,exact::bound)) {
+    const int n = 103; // Not a multiple of filter_lanes
+    Array<P2> X2(20,uninit);
+    Array<P3> X3(20,uninit);
+    for (const int i : range(X2.size())) {
+      X2[i] = P2(i,QV2(random->uniform<Vector<ExactInt,2>>(-scale,scale+1)));
+      X3[i] = P3(i,QV3(random->uniform<Vector<ExactInt,3>>(-scale,scale+1)));
+    }
+    #define ARGS(P,X,k) \
+      Array<Vector<P,k>> args##k(n,uninit); \
+      for (auto& a : args##k) \
+        for (const int j : range(k)) \
+          a[j] = X[4*j+random->uniform<int>(0,4)]; /* Distinct indices */ \
+      Array<bool> result##k(n,uninit);
+    {
+      ARGS(P2,X2,3) ARGS(P2,X2,4)
+      triangle_oriented(result3,args3);
+      for (const int i : range(n))
+        GEODE_ASSERT(result3[i]==triangle_oriented(args3[i][0],args3[i][1],args3[i][2]));
+      incircle(result4,args4);
+      for (const int i : range(n))
+        GEODE_ASSERT(result4[i]==incircle(args4[i][0],args4[i][1],args4[i][2],args4[i][3]));
+      segments_intersect(result4,args4);
+      for (const int i : range(n))
+        GEODE_ASSERT(result4[i]==segments_intersect(args4[i][0],args4[i][1],args4[i][2],args4[i][3]));
+    } {
+      ARGS(P3,X3,4) ARGS(P3,X3,5)
+      tetrahedron_oriented(result4,args4);
+      for (const int i : range(n))
+        GEODE_ASSERT(result4[i]==tetrahedron_oriented(args4[i][0],args4[i][1],args4[i][2],args4[i][3]));
+      insphere(result5,args5);
+      for (const int i : range(n))
+        GEODE_ASSERT(result5[i]==insphere(args5[i][0],args5[i][1],args5[i][2],args5[i][3],args5[i][4]));
+    }
+    #undef ARGS
+  }
+}
+
+
+// Exact<d> with all arithmetic routed through generic GMP routines, for comparison with the autogenerated ones
+namespace {
+template<int d> struct GmpExact {
+  static const int degree = d;
+  Exact<d> x;
+
+  GmpExact() {}
+
+  explicit GmpExact(const Exact<d>& x)
+    : x(x) {}
+};
+
+template<int a> static inline GmpExact<a> operator+(const GmpExact<a> x, const GmpExact<a> y) {
+  return GmpExact<a>(gmp_add(x.x,y.x));
+}
+template<int a> static inline GmpExact<a> operator-(const GmpExact<a> x, const GmpExact<a> y) {
+  return GmpExact<a>(gmp_sub(x.x,y.x));
+}
+template<int a> static inline GmpExact<a> operator-(const GmpExact<a> x) {
+  return GmpExact<a>(gmp_neg(x.x));
+}
+template<int a,int b> static inline GmpExact<a+b> operator*(const GmpExact<a> x, const GmpExact<b> y) {
+  return GmpExact<a+b>(gmp_mul(x.x,y.x));
+}
+template<int a> static inline GmpExact<2*a> sqr(const GmpExact<a> x) {
+  return GmpExact<2*a>(gmp_sqr(x.x));
+}
+template<int a> static inline GmpExact<a> operator<<(const GmpExact<a> x, const int s) {
+  return GmpExact<a>(gmp_lshift(x.x,s));
+}
+}
+template<int d> struct IsScalar<GmpExact<d>> : public mpl::true_ {};
+template<int d,int m> struct PredicateTypeHelper<d,Vector<GmpExact<1>,m>> { typedef GmpExact<d> type; };
+
+template<int d> static inline const Exact<d>& asexact(const Exact<d>& x) { return x; }
+template<int d> static inline const Exact<d>& asexact(const GmpExact<d>& x) { return x.x; }
+
+template<class F,class TV,class... entries> static inline auto
+eval_at(const TV* X, Types<entries...>) -> decltype(F::eval(X[entries::value]...)) {
+  return F::eval(X[entries::value]...);
+}
+
+// Average nanoseconds per exact evaluation of F on consecutive n-tuples of X, using either Exact or GmpExact.
+// The number of negative results is returned so that the two can be checked against each other.
+template<class F,class S,int m,int n> static double exact_predicate_time(RawArray<const Vector<ExactInt,m>> X,
+                                                                         const int steps, int& negatives) {
+  const int count = X.size()/n;
+  Array<Vector<S,m>> Y(X.size(),uninit);
+  for (const int i : range(X.size()))
+    for (const int a : range(m))
+      Y[i][a] = S(Exact<1>(X[i][a]));
+  negatives = 0;
+  const double start = get_time();
+  for (int s=0;s<steps;s++)
+    for (int i=0;i<count;i++)
+      negatives += is_negative(asexact(eval_at<F>(&Y[n*i],IRange<n>())));
+  return 1e9*(get_time()-start)/(steps*count);
+}
+
+template<class F,int m,int n> static Tuple<string,double,double> exact_predicate_benchmark(const char* name,
+                                                                                            const int steps) {
+  const auto random = new_<Random>(1731);
+  Array<Vector<ExactInt,m>> X(1024*n,uninit);
+  for (auto& x : X)
+    x = random->uniform<Vector<ExactInt,m>>(-exact::bound,exact::bound);
+  int fast_negatives, gmp_negatives;
+  const auto r = tuple(string(name),exact_predicate_time<F,Exact<1>,m,n>(X,steps,fast_negatives),
+                                    exact_predicate_time<F,GmpExact<1>,m,n>(X,steps,gmp_negatives));
+  GEODE_ASSERT(fast_negatives==gmp_negatives);
+  return r;
+}
+
+// For each predicate, the time in nanoseconds of exact evaluation with autogenerated arithmetic and with GMP
+static vector<Tuple<string,double,double>> exact_predicate_benchmarks(const int steps) {
+  vector<Tuple<string,double,double>> results;
+  results.push_back(exact_predicate_benchmark<TriangleOriented,2,3>("triangle_oriented",steps));
+  results.push_back(exact_predicate_benchmark<Incircle,2,4>("incircle",steps));
+  results.push_back(exact_predicate_benchmark<SegmentIntersectionsOrdered,2,6>("segment_intersections_ordered",steps));
+  results.push_back(exact_predicate_benchmark<TetrahedronOriented,3,4>("tetrahedron_oriented",steps));
+  results.push_back(exact_predicate_benchmark<Insphere,3,5>("insphere",steps));
+  results.push_back(exact_predicate_benchmark<TrianglesOriented,3,9>("triangles_oriented",steps));
+  return results;
 }
 
 }
@@ -243,4 +486,5 @@ using namespace geode;
 
 void wrap_predicates() {
   GEODE_FUNCTION(predicate_tests)
+  GEODE_FUNCTION(exact_predicate_benchmarks)
 }
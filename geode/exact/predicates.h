@@ -2,6 +2,7 @@
 #pragma once
 
 #include <geode/exact/config.h>
+#include <geode/array/forward.h>
 #include <geode/vector/Vector.h>
 namespace geode {
 
@@ -60,6 +61,10 @@ GEODE_CORE_EXPORT GEODE_PURE bool segment_intersections_ordered(const P2 a0, con
 GEODE_CORE_EXPORT GEODE_PURE bool segment_intersection_above_point(const P2 a0, const P2 a1,
                                                                    const P2 b0, const P2 b1, const P2 c);
 
+// Given segments a,b,c,d, is intersect(a,b) above intersect(c,d)?  The two pairs must differ.
+GEODE_CORE_EXPORT GEODE_PURE bool segment_intersections_above(const P2 a0, const P2 a1, const P2 b0, const P2 b1,
+                                                              const P2 c0, const P2 c1, const P2 d0, const P2 d1);
+
 // Given segments a,b and a ray origin c, does a rightwards ray from c intersect [a0,a1] before [b0,b1]
 GEODE_CORE_EXPORT GEODE_PURE bool ray_intersections_rightwards(const P2 a0, const P2 a1,
                                                                const P2 b0, const P2 b1, const P2 c);
@@ -76,6 +81,9 @@ GEODE_CORE_EXPORT GEODE_PURE bool segments_intersect(const P2 a0, const P2 a1, c
 GEODE_CORE_EXPORT GEODE_PURE bool tetrahedron_oriented(const P3 p0, const P3 p1,
                                                        const P3 p2, const P3 p3);
 
+// Does p4 lie inside the sphere defined by p0,p1,p2,p3?  This predicate is antisymmetric.
+GEODE_CORE_EXPORT GEODE_PURE bool insphere(const P3 p0, const P3 p1, const P3 p2, const P3 p3, const P3 p4);
+
 // Does segment a0,a1 intersect triangle b0,b1,b2?
 GEODE_CORE_EXPORT GEODE_PURE bool segment_triangle_intersect(const P3 a0, const P3 a1,
                                                              const P3 b0, const P3 b1, const P3 b2);
@@ -94,6 +102,20 @@ GEODE_CORE_EXPORT GEODE_PURE bool triangles_oriented(const P3 a0, const P3 a1, c
                                                      const P3 b0, const P3 b1, const P3 b2,
                                                      const P3 c0, const P3 c1, const P3 c2);
 
+/*** Batch predicates ***/
+
+// Batch versions of the above: result[i] is the predicate applied to the entries of args[i].  The floating point filter
+// is evaluated several tuples at a time with SIMD arithmetic, so these are faster than separate calls when many
+// predicates are independent, such as when testing candidate pairs collected during a BoxTree traversal.
+// Delaunay triangulation and mesh_csg do not use them.  In delaunay_flips each incircle result decides which edge is
+// tested next.  The edge-face tests in mesh_csg are chains of tetrahedron_oriented calls with early exits, and batch
+// orientation tests are only about 15% faster than scalar ones, which would not pay for staging the chains.
+GEODE_CORE_EXPORT void triangle_oriented(RawArray<bool> result, RawArray<const Vector<P2,3>> args);
+GEODE_CORE_EXPORT void incircle(RawArray<bool> result, RawArray<const Vector<P2,4>> args);
+GEODE_CORE_EXPORT void segments_intersect(RawArray<bool> result, RawArray<const Vector<P2,4>> args);
+GEODE_CORE_EXPORT void tetrahedron_oriented(RawArray<bool> result, RawArray<const Vector<P3,4>> args);
+GEODE_CORE_EXPORT void insphere(RawArray<bool> result, RawArray<const Vector<P3,5>> args);
+
 #undef P3
 #undef P2
 
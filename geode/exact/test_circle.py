@@ -252,9 +252,65 @@ def test_negative_offsets(seed=7056389):
   empty_arcs = offset_arcs(random_circle_arcs(10,10), -100.)
   assert len(empty_arcs) == 0
 
+def test_simplify():
+  random.seed(1117)
+  # A slightly noisy circle made of many arcs collapses to two arcs
+  n = 100
+  angles = 2*pi/n*arange(n)
+  arcs = empty((1,n),dtype=CircleArc).view(recarray)
+  arcs.x = (1+1e-8*random.uniform(-1,1,size=(n,1)))*transpose([cos(angles),sin(angles)])
+  arcs.q = tan(2*pi/n/4)
+  arcs = Nested(arcs)
+  simple = simplify_circle_arcs(arcs,1e-6)
+  assert len(simple)==1 and len(simple.flat)==2
+  assert allclose(circle_arc_area(simple),circle_arc_area(arcs))
+  # Feeding offsets back into themselves stays small if we simplify in between
+  arcs0 = arcs1 = arcs
+  for i in xrange(8):
+    d = .03 if i%2 else -.02
+    arcs0 = offset_arcs(arcs0,d)
+    arcs1 = simplify_circle_arcs(offset_arcs(arcs1,d),1e-6)
+  assert len(arcs1.flat)<=4<len(arcs0.flat)
+  assert allclose(circle_arc_area(arcs1),circle_arc_area(arcs0))
+
+def test_simplify_near_touching():
+  # Two circles whose dents keep them apart, so that removing the dents would make them overlap.  Simplification
+  # must keep the dents, leaving the same contours without crossings.
+  n = 100
+  angles = 2*pi/n*arange(n)+pi/2
+  arcs = empty((2,n),dtype=CircleArc).view(recarray)
+  r = ones((2,n))
+  r[0,3*n//4] = r[1,n//4] = 1-5e-4
+  arcs.x = (r[...,None]*transpose([cos(angles),sin(angles)]))+[[[0,0]],[[2-3e-4,0]]]
+  arcs.q = tan(2*pi/n/4)
+  arcs = Nested(arcs)
+  simple = simplify_circle_arcs(arcs,1e-3)
+  assert len(simple)==len(arcs) and len(simple.flat)<len(arcs.flat)//4
+  again = circle_arc_union(simple)
+  assert len(again)==len(simple) and len(again.flat)==len(simple.flat)
+  assert allclose(circle_arc_area(again),circle_arc_area(simple))
+
+def test_parallel_union():
+  random.seed(1731)
+  n = 500
+  arcs = empty((n,2),dtype=CircleArc).view(recarray)
+  c = random.uniform(0,sqrt(n),size=(n,1,2))
+  r = random.uniform(.3,.8,size=(n,1))
+  arcs.x = c+r[...,None]*[[1,0],[-1,0]]
+  arcs.q = 1
+  arcs = Nested(arcs)
+  serial = circle_arc_union(arcs)
+  for threads in 1,3,8:
+    parallel = parallel_circle_arc_union(arcs,threads)
+    assert len(parallel)==len(serial)
+    assert allclose(circle_arc_area(parallel),circle_arc_area(serial))
+
 if __name__=='__main__':
   test_offsets()
   test_negative_offsets()
   test_circle_quantize()
   test_single_circle()
   test_circles()
+  test_simplify()
+  test_simplify_near_touching()
+  test_parallel_union()
@@ -7,6 +7,10 @@ import sys
 def test_fast_exact():
   fast_exact_tests()
 
+def test_exact_benchmarks(steps=1):
+  for name,fast,gmp in exact_predicate_benchmarks(steps):
+    Log.write('%s: generated %.1f ns, gmp %.1f ns'%(name,fast,gmp))
+
 def test_interval():
   interval_tests(1024)
 
@@ -16,6 +20,16 @@ def test_predicates():
 def test_constructions():
   construction_tests()
 
+def test_predicate_tiers():
+  # Counts are collected only if PREDICATE_COUNTERS is turned on in perturb.h
+  clear_predicate_tier_counts()
+  random.seed(7)
+  delaunay_points(random.randn(1000,2))
+  for name,filter,interval,exact in predicate_tier_counts():
+    Log.write('%s: filter %d, interval %d, exact %d'%(name,filter,interval,exact))
+    if 'Incircle' in name:
+      assert filter>10*(interval+exact)
+
 def test_delaunay(benchmark=False,cgal=False,origin=True,circle=False,constrain=True):
   def simple(ns):
     return ((n,i,0) for i,n in enumerate(ns))
@@ -56,6 +70,168 @@ def test_delaunay(benchmark=False,cgal=False,origin=True,circle=False,constrain=
             if n>0 and mesh.n_faces!=nf:
               Log.write('expected %d faces, got %d'%(mesh.n_faces,nf))
 
+def test_delaunay_threads(benchmark=False):
+  for n in [3,4,5,7,10,33,100,1000]+benchmark*[1<<20]:
+    for name in 'gaussian','circle','grid','origin':
+      random.seed(n)
+      if name=='gaussian': X = random.randn(n,2)
+      elif name=='circle': X = polar(random.uniform(0,2*pi,n))
+      elif name=='grid':   X = asarray(divmod(arange(n),7),dtype=real).T
+      else:                X = zeros((n,2))
+      serial = None
+      for threads in 1,2,3,7,0:
+        with Log.scope('delaunay %s %d, threads %d'%(name,n,threads)):
+          mesh = delaunay_points(X,validate=not benchmark,threads=threads)
+        # Faces and halfedges are numbered identically regardless of thread count
+        mesh.assert_consistent(True)
+        tris = mesh.elements()
+        loops = mesh.boundary_loops()
+        if serial is None:
+          serial = tris,loops
+        else:
+          assert all(serial[0]==tris)
+          assert all(serial[1].offsets==loops.offsets) and all(serial[1].flat==loops.flat)
+
+def test_delaunay_3d(benchmark=False):
+  def volumes(X,tets):
+    e = X[tets[:,1:]]-X[tets[:,:1]]
+    return (cross(e[:,0],e[:,1])*e[:,2]).sum(axis=-1)/6
+  corners = asarray([[i&1,i>>1&1,i>>2&1] for i in xrange(8)],dtype=real)
+  random.seed(8131)
+  for n in [0,1,10,100,2000]+benchmark*[1000000,10000000]:
+    for name in 'uniform','grid':
+      if name=='uniform': X = concatenate([corners,random.uniform(0,1,(n,3))])
+      else:               X = concatenate([corners,random.randint(0,5,(n,3))/4])
+      with Log.scope('delaunay 3d %s %d, validate %d'%(name,n,not benchmark)):
+        tets = delaunay_points_3d(X,validate=not benchmark)
+      if not benchmark:
+        # Tets are positively oriented and exactly fill the cube
+        vol = volumes(X,tets)
+        assert all(vol>=-1e-14)
+        assert allclose(vol.sum(),1)
+        if name=='uniform':
+          assert all(unique(tets)==arange(len(X)))
+        # Generic input gives a valid StrainMeasure rest state, while the grid's duplicate points produce zero
+        # volume tets, which StrainMeasure rejects
+        if n>=100:
+          if name=='uniform':
+            assert all(vol>0)
+            StrainMeasure3d(tets,X)
+          else:
+            assert any(vol==0)
+            try:
+              StrainMeasure3d(tets,X)
+              assert False,'StrainMeasure accepted zero volume tets'
+            except RuntimeError:
+              pass
+
+def test_dynamic_delaunay():
+  def canonical(tris):
+    tris = asarray([roll(t,-argmin(t)) for t in tris])
+    return tris[lexsort(tris.T[::-1])]
+  random.seed(1731)
+  X = random.uniform(-1,1,(300,2))
+  d = DynamicDelaunay(Box(-ones(2),ones(2)))
+  vs = list(d.insert_many(X[:200]))+[d.insert(x) for x in X[200:]]
+  assert vs==range(3,303)
+  d.assert_delaunay()
+  # Remove a random subset, and compare against a static triangulation of the survivors
+  alive = ones(len(X),dtype=bool)
+  for i in random.permutation(len(X))[:120]:
+    d.erase(vs[i])
+    alive[i] = False
+  d.assert_delaunay()
+  keep = nonzero(alive)[0]
+  expected = asarray(vs)[keep][delaunay_points(X[keep]).elements()]
+  assert all(canonical(d.elements())==canonical(expected))
+  # Constraints survive later insertions, and intersecting constraints are rejected
+  def has_edge(a,b):
+    return any(a in t and b in t for t in d.elements())
+  p = [d.insert(x) for x in [(-.9,-.9),(.9,.9),(-.9,.9),(.9,-.9)]]
+  d.add_constraint(p[0],p[1])
+  for x in random.uniform(-1,1,(50,2)):
+    d.insert(x)
+  d.assert_delaunay()
+  assert has_edge(p[0],p[1])
+  # The two diagonals cross at the origin, so the second must be rejected
+  try:
+    d.add_constraint(p[2],p[3])
+    assert False
+  except ValueError:
+    pass
+  assert has_edge(p[0],p[1])
+  # A constraint which only shares an endpoint with the first is fine
+  d.add_constraint(p[0],p[2])
+  d.assert_delaunay()
+  assert has_edge(p[0],p[1]) and has_edge(p[0],p[2])
+
+def test_triangle_locator():
+  random.seed(8127)
+  X = random.uniform(-1,1,(1000,2))
+  mesh = delaunay_points(X)
+  locate = TriangleLocator(mesh,X)
+  Y = random.uniform(-1.2,1.2,(5000,2))
+  for threads in 1,3:
+    faces,weights = locate.locate(Y,threads)
+    inside = faces>=0
+    tris = mesh.elements()[faces[inside]]
+    w = weights[inside]
+    assert all(w>=-1e-10)
+    assert allclose(w.sum(axis=-1),1)
+    assert allclose((w[...,None]*X[tris]).sum(axis=1),Y[inside])
+    assert all(weights[~inside]==0)
+  # Points outside the convex hull are never located
+  assert not any(inside[abs(Y).max(axis=-1)>1])
+  for i in xrange(0,len(Y),50):
+    assert locate.face(Y[i])==faces[i]
+  # Degenerate bounding boxes: collinear points, and a single point with no faces
+  for X,mesh in ((asarray([(0,0),(1,0),(3,0)],dtype=float),TriangleTopology([(0,1,2)])),
+                 (asarray([(.5,.5)]),TriangleTopology())):
+    locate = TriangleLocator(mesh,X)
+    Y = concatenate([random.uniform(-1,4,(100,2)),X])
+    faces,weights = locate.locate(Y,2)
+    assert all(faces[Y[:,1]!=X[0,1]]<0)
+    assert all(isfinite(weights))
+    if not mesh.n_faces:
+      assert all(faces<0) and all(weights==0)
+    else:
+      # Zero area faces get finite, nonnegative weights which reproduce points on the face
+      for y in (.5,0),(2,0),(3,0),(5,1):
+        w = locate.weights(0,y)
+        assert all(w>=0) and allclose(w.sum(),1)
+        if y[1]==0 and y[0]<=3:
+          assert allclose(dot(w,X),y)
+    for i in xrange(len(Y)):
+      assert locate.face(Y[i])==faces[i]
+
+def test_polygon_locator():
+  random.seed(8128)
+  angles = 2*pi/20*arange(20)
+  circle = transpose([cos(angles),sin(angles)])
+  polys = []
+  for i in xrange(100):
+    p = random.uniform(-1,1,2)+random.uniform(.1,.4)*random.uniform(.5,1,(20,1))*circle
+    polys.append(p[::-1] if i%3==2 else p)
+  locate = PolygonLocator(Nested(polys))
+  Y = random.uniform(-1.5,1.5,(5000,2))
+  # Brute force winding numbers
+  expected = 0
+  for p in polys:
+    a,b = p[:,None],roll(p,-1,axis=0)[:,None]
+    c = (b[...,0]-a[...,0])*(Y[:,1]-a[...,1])-(b[...,1]-a[...,1])*(Y[:,0]-a[...,0])
+    up = (a[...,1]<=Y[:,1])&(b[...,1]>Y[:,1])&(c>0)
+    down = (a[...,1]>Y[:,1])&(b[...,1]<=Y[:,1])&(c<0)
+    expected = expected+up.sum(axis=0)-down.sum(axis=0)
+  for threads in 1,3:
+    assert all(locate.windings(Y,threads)==expected)
+    assert all(locate.inside(Y,threads)==(expected>0))
+  # Vertices are classified consistently
+  X = concatenate(polys)
+  w = locate.windings(X,1)
+  assert all(locate.windings(X,3)==w)
+  for i in xrange(0,len(X),37):
+    assert locate.winding(X[i])==w[i]
+
 def draw_polygons(polys):
   import pylab
   for p,points in enumerate(polys):
@@ -101,6 +277,41 @@ def test_polygon():
       print 'error = %g'%error
       assert False
 
+def test_polygon_nesting():
+  # A grid of squares with holes and islands, checked against areas computed by hand
+  n = 20
+  square = array([[0,0],[.8,0],[.8,.8],[0,.8]])
+  hole = .2+.4*square[::-1]/.8
+  island = .3+.2*square/.8
+  polys = []
+  for i in xrange(n):
+    for j in xrange(n):
+      polys.extend([square+(i,j),hole+(i,j),island+(i,j)])
+  polys = Nested(polys)
+  union = split_polygons(polys,0)
+  assert len(union)==3*n*n
+  assert allclose(polygon_area(union),n*n*(.64-.16+.04))
+  assert not len(split_polygons(polys,1))
+
+def test_parallel_polygon_union():
+  random.seed(8123)
+  n = 1000
+  angles = 2*pi/12*arange(12)
+  circle = transpose([cos(angles),sin(angles)])
+  polys = []
+  for i in xrange(n):
+    c = random.uniform(0,sqrt(n),size=2)
+    r = random.uniform(.3,.8)
+    polys.append(c+r*circle)
+    if i%3==0:
+      polys.append(c+.4*r*circle[::-1])
+  polys = Nested(polys)
+  serial = split_polygons(polys,0)
+  for threads in 1,3,8:
+    parallel = parallel_polygon_union(polys,threads)
+    assert len(parallel)==len(serial)
+    assert allclose(polygon_area(parallel),polygon_area(serial))
+
 if __name__=='__main__':
   Log.configure('exact tests',0,0,100)
   if '-b' in sys.argv:
@@ -108,10 +319,23 @@ if __name__=='__main__':
     circle = '-d' in sys.argv
     Mesh = HalfedgeMesh if '-h' in sys.argv else TriangleTopology
     test_delaunay(Mesh=Mesh,benchmark=True,origin=False,cgal=cgal,circle=circle,constrain=False)
+  elif '-t' in sys.argv:
+    test_delaunay_threads(benchmark=True)
+  elif '-3' in sys.argv:
+    test_delaunay_3d(benchmark=True)
   elif '-p' in sys.argv:
     test_polygon()
+  elif '-e' in sys.argv:
+    test_exact_benchmarks(steps=1000)
   else:
     test_fast_exact()
+    test_exact_benchmarks()
     test_predicates()
     test_constructions()
+    test_predicate_tiers()
     test_delaunay()
+    test_delaunay_threads()
+    test_delaunay_3d()
+    test_dynamic_delaunay()
+    test_triangle_locator()
+    test_polygon_locator()
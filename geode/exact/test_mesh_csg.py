@@ -76,7 +76,92 @@ def test_depth_weight():
     # the resulting mesh must have volume 1
     assert abs(result.volume(Xr)-1) < 1e-8
 
+def test_threads():
+  # Parallel splitting must be bit-identical to serial
+  sphere,Xs = sphere_mesh(3)
+  random.seed(7)
+  meshes = [(sphere,Xs+.7*random.randn(3)) for _ in xrange(4)]
+  soup,X = merge_meshes(meshes)
+  for depth in 0,1,None:
+    m0,Z0 = split_soup(soup,X,depth)
+    for threads in 2,4,0:
+      m,Z = split_soup(soup,X,depth,threads=threads)
+      assert all(m0.elements==m.elements)
+      assert all(Z0==Z)
+
+def test_closed_booleans():
+  # Two operand booleans must match splitting the concatenated soups
+  sphere,Xs = sphere_mesh(3)
+  a = merge_meshes([(sphere,.4*Xs+(i,0,0)) for i in xrange(4)])
+  b = (sphere,.5*Xs+(.3,.2,.1))
+  reversed_sphere = TriangleSoup(sphere.elements[:,(0,2,1)])
+  for op,flip,depth in (closed_soup_union,0,0),(closed_soup_intersection,0,1),(closed_soup_difference,1,0):
+    m0,Z0 = split_soup(*merge_meshes([a,(reversed_sphere if flip else sphere,b[1])]),depth=depth)
+    m,Z = op(a,b)
+    assert all(m0.elements==m.elements)
+    assert allclose(Z0,Z)
+
+def test_dynamic_mesh_csg():
+  # Moving vertices must match recomputing from scratch
+  random.seed(3)
+  sphere,Xs = sphere_mesh(3)
+  n = len(Xs)
+  mesh,X = merge_meshes([(sphere,.6*Xs+random.uniform(-1,1,3)) for i in xrange(5)])
+  box = Box(-3*ones(3),3*ones(3))
+  csg = DynamicMeshCSG(mesh,X,zeros(0,int32),box,1,False)
+  for step in xrange(6):
+    s = random.randint(5)
+    vs = arange(s*n,(s+1)*n if step%2 else s*n+n//4,dtype=int32)
+    X[vs] += random.uniform(-.3,.3,3)
+    retriangulated = csg.move(vs,X[vs])
+    moved = any(in1d(mesh.elements,vs).reshape(-1,3),axis=1).sum()
+    assert moved<=retriangulated<=len(mesh.elements)
+    Y = csg.positions()
+    assert allclose(Y,X)
+    for depth in 0,1:
+      m0,Z0 = split_soup(mesh,Y,depth)
+      m,Z = csg.result(depth)
+      assert len(m0.elements)==len(m.elements)
+      assert allclose(m0.volume(Z0),m.volume(Z))
+      assert allclose(sorted(map(tuple,Z0[unique(m0.elements)])),sorted(map(tuple,Z[unique(m.elements)])))
+
+def test_many_components():
+  # Depths of many disjoint components lined up along the ray direction
+  sphere,Xs = sphere_mesh(1)
+  n = 40
+  outer = merge_meshes([(sphere,.3*Xs+(i,0,0)) for i in xrange(n)])
+  inner = merge_meshes([(sphere,.1*Xs+(i,.01,0)) for i in xrange(0,n,2)])
+  mesh,X = merge_meshes([outer,inner])
+  for approximate in False,True:
+    m,Z = split_soup(mesh,X,depth=0,approximate_depths=approximate)
+    assert len(m.elements)==len(outer[0].elements)
+    assert allclose(m.volume(Z),outer[0].volume(outer[1]))
+    m,Z = split_soup(mesh,X,depth=1,approximate_depths=approximate)
+    assert len(m.elements)==len(inner[0].elements)
+
+def test_near_coincident_depths():
+  # Nearly coincident shells put the winding number estimate right next to many surfaces.  Approximate ray depths
+  # must agree with exact rays.
+  random.seed(7)
+  sphere,Xs = sphere_mesh(2)
+  parts = []
+  for i in xrange(30):
+    c = (.5*i,0,0)+random.uniform(-1e-3,1e-3,3)
+    for r in .3,.3*(1+1e-7),.2:
+      parts.append((sphere,r*Xs+c+random.uniform(-1e-8,1e-8,3)))
+  mesh,X = merge_meshes(parts)
+  for depth in 0,1,2:
+    m0,Z0 = split_soup(mesh,X,depth)
+    m,Z = split_soup(mesh,X,depth,approximate_depths=True)
+    assert all(m0.elements==m.elements)
+    assert all(Z0==Z)
+
 if __name__=='__main__':
   test_simple_triangulate()
   test_csg()
   test_depth_weight()
+  test_threads()
+  test_closed_booleans()
+  test_dynamic_mesh_csg()
+  test_many_components()
+  test_near_coincident_depths()
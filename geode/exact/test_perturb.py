@@ -66,6 +66,18 @@ def test_perturbed_sign():
 def test_perturbed_ratio():
   perturbed_ratio_test()
 
+def test_perturbation_memoization():
+  # Results must not depend on the caches, including when entries are reused
+  try:
+    for memo in (False,False),(True,False),(True,True):
+      set_perturbation_memoization(*memo)
+      for r in xrange(2):
+        test_perturbed_sign()
+        test_perturbed_ratio()
+  finally:
+    set_perturbation_memoization(False,False)
+  print 'perturbation cache counts = %s'%(perturbation_cache_counts(),)
+
 def test_irreducible():
   irreducible_test()
 
@@ -75,3 +87,4 @@ if __name__=='__main__':
   test_perturbed_sign()
   test_snap_divs()
   test_perturbed_ratio()
+  test_perturbation_memoization()
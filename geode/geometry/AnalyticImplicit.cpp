@@ -2,12 +2,18 @@
 // Class AnalyticImplicit
 //#####################################################################
 #include <geode/geometry/AnalyticImplicit.h>
+#include <geode/array/view.h>
 #include <geode/geometry/Box.h>
 #include <geode/geometry/Sphere.h>
 #include <geode/geometry/Capsule.h>
 #include <geode/geometry/Cylinder.h>
 #include <geode/geometry/Plane.h>
+#include <geode/math/clamp.h>
 #include <geode/python/Class.h>
+#include <geode/utility/range.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 namespace geode {
 
 typedef real T;
@@ -22,6 +28,253 @@ template<> GEODE_DEFINE_TYPE(AnalyticImplicit<Capsule<Vector<T,3>>>)
 template<> GEODE_DEFINE_TYPE(AnalyticImplicit<Cylinder>)
 template<> GEODE_DEFINE_TYPE(AnalyticImplicit<Plane<T>>)
 
+// Batch kernels.  The generic loops call the shape methods directly, which avoids a virtual call per point and lets
+// simple shapes such as Plane inline completely.  The specializations below cover shapes whose single point methods
+// branch, rewriting the branches as selects so that the loops vectorize across points.  Since sqrt may set errno,
+// loops containing it do not vectorize, so kernels work on chunks of points and take square roots in separate passes.
+
+static const int chunk = 256;
+
+static inline void sqrts(T* __restrict__ x, const int n) {
+  int i = 0;
+#ifdef __AVX__
+  if (is_same<T,double>::value)
+    for (;i+4<=n;i+=4)
+      _mm256_storeu_pd((double*)x+i,_mm256_sqrt_pd(_mm256_loadu_pd((const double*)x+i)));
+#endif
+  for (;i<n;i++)
+    x[i] = sqrt(x[i]);
+}
+
+template<class Shape> struct BatchLoops {
+  typedef typename Shape::VectorT TV;
+
+  static void phi(const Shape& shape, RawArray<const TV> X, RawArray<T> phi) {
+    for (const int i : range(X.size()))
+      phi[i] = shape.phi(X[i]);
+  }
+
+  static void normal(const Shape& shape, RawArray<const TV> X, RawArray<TV> normal) {
+    for (const int i : range(X.size()))
+      normal[i] = shape.normal(X[i]);
+  }
+
+  static void surface(const Shape& shape, RawArray<const TV> X, RawArray<TV> surface) {
+    for (const int i : range(X.size()))
+      surface[i] = shape.surface(X[i]);
+  }
+
+  static void lazy_inside(const Shape& shape, RawArray<const TV> X, RawArray<bool> inside) {
+    for (const int i : range(X.size()))
+      inside[i] = shape.lazy_inside(X[i]);
+  }
+};
+
+template<class Shape> struct Batch : public BatchLoops<Shape> {};
+
+template<int d> struct Batch<Sphere<Vector<T,d>>> : public BatchLoops<Sphere<Vector<T,d>>> {
+  typedef Vector<T,d> TV;
+
+  static void sqr_magnitudes(const TV c, const T* __restrict__ x, T* __restrict__ s, const int m) {
+    for (int i=0;i<m;i++) {
+      T sqr_mag = 0;
+      for (int a=0;a<d;a++)
+        sqr_mag += sqr(x[d*i+a]-c[a]);
+      s[i] = sqr_mag;
+    }
+  }
+
+  static void phi(const Sphere<TV>& sphere, RawArray<const TV> X, RawArray<T> phi) {
+    const T* x = scalar_view(X).data();
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      T* __restrict__ p = phi.data()+lo;
+      sqr_magnitudes(sphere.center,x+d*lo,p,m);
+      sqrts(p,m);
+      for (int i=0;i<m;i++)
+        p[i] -= sphere.radius;
+    }
+  }
+
+  // Scaled unit directions from the center plus an offset, matching normalized() at the center itself
+  static void directions(const Sphere<TV>& sphere, RawArray<const TV> X, RawArray<TV> result, const T scale,
+                         const TV offset) {
+    const TV c = sphere.center;
+    T mag[chunk];
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      const T* __restrict__ x = scalar_view(X).data()+d*lo;
+      T* __restrict__ u = scalar_view(result).data()+d*lo;
+      sqr_magnitudes(c,x,mag,m);
+      sqrts(mag,m);
+      for (int i=0;i<m;i++) {
+        const T inv = mag[i] ? 1/mag[i] : 0;
+        for (int a=0;a<d;a++)
+          u[d*i+a] = scale*(mag[i] ? (x[d*i+a]-c[a])*inv : T(a==0))+offset[a];
+      }
+    }
+  }
+
+  static void normal(const Sphere<TV>& sphere, RawArray<const TV> X, RawArray<TV> normal) {
+    directions(sphere,X,normal,1,TV());
+  }
+
+  static void surface(const Sphere<TV>& sphere, RawArray<const TV> X, RawArray<TV> surface) {
+    directions(sphere,X,surface,sphere.radius,sphere.center);
+  }
+
+  static void lazy_inside(const Sphere<TV>& sphere, RawArray<const TV> X, RawArray<bool> inside) {
+    const int n = X.size();
+    const T* __restrict__ x = scalar_view(X).data();
+    bool* __restrict__ in = inside.data();
+    const TV c = sphere.center;
+    const T sqr_r = sqr(sphere.radius);
+    for (int i=0;i<n;i++) {
+      T sqr_mag = 0;
+      for (int a=0;a<d;a++)
+        sqr_mag += sqr(x[d*i+a]-c[a]);
+      in[i] = sqr_mag<=sqr_r;
+    }
+  }
+};
+
+template<int d> struct Batch<Box<Vector<T,d>>> : public BatchLoops<Box<Vector<T,d>>> {
+  typedef Vector<T,d> TV;
+
+  static void phi(const Box<TV>& box, RawArray<const TV> X, RawArray<T> phi) {
+    const TV c = box.center(),
+             half = T(.5)*box.sizes();
+    T outside[chunk];
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      const T* __restrict__ x = scalar_view(X).data()+d*lo;
+      T* __restrict__ p = phi.data()+lo;
+      // Squared distance outside from the positive axis distances, and the largest axis distance
+      for (int i=0;i<m;i++) {
+        T sqr_out = 0,
+          largest = -numeric_limits<T>::infinity();
+        for (int a=0;a<d;a++) {
+          const T q = abs(x[d*i+a]-c[a])-half[a];
+          sqr_out += sqr(max(q,T(0)));
+          largest = max(largest,q);
+        }
+        outside[i] = sqr_out;
+        p[i] = largest;
+      }
+      sqrts(outside,m);
+      for (int i=0;i<m;i++)
+        p[i] = p[i]>0 ? outside[i] : p[i];
+    }
+  }
+
+  static void lazy_inside(const Box<TV>& box, RawArray<const TV> X, RawArray<bool> inside) {
+    const int n = X.size();
+    const T* __restrict__ x = scalar_view(X).data();
+    bool* __restrict__ in = inside.data();
+    const TV lo = box.min,
+             hi = box.max;
+    for (int i=0;i<n;i++) {
+      bool all = true;
+      for (int a=0;a<d;a++)
+        all &= (lo[a]<=x[d*i+a]) & (x[d*i+a]<=hi[a]);
+      in[i] = all;
+    }
+  }
+};
+
+template<int d> struct Batch<Capsule<Vector<T,d>>> : public BatchLoops<Capsule<Vector<T,d>>> {
+  typedef Vector<T,d> TV;
+
+  // Distances to the segment, clamping the projection parameter instead of branching
+  static void distances(const Capsule<TV>& capsule, const T* __restrict__ x, T* __restrict__ s, const int m) {
+    const TV x0 = capsule.segment.x0,
+             v = capsule.segment.x1-x0;
+    const T vv = sqr_magnitude(v),
+            inv_vv = vv ? 1/vv : 0;
+    for (int i=0;i<m;i++) {
+      T uv = 0;
+      for (int a=0;a<d;a++)
+        uv += (x[d*i+a]-x0[a])*v[a];
+      const T t = clamp(uv*inv_vv,T(0),T(1));
+      T sqr_dist = 0;
+      for (int a=0;a<d;a++)
+        sqr_dist += sqr(x[d*i+a]-x0[a]-t*v[a]);
+      s[i] = sqr_dist;
+    }
+    sqrts(s,m);
+  }
+
+  static void phi(const Capsule<TV>& capsule, RawArray<const TV> X, RawArray<T> phi) {
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      T* __restrict__ p = phi.data()+lo;
+      distances(capsule,scalar_view(X).data()+d*lo,p,m);
+      for (int i=0;i<m;i++)
+        p[i] -= capsule.radius;
+    }
+  }
+
+  static void lazy_inside(const Capsule<TV>& capsule, RawArray<const TV> X, RawArray<bool> inside) {
+    T dist[chunk];
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      distances(capsule,scalar_view(X).data()+d*lo,dist,m);
+      for (int i=0;i<m;i++)
+        inside[lo+i] = dist[i]<=capsule.radius;
+    }
+  }
+};
+
+template<> struct Batch<Cylinder> : public BatchLoops<Cylinder> {
+  typedef Vector<T,3> TV;
+
+  static void phi(const Cylinder& cylinder, RawArray<const TV> X, RawArray<T> phi) {
+    const TV x0 = cylinder.base.x0,
+             N = cylinder.base.n;
+    const T radius = cylinder.radius,
+            height = cylinder.height;
+    T h[chunk], s[chunk];
+    for (int lo=0;lo<X.size();lo+=chunk) {
+      const int m = min(chunk,X.size()-lo);
+      const T* __restrict__ x = scalar_view(X).data()+3*lo;
+      T* __restrict__ p = phi.data()+lo;
+      // Height along the axis and distance from the axis
+      for (int i=0;i<m;i++) {
+        const T vx = x[3*i]-x0.x, vy = x[3*i+1]-x0.y, vz = x[3*i+2]-x0.z,
+                hi = vx*N.x+vy*N.y+vz*N.z;
+        h[i] = hi;
+        s[i] = sqr(vx-hi*N.x)+sqr(vy-hi*N.y)+sqr(vz-hi*N.z);
+      }
+      sqrts(s,m);
+      // Distance to the rim if outside both the side and the caps, otherwise the larger of the two
+      for (int i=0;i<m;i++) {
+        const T rp = s[i]-radius,
+                hp = max(-h[i],h[i]-height);
+        p[i] = max(hp,rp);
+        s[i] = (hp>0)&(rp>0) ? sqr(hp)+sqr(rp) : 0;
+      }
+      sqrts(s,m);
+      for (int i=0;i<m;i++)
+        p[i] = s[i] ? s[i] : p[i];
+    }
+  }
+
+  static void lazy_inside(const Cylinder& cylinder, RawArray<const TV> X, RawArray<bool> inside) {
+    const int n = X.size();
+    const T* __restrict__ x = scalar_view(X).data();
+    bool* __restrict__ in = inside.data();
+    const TV x0 = cylinder.base.x0,
+             N = cylinder.base.n;
+    const T sqr_radius = sqr(cylinder.radius),
+            height = cylinder.height;
+    for (int i=0;i<n;i++) {
+      const T vx = x[3*i]-x0.x, vy = x[3*i+1]-x0.y, vz = x[3*i+2]-x0.z,
+              h = vx*N.x+vy*N.y+vz*N.z;
+      in[i] = (h>=0) & (h<=height) & (sqr(vx-h*N.x)+sqr(vy-h*N.y)+sqr(vz-h*N.z)<=sqr_radius);
+    }
+  }
+};
+
 template<class Shape> AnalyticImplicit<Shape>::
 ~AnalyticImplicit() {}
 
@@ -61,6 +314,34 @@ repr() const
     return Shape::repr();
 }
 
+template<class Shape> void AnalyticImplicit<Shape>::
+phi(RawArray<const TV> X, RawArray<T> phi) const
+{
+    GEODE_ASSERT(X.size()==phi.size());
+    Batch<Shape>::phi(*this,X,phi);
+}
+
+template<class Shape> void AnalyticImplicit<Shape>::
+normal(RawArray<const TV> X, RawArray<TV> normal) const
+{
+    GEODE_ASSERT(X.size()==normal.size());
+    Batch<Shape>::normal(*this,X,normal);
+}
+
+template<class Shape> void AnalyticImplicit<Shape>::
+surface(RawArray<const TV> X, RawArray<TV> surface) const
+{
+    GEODE_ASSERT(X.size()==surface.size());
+    Batch<Shape>::surface(*this,X,surface);
+}
+
+template<class Shape> void AnalyticImplicit<Shape>::
+lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const
+{
+    GEODE_ASSERT(X.size()==inside.size());
+    Batch<Shape>::lazy_inside(*this,X,inside);
+}
+
 template AnalyticImplicit<Box<Vector<T,1>>>::~AnalyticImplicit();
 template AnalyticImplicit<Box<Vector<T,2>>>::~AnalyticImplicit();
 template AnalyticImplicit<Box<Vector<T,3>>>::~AnalyticImplicit();
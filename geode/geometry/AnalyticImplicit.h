@@ -43,5 +43,11 @@ public:
   virtual bool lazy_inside(const TV& X) const;
   virtual Box<TV> bounding_box() const;
   virtual string repr() const;
+
+  // Batch evaluation with the shape methods inlined, using vectorized kernels for common shapes
+  virtual void phi(RawArray<const TV> X, RawArray<T> phi) const;
+  virtual void normal(RawArray<const TV> X, RawArray<TV> normal) const;
+  virtual void surface(RawArray<const TV> X, RawArray<TV> surface) const;
+  virtual void lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const;
 };
 }
@@ -10,6 +10,7 @@
 #include <geode/geometry/traverse.h>
 #include <geode/math/integer_log.h>
 #include <geode/python/Class.h>
+#include <geode/utility/openmp.h>
 namespace geode {
 using std::cout;
 using std::endl;
@@ -52,27 +53,161 @@ Array<const Range<int>> ranges(int prims, int leaf_size) {
   return ranges;
 }
 
-template<class Geo,class TV> void
-build(BoxTree<TV>& self, RawArray<const Range<int>> ranges, RawArray<const Geo> geo, int node) {
-  // Compute box
-  const auto r = ranges[node];
-  Box<TV>& box = self.boxes[node];
-  box = Box<TV>(geo[self.p[r.lo]]);
-  for (int i=r.lo+1;i<r.hi;i++)
-    box.enlarge_nonempty(geo[self.p[i]]);
+// Split nodes at the median along their longest axis, using the precomputed ranges
+template<class TV,class Geo> struct MedianBuilder {
+  BoxTree<TV>& self;
+  RawArray<const Geo> geo;
 
-  // Recursively split along largest axis if necessary
-  if (self.is_leaf(node))
-    sort(self.p.slice(r.lo,r.hi).const_cast_());
-  else {
+  // Compute the node's box and partition its primitives between its children
+  bool split(const int node) const {
+    const auto r = self.ranges[node];
+    Box<TV>& box = self.boxes[node];
+    box = Box<TV>(geo[self.p[r.lo]]);
+    for (int i=r.lo+1;i<r.hi;i++)
+      box.enlarge_nonempty(geo[self.p[i]]);
+    if (self.is_leaf(node)) {
+      sort(self.p.slice(r.lo,r.hi).const_cast_());
+      return false;
+    }
     const int axis = box.sizes().argmax();
     int* pp = const_cast<int*>(self.p.data());
     std::nth_element(pp+r.lo,
-                     pp+ranges[2*node+1].hi,
+                     pp+self.ranges[2*node+1].hi,
                      pp+r.hi,indirect_comparison(geo,CenterCompare(axis)));
-    build(self,ranges,geo,2*node+1);
-    build(self,ranges,geo,2*node+2);
+    return true;
   }
+};
+
+// Half the surface area of a box, or half the perimeter in 2D
+template<class TV> static inline typename TV::Scalar half_area(const Box<TV>& box) {
+  if (box.empty())
+    return 0;
+  const auto sizes = box.sizes();
+  typename TV::Scalar area = 0;
+  for (int i=0;i<TV::m;i++)
+    area += sizes.remove_index(i).product();
+  return area;
+}
+
+// Split nodes using a binned surface area heuristic.  Each subtree can hold at most leaf_size primitives per leaf,
+// which limits the split positions at each node.  The node's box and range are computed by its parent.
+template<class TV,class Geo> struct SahBuilder {
+  typedef typename TV::Scalar T;
+  static const int bins = 16;
+  BoxTree<TV>& self;
+  RawArray<const Geo> geo;
+  RawArray<const int> leaves; // Number of leaves below each node
+
+  SahBuilder(BoxTree<TV>& self, RawArray<const Geo> geo, RawArray<const int> leaves)
+    : self(self), geo(geo), leaves(leaves) {}
+
+  bool split(const int node) const {
+    const auto r = self.ranges[node];
+    const auto p = self.p.slice(r.lo,r.hi).const_cast_();
+    if (self.is_leaf(node)) {
+      sort(p);
+      return false;
+    }
+    const int n = r.size(),
+              lo = max(0,n-self.leaf_size*leaves[2*node+2]),
+              hi = min(n,self.leaf_size*leaves[2*node+1]);
+
+    // Bin centers along each axis, and choose the cheapest feasible split
+    Box<TV> centers;
+    for (const int i : p)
+      centers.enlarge(Box<TV>(geo[i]).center());
+    const auto scale = T(bins)/centers.sizes();
+    const auto bin = [&](const int axis, const int i) {
+      return clamp(int(scale[axis]*(Box<TV>(geo[i]).center()[axis]-centers.min[axis])),0,bins-1);
+    };
+    T best = inf;
+    int best_axis = -1, best_bin = -1;
+    Vector<Box<TV>,2> best_boxes;
+    for (int axis=0;axis<TV::m;axis++) {
+      if (!(centers.max[axis]>centers.min[axis]))
+        continue;
+      Vector<int,bins> counts;
+      Vector<Box<TV>,bins> boxes;
+      for (const int i : p) {
+        const int b = bin(axis,i);
+        counts[b]++;
+        boxes[b].enlarge(Box<TV>(geo[i]));
+      }
+      Vector<Box<TV>,bins> above; // above[b] bounds bins b+1 and up
+      for (int b=bins-2;b>=0;b--)
+        above[b] = Box<TV>::combine(above[b+1],boxes[b+1]);
+      Box<TV> below;
+      int k = 0;
+      for (int b=0;b<bins-1;b++) {
+        below.enlarge(boxes[b]);
+        k += counts[b];
+        if (lo<=k && k<=hi) {
+          const T cost = k*half_area(below)+(n-k)*half_area(above[b]);
+          if (best>cost) {
+            best = cost;
+            best_axis = axis;
+            best_bin = b;
+            best_boxes = vec(below,above[b]);
+          }
+        }
+      }
+    }
+
+    // Partition, or fall back to a median style split if no bin boundary is feasible
+    int k;
+    if (best_axis>=0)
+      k = int(std::partition(p.begin(),p.end(),[&](const int i) { return bin(best_axis,i)<=best_bin; })-p.begin());
+    else {
+      k = clamp(int(T(n)*leaves[2*node+1]/leaves[node]+T(.5)),lo,hi);
+      std::nth_element(p.begin(),p.begin()+k,p.end(),
+                       indirect_comparison(geo,CenterCompare(centers.sizes().argmax())));
+      for (const int c : range(2))
+        for (const int i : c ? p.slice(k,n) : p.slice(0,k))
+          best_boxes[c].enlarge(Box<TV>(geo[i]));
+    }
+    auto& ranges = self.ranges.const_cast_();
+    ranges[2*node+1] = range(r.lo,r.lo+k);
+    ranges[2*node+2] = range(r.lo+k,r.hi);
+    self.boxes[2*node+1] = best_boxes[0];
+    self.boxes[2*node+2] = best_boxes[1];
+    return true;
+  }
+};
+
+template<class Builder> static void build_subtree(const Builder& builder, const int node) {
+  if (builder.split(node)) {
+    build_subtree(builder,2*node+1);
+    build_subtree(builder,2*node+2);
+  }
+}
+
+// Split the top of the tree until there are several subtrees per thread, then finish the subtrees in parallel
+template<class Builder> static void build_tree(const Builder& builder, const int threads) {
+  GEODE_ASSERT(threads>=0);
+  const int nt = threads ? threads : omp_get_max_threads();
+  Array<int> subtrees(1);
+  if (nt>1)
+    while (subtrees.size()<8*nt) {
+      Array<int> next;
+      for (const int n : subtrees) {
+        if (builder.split(n))
+          next.extend(vec(2*n+1,2*n+2));
+      }
+      subtrees = next;
+      if (!subtrees.size())
+        return;
+    }
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int i=0;i<subtrees.size();i++)
+    build_subtree(builder,subtrees[i]);
+}
+
+// Number of leaves below each node
+template<class TV> static Array<const int> leaf_counts(const BoxTree<TV>& self) {
+  Array<int> counts(self.nodes(),uninit);
+  for (int n=self.nodes()-1;n>=0;n--)
+    counts[n] = self.is_leaf(n) ? 1 : counts[2*n+1]+counts[2*n+2];
+  return counts;
 }
 
 }
@@ -90,35 +225,52 @@ static int depth(int leaves) {
   return depth;
 }
 
-static inline Range<int> leaf_range(int prims, int leaf_size) {
+// SAH trees have room for twice as many primitives as they hold
+static inline Range<int> leaf_range(int prims, int leaf_size, const bool sah) {
   if (!prims)
     return range(0);
-  int leaves = (prims+leaf_size-1)/leaf_size;
+  int leaves = ((sah?2:1)*prims+leaf_size-1)/leaf_size;
   return range(leaves-1,2*leaves-1);
 }
 
-template<class TV> BoxTree<TV>::BoxTree(RawArray<const TV> geo, const int leaf_size)
+template<class TV> BoxTree<TV>::BoxTree(RawArray<const TV> geo, const int leaf_size, const bool sah,
+                                        const int threads)
   : leaf_size(check_leaf_size(leaf_size))
-  , leaves(leaf_range(geo.size(),leaf_size))
+  , leaves(leaf_range(geo.size(),leaf_size,sah))
   , depth(geode::depth(leaves.size()))
   , p(arange(geo.size()).copy())
-  , ranges(geode::ranges(geo.size(),leaf_size))
+  , ranges(sah ? Array<const Range<int>>(Array<Range<int>>(max(0,leaves.hi))) : geode::ranges(geo.size(),leaf_size))
   , boxes(max(0,leaves.hi),uninit)
 {
-  if (leaves.size())
-    build(*this,ranges,geo,0);
+  build(geo,sah,threads);
 }
 
-template<class TV> BoxTree<TV>::BoxTree(RawArray<const Box<TV>> geo, const int leaf_size)
+template<class TV> BoxTree<TV>::BoxTree(RawArray<const Box<TV>> geo, const int leaf_size, const bool sah,
+                                        const int threads)
   : leaf_size(check_leaf_size(leaf_size))
-  , leaves(leaf_range(geo.size(),leaf_size))
+  , leaves(leaf_range(geo.size(),leaf_size,sah))
   , depth(geode::depth(leaves.size()))
   , p(arange(geo.size()).copy())
-  , ranges(geode::ranges(geo.size(),leaf_size))
+  , ranges(sah ? Array<const Range<int>>(Array<Range<int>>(max(0,leaves.hi))) : geode::ranges(geo.size(),leaf_size))
   , boxes(max(0,leaves.hi),uninit)
 {
-  if (leaves.size())
-    build(*this,ranges,geo,0);
+  build(geo,sah,threads);
+}
+
+template<class TV> template<class Geo> void BoxTree<TV>::build(RawArray<const Geo> geo, const bool sah,
+                                                                const int threads) {
+  if (!leaves.size())
+    return;
+  if (!sah)
+    build_tree(MedianBuilder<TV,Geo>{*this,geo},threads);
+  else {
+    ranges.const_cast_()[0] = range(geo.size());
+    boxes[0] = Box<TV>();
+    for (const auto& g : geo)
+      boxes[0].enlarge(Box<TV>(g));
+    const auto counts = leaf_counts(*this);
+    build_tree(SahBuilder<TV,Geo>(*this,geo,counts),threads);
+  }
 }
 
 template<class TV> BoxTree<TV>::BoxTree(const BoxTree<TV>& other)
@@ -141,11 +293,12 @@ namespace {
 template<class TV> struct CheckVisitor {
   const BoxTree<TV>& tree;
   RawArray<const TV> X;
+  const bool full; // Whether all leaves except the last are full
   int& culls;
   int& leaves;
 
-  CheckVisitor(const BoxTree<TV>& tree, RawArray<const TV> X, int& culls, int& leaves)
-    : tree(tree), X(X), culls(culls), leaves(leaves) {}
+  CheckVisitor(const BoxTree<TV>& tree, RawArray<const TV> X, const bool full, int& culls, int& leaves)
+    : tree(tree), X(X), full(full), culls(culls), leaves(leaves) {}
 
   bool cull(int n) const {
     if (!tree.is_leaf(n))
@@ -155,7 +308,10 @@ template<class TV> struct CheckVisitor {
   }
 
   void leaf(int n) const {
-    GEODE_ASSERT(tree.ranges[n].hi==tree.p.size() || tree.prims(n).size()==tree.leaf_size);
+    if (full)
+      GEODE_ASSERT(tree.ranges[n].hi==tree.p.size() || tree.prims(n).size()==tree.leaf_size);
+    else
+      GEODE_ASSERT(tree.prims(n).size()<=tree.leaf_size);
     for (int i : tree.prims(n))
       GEODE_ASSERT(tree.boxes[n].lazy_inside(X[i]));
     leaves++;
@@ -170,7 +326,8 @@ check(RawArray<const TV> X) const {
   count.subset(p) += 1;
   GEODE_ASSERT(count.contains_only(1));
   int culls = 0, leaves = 0;
-  single_traverse(*this,CheckVisitor<TV>(*this,X,culls,leaves));
+  const bool full = this->leaves.size()==(p.size()+leaf_size-1)/leaf_size;
+  single_traverse(*this,CheckVisitor<TV>(*this,X,full,culls,leaves));
   GEODE_ASSERT(culls==boxes.size() && leaves==this->leaves.size());
 }
 
@@ -186,6 +343,31 @@ any_box_intersection(const Shape& shape) const {
   return any_box_intersection_helper(*this,shape,0);
 }
 
+namespace {
+// Record the leaf pairs visited by a double traversal
+struct PairVisitor {
+  Array<Vector<int,2>> pairs;
+
+  PairVisitor clone() const { return PairVisitor(); }
+  void merge(const PairVisitor& other) { pairs.extend(other.pairs); }
+  bool cull(const int n0, const int n1) const { return false; }
+  void leaf(const int n0, const int n1) { pairs.append(vec(n0,n1)); }
+};
+}
+template<> struct traverse_mergeable<PairVisitor> : public mpl::true_ {};
+
+// Check that parallel_double_traverse visits the same leaf pairs as double_traverse, and return the number of pairs
+template<class TV> static int parallel_double_traverse_test(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1,
+                                                             const int threads, const typename TV::Scalar thickness) {
+  PairVisitor serial, parallel;
+  double_traverse(tree0,tree1,serial,thickness);
+  parallel_double_traverse(tree0,tree1,parallel,threads,thickness);
+  sort(serial.pairs,LexicographicCompare());
+  sort(parallel.pairs,LexicographicCompare());
+  GEODE_ASSERT(serial.pairs==parallel.pairs);
+  return serial.pairs.size();
+}
+
 #define INSTANTIATE(T,d) \
   template class BoxTree<Vector<T,d>>; \
   template GEODE_CORE_EXPORT bool BoxTree<Vector<T,d>>::any_box_intersection(const Box<Vector<T,d>>&) const; \
@@ -196,10 +378,11 @@ INSTANTIATE(real,3)
 using namespace geode;
 
 void wrap_box_tree() {
+  GEODE_FUNCTION_2(parallel_double_traverse_test,parallel_double_traverse_test<Vector<real,3>>)
   {typedef Vector<real,2> TV;
   typedef BoxTree<TV> Self;
   Class<Self>("BoxTree2d")
-    .GEODE_INIT(RawArray<const TV>,int)
+    .GEODE_INIT(RawArray<const TV>,int,bool,int)
     .GEODE_FIELD(p)
     .GEODE_METHOD(check)
     ;}
@@ -207,7 +390,7 @@ void wrap_box_tree() {
   {typedef Vector<real,3> TV;
   typedef BoxTree<TV> Self;
   Class<Self>("BoxTree3d")
-    .GEODE_INIT(RawArray<const TV>,int)
+    .GEODE_INIT(RawArray<const TV>,int,bool,int)
     .GEODE_FIELD(p)
     .GEODE_METHOD(check)
     ;}
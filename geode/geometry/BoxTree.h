@@ -8,6 +8,13 @@
 // We store the topology of the tree as a complete binary tree packed into
 // an array, so node n has parent (n-1)/2 and children 2n+1 and 2n+2.
 //
+// By default, nodes are split at the median along their longest axis, so every
+// leaf except the last holds exactly leaf_size primitives.  Alternatively, nodes
+// can be split using a binned surface area heuristic (SAH).  SAH trees have about
+// twice as many leaves, each holding at most leaf_size primitives (possibly none),
+// which gives the heuristic room to choose uneven splits while keeping the same
+// complete tree layout.  Either way, subtrees are built in parallel if requested.
+//
 // For templatized visitor-based traversal, include traversal.h.
 //
 //#####################################################################
@@ -35,9 +42,12 @@ public:
   const Array<Box<TV>> boxes;
 
 protected:
-  GEODE_CORE_EXPORT BoxTree(RawArray<const TV> geo, const int leaf_size);
-  GEODE_CORE_EXPORT BoxTree(RawArray<const Box<TV>> geo, const int leaf_size);
+  GEODE_CORE_EXPORT BoxTree(RawArray<const TV> geo, const int leaf_size, const bool sah=false, const int threads=1);
+  GEODE_CORE_EXPORT BoxTree(RawArray<const Box<TV>> geo, const int leaf_size, const bool sah=false,
+                            const int threads=1);
   GEODE_CORE_EXPORT BoxTree(const BoxTree<TV>& other); // Shares ownership with everything except boxes
+private:
+  template<class Geo> void build(RawArray<const Geo> geo, const bool sah, const int threads);
 public:
   ~BoxTree();
 
@@ -3,9 +3,119 @@
 
 #include <geode/geometry/Box.h>
 #include <geode/geometry/Ray.h>
+#include <geode/geometry/WideBoxTree.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 namespace geode {
 namespace {
 
+// Ray parameter ranges for the four children of a wide node.  Along each axis, the near side of each box is the max
+// side if the corresponding bit of signs is set, and boxes are enlarged by e.
+template<int signs,class T,int d> static inline void
+wide_ranges(const Vector<Vector<T,4>,d>& min, const Vector<Vector<T,4>,d>& max, const Vector<T,d>& start,
+            const Vector<T,d>& inv_dx, const T e, Vector<T,4>& lo, Vector<T,4>& hi) {
+  for (int a=0;a<d;a++) {
+    const bool s = (signs&1<<a)!=0;
+    const auto& near = s ? max[a] : min[a];
+    const auto& far = s ? min[a] : max[a];
+    const T en = s ? e : -e;
+    for (int i=0;i<4;i++) {
+      const T l = inv_dx[a]*((near[i]+en)-start[a]),
+              h = inv_dx[a]*((far[i]-en)-start[a]);
+      lo[i] = a ? geode::max(lo[i],l) : l;
+      hi[i] = a ? geode::min(hi[i],h) : h;
+    }
+  }
+}
+
+#ifdef __AVX__
+template<int signs,int d> static inline void
+wide_ranges(const Vector<Vector<double,4>,d>& min, const Vector<Vector<double,4>,d>& max,
+            const Vector<double,d>& start, const Vector<double,d>& inv_dx, const double e,
+            Vector<double,4>& lo, Vector<double,4>& hi) {
+  __m256d l, h;
+  for (int a=0;a<d;a++) {
+    const bool s = (signs&1<<a)!=0;
+    const __m256d near = _mm256_loadu_pd(&(s ? max[a] : min[a])[0]),
+                  far = _mm256_loadu_pd(&(s ? min[a] : max[a])[0]),
+                  en = _mm256_set1_pd(s ? e : -e),
+                  x = _mm256_set1_pd(start[a]),
+                  inv = _mm256_set1_pd(inv_dx[a]),
+                  la = _mm256_mul_pd(inv,_mm256_sub_pd(_mm256_add_pd(near,en),x)),
+                  ha = _mm256_mul_pd(inv,_mm256_sub_pd(_mm256_sub_pd(far,en),x));
+    l = a ? _mm256_max_pd(l,la) : la;
+    h = a ? _mm256_min_pd(h,ha) : ha;
+  }
+  _mm256_storeu_pd(&lo[0],l);
+  _mm256_storeu_pd(&hi[0],h);
+}
+#endif
+
+// Intersect one box, enlarged by e, with a packet of n rays which share signs.  Starts and inverse directions are
+// stored one vector per axis.  Returns a bit mask of the rays which hit the box before their t_max, sets lo to their
+// entry parameters, and sets first to the smallest entry parameter of any hit.
+template<int signs,class T,int d,int n> static inline int
+packet_intersects(const Vector<T,d>& min, const Vector<T,d>& max, const Vector<Vector<T,n>,d>& start,
+                  const Vector<Vector<T,n>,d>& inv_dx, const T e, const Vector<T,n>& t_max, Vector<T,n>& lo,
+                  T& first) {
+  Vector<T,n> hi;
+  for (int a=0;a<d;a++) {
+    const bool s = (signs&1<<a)!=0;
+    const T near = s ? max[a]+e : min[a]-e,
+            far = s ? min[a]-e : max[a]+e;
+    for (int k=0;k<n;k++) {
+      const T l = inv_dx[a][k]*(near-start[a][k]),
+              h = inv_dx[a][k]*(far-start[a][k]);
+      lo[k] = a ? geode::max(lo[k],l) : l;
+      hi[k] = a ? geode::min(hi[k],h) : h;
+    }
+  }
+  int hits = 0;
+  first = numeric_limits<T>::infinity();
+  for (int k=0;k<n;k++) {
+    const bool hit = (lo[k]<=hi[k]) & (hi[k]>=0) & (lo[k]<=t_max[k]);
+    hits |= hit<<k;
+    first = geode::min(first,hit ? lo[k] : numeric_limits<T>::infinity());
+  }
+  return hits;
+}
+
+#ifdef __AVX__
+template<int signs,int d> static inline int
+packet_intersects(const Vector<double,d>& min, const Vector<double,d>& max, const Vector<Vector<double,8>,d>& start,
+                  const Vector<Vector<double,8>,d>& inv_dx, const double e, const Vector<double,8>& t_max,
+                  Vector<double,8>& lo, double& first) {
+  const __m256d inf = _mm256_set1_pd(numeric_limits<double>::infinity());
+  __m256d lo_hit = inf;
+  int hits = 0;
+  for (int j=0;j<8;j+=4) {
+    __m256d l, h;
+    for (int a=0;a<d;a++) {
+      const bool s = (signs&1<<a)!=0;
+      const __m256d near = _mm256_set1_pd(s ? max[a]+e : min[a]-e),
+                    far = _mm256_set1_pd(s ? min[a]-e : max[a]+e),
+                    x = _mm256_loadu_pd(&start[a][j]),
+                    inv = _mm256_loadu_pd(&inv_dx[a][j]),
+                    la = _mm256_mul_pd(inv,_mm256_sub_pd(near,x)),
+                    ha = _mm256_mul_pd(inv,_mm256_sub_pd(far,x));
+      l = a ? _mm256_max_pd(l,la) : la;
+      h = a ? _mm256_min_pd(h,ha) : ha;
+    }
+    const __m256d hit = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(l,h,_CMP_LE_OQ),
+                                                    _mm256_cmp_pd(h,_mm256_setzero_pd(),_CMP_GE_OQ)),
+                                      _mm256_cmp_pd(l,_mm256_loadu_pd(&t_max[j]),_CMP_LE_OQ));
+    hits |= _mm256_movemask_pd(hit)<<j;
+    lo_hit = _mm256_min_pd(lo_hit,_mm256_blendv_pd(inf,l,hit));
+    _mm256_storeu_pd(&lo[j],l);
+  }
+  // Reduce to the smallest lane
+  const __m128d half = _mm_min_pd(_mm256_castpd256_pd128(lo_hit),_mm256_extractf128_pd(lo_hit,1));
+  first = _mm_cvtsd_f64(_mm_min_sd(half,_mm_unpackhi_pd(half,half)));
+  return hits;
+}
+#endif
+
 // We use the ray-box intersection algorithm from
 //   Williams, Barrus, Morley, and Shirley, "An efficient and robust ray-box intersection algorithm", http://www.cs.utah.edu/~rmorley/pubs/box.pdf.
 // For speed, we templatize the code over the octant of the ray.
@@ -47,6 +157,12 @@ template<class TV,int signs> struct FastRay {
     return Box<T>(lo,hi);
   }
 
+  // Ranges for all children of a wide node at once
+  void ranges(const typename WideBoxTree<TV>::Node& node, const T box_enlargement,
+              Vector<T,4>& lo, Vector<T,4>& hi) const {
+    wide_ranges<signs>(node.min,node.max,start,inv_dx,box_enlargement,lo,hi);
+  }
+
   bool intersects(const Box<TV>& box, const T box_enlargement) const {
     const auto ts = range(box,box_enlargement);
     return ts.min<=ts.max && 0<=ts.max && ts.min<=t_max;
@@ -35,6 +35,56 @@ template<class TV> bool FrameImplicit<TV>::lazy_inside(const TV& X) const {
   return object->lazy_inside(frame.inverse_times(X));
 }
 
+// Apply f(lo,Y) to chunks of points starting at lo, transformed into the object frame as Y.  The rotation is
+// converted to a matrix once, and chunks keep the transformed points in cache.
+template<class TV,class F> static void in_local_chunks(const Frame<TV>& frame, RawArray<const TV> X, const F& f) {
+  const int chunk = 1024;
+  const auto A = frame.r.inverse().matrix();
+  Array<TV> Y(min(chunk,X.size()),uninit);
+  for (int lo=0;lo<X.size();lo+=chunk) {
+    const int m = min(chunk,X.size()-lo);
+    for (int i=0;i<m;i++)
+      Y[i] = A*(X[lo+i]-frame.t);
+    f(lo,Y.slice(0,m));
+  }
+}
+
+template<class TV> void FrameImplicit<TV>::phi(RawArray<const TV> X, RawArray<T> phi) const {
+  GEODE_ASSERT(X.size()==phi.size());
+  in_local_chunks(frame,X,[&](const int lo, RawArray<const TV> Y) {
+    object->phi(Y,phi.slice(lo,lo+Y.size()));
+  });
+}
+
+template<class TV> void FrameImplicit<TV>::normal(RawArray<const TV> X, RawArray<TV> normal) const {
+  GEODE_ASSERT(X.size()==normal.size());
+  const auto A = frame.r.matrix();
+  in_local_chunks(frame,X,[&](const int lo, RawArray<const TV> Y) {
+    const auto N = normal.slice(lo,lo+Y.size());
+    object->normal(Y,N);
+    for (auto& n : N)
+      n = A*n;
+  });
+}
+
+template<class TV> void FrameImplicit<TV>::surface(RawArray<const TV> X, RawArray<TV> surface) const {
+  GEODE_ASSERT(X.size()==surface.size());
+  const auto A = frame.r.matrix();
+  in_local_chunks(frame,X,[&](const int lo, RawArray<const TV> Y) {
+    const auto S = surface.slice(lo,lo+Y.size());
+    object->surface(Y,S);
+    for (auto& s : S)
+      s = A*s+frame.t;
+  });
+}
+
+template<class TV> void FrameImplicit<TV>::lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const {
+  GEODE_ASSERT(X.size()==inside.size());
+  in_local_chunks(frame,X,[&](const int lo, RawArray<const TV> Y) {
+    object->lazy_inside(Y,inside.slice(lo,lo+Y.size()));
+  });
+}
+
 template<class TV> Box<TV> FrameImplicit<TV>::bounding_box() const {
   Array<TV,Base::d> corners;
   object->bounding_box().corners(corners);
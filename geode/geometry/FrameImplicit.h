@@ -27,5 +27,11 @@ public:
   virtual bool lazy_inside(const TV& X) const;
   virtual Box<TV> bounding_box() const;
   virtual string repr() const;
+
+  // Batch evaluation transforms chunks of points into the object frame, then calls the object's batch versions
+  virtual void phi(RawArray<const TV> X, RawArray<T> phi) const;
+  virtual void normal(RawArray<const TV> X, RawArray<TV> normal) const;
+  virtual void surface(RawArray<const TV> X, RawArray<TV> surface) const;
+  virtual void lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const;
 };
 }
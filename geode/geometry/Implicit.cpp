@@ -3,6 +3,7 @@
 //#####################################################################
 #include <geode/geometry/Implicit.h>
 #include <geode/python/Class.h>
+#include <geode/utility/range.h>
 namespace geode {
 
 typedef real T;
@@ -20,6 +21,70 @@ template<class TV> Implicit<TV>::
 ~Implicit()
 {}
 
+template<class TV> void Implicit<TV>::
+phi(RawArray<const TV> X, RawArray<T> phi) const
+{
+  GEODE_ASSERT(X.size()==phi.size());
+  for (const int i : range(X.size()))
+    phi[i] = this->phi(X[i]);
+}
+
+template<class TV> void Implicit<TV>::
+normal(RawArray<const TV> X, RawArray<TV> normal) const
+{
+  GEODE_ASSERT(X.size()==normal.size());
+  for (const int i : range(X.size()))
+    normal[i] = this->normal(X[i]);
+}
+
+template<class TV> void Implicit<TV>::
+surface(RawArray<const TV> X, RawArray<TV> surface) const
+{
+  GEODE_ASSERT(X.size()==surface.size());
+  for (const int i : range(X.size()))
+    surface[i] = this->surface(X[i]);
+}
+
+template<class TV> void Implicit<TV>::
+lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const
+{
+  GEODE_ASSERT(X.size()==inside.size());
+  for (const int i : range(X.size()))
+    inside[i] = this->lazy_inside(X[i]);
+}
+
+template<class TV> Array<typename TV::Scalar> Implicit<TV>::
+phis(RawArray<const TV> X) const
+{
+  Array<T> phi(X.size(),uninit);
+  this->phi(X,phi);
+  return phi;
+}
+
+template<class TV> Array<TV> Implicit<TV>::
+normals(RawArray<const TV> X) const
+{
+  Array<TV> normal(X.size(),uninit);
+  this->normal(X,normal);
+  return normal;
+}
+
+template<class TV> Array<TV> Implicit<TV>::
+surfaces(RawArray<const TV> X) const
+{
+  Array<TV> surface(X.size(),uninit);
+  this->surface(X,surface);
+  return surface;
+}
+
+template<class TV> Array<bool> Implicit<TV>::
+lazy_insides(RawArray<const TV> X) const
+{
+  Array<bool> inside(X.size(),uninit);
+  lazy_inside(X,inside);
+  return inside;
+}
+
 template class Implicit<Vector<T,1> >;
 template class Implicit<Vector<T,2> >;
 template class Implicit<Vector<T,3> >;
@@ -33,10 +98,14 @@ template<int d> static void wrap_helper() {
 
   Class<Self>("Implicit")
     .GEODE_FIELD(d)
-    .GEODE_METHOD(phi)
-    .GEODE_METHOD(normal)
-    .GEODE_METHOD(lazy_inside)
-    .GEODE_METHOD(surface)
+    .GEODE_OVERLOADED_METHOD(T(Self::*)(const TV&)const,phi)
+    .GEODE_OVERLOADED_METHOD(TV(Self::*)(const TV&)const,normal)
+    .GEODE_OVERLOADED_METHOD(bool(Self::*)(const TV&)const,lazy_inside)
+    .GEODE_OVERLOADED_METHOD(TV(Self::*)(const TV&)const,surface)
+    .GEODE_METHOD(phis)
+    .GEODE_METHOD(normals)
+    .GEODE_METHOD(lazy_insides)
+    .GEODE_METHOD(surfaces)
     .GEODE_METHOD(bounding_box)
     .GEODE_REPR()
     ;
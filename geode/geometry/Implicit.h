@@ -3,6 +3,7 @@
 //#####################################################################
 #pragma once
 
+#include <geode/array/Array.h>
 #include <geode/geometry/Box.h>
 #include <geode/python/Object.h>
 #include <geode/vector/Vector.h>
@@ -25,5 +26,19 @@ public:
   virtual bool lazy_inside(const TV& X) const=0;
   virtual Box<TV> bounding_box() const=0;
   virtual string repr() const=0;
+
+  // Batch evaluation into preallocated outputs.  The defaults loop over the single point versions, and derived
+  // classes override them with faster kernels where possible.  Derived classes overriding only the single point
+  // versions need using declarations to keep these visible.
+  virtual void phi(RawArray<const TV> X, RawArray<T> phi) const;
+  virtual void normal(RawArray<const TV> X, RawArray<TV> normal) const;
+  virtual void surface(RawArray<const TV> X, RawArray<TV> surface) const;
+  virtual void lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const;
+
+  // Allocating versions of the batch evaluations
+  Array<T> phis(RawArray<const TV> X) const;
+  Array<TV> normals(RawArray<const TV> X) const;
+  Array<TV> surfaces(RawArray<const TV> X) const;
+  Array<bool> lazy_insides(RawArray<const TV> X) const;
 };
 }
@@ -4,9 +4,14 @@
 #include <geode/geometry/ParticleTree.h>
 #include <geode/geometry/Sphere.h>
 #include <geode/geometry/traverse.h>
+#include <geode/array/convert.h>
 #include <geode/array/IndirectArray.h>
 #include <geode/python/Class.h>
+#include <geode/python/function.h>
 #include <geode/structure/UnionFind.h>
+#include <geode/utility/openmp.h>
+#include <algorithm>
+#include <vector>
 namespace geode {
 using std::cout;
 using std::endl;
@@ -135,12 +140,181 @@ template<class TV> Tuple<TV,int> ParticleTree<TV>::closest_point_py(TV point, T
   return tuple(p,index);
 }
 
+// Order points along a Morton curve, so that consecutive queries visit the same parts of the tree
+template<class TV> static Array<int> morton_order(RawArray<const TV> X) {
+  const int d = TV::m,
+            bits = 64/d;
+  Box<TV> box;
+  for (const auto& x : X)
+    box.enlarge(x);
+  const T cells = T((uint64_t(1)<<bits)-1);
+  const TV scale = cells/TV::componentwise_max(box.sizes(),TV::repeat(1e-300));
+  std::vector<std::pair<uint64_t,int>> codes(X.size());
+  for (const int i : range(X.size())) {
+    Vector<uint64_t,d> q;
+    for (int a=0;a<d;a++)
+      q[a] = uint64_t(clamp(scale[a]*(X[i][a]-box.min[a]),T(0),cells));
+    uint64_t code = 0;
+    for (int b=bits-1;b>=0;b--)
+      for (int a=0;a<d;a++)
+        code = code<<1|(q[a]>>b&1);
+    codes[i] = std::make_pair(code,i);
+  }
+  std::sort(codes.begin(),codes.end());
+  Array<int> order(X.size(),uninit);
+  for (const int i : range(X.size()))
+    order[i] = codes[i].second;
+  return order;
+}
+
+// Neighbors of one query as (squared distance, particle) pairs
+typedef std::vector<std::pair<T,int>> Neighbors;
+
+// Search for the k closest particles within sqr_max, visiting nearer children first and keeping a bounded max heap
+// of candidates.  Nodes farther than the worst candidate are skipped, but nodes at exactly the worst distance are
+// kept since they may hold ties with smaller indices.
+template<class TV> static void knn_helper(const ParticleTree<TV>& self, const TV x, const int k, const T sqr_max,
+                                          Neighbors& stack, Neighbors& best) {
+  stack.clear();
+  best.clear();
+  T worst = sqr_max;
+  stack.push_back(std::make_pair(self.boxes[0].sqr_distance_bound(x),0));
+  while (stack.size()) {
+    const auto node = stack.back();
+    stack.pop_back();
+    if (node.first>worst)
+      continue;
+    const int n = node.second;
+    if (!self.is_leaf(n)) {
+      const Vector<T,2> bounds(self.boxes[2*n+1].sqr_distance_bound(x),
+                               self.boxes[2*n+2].sqr_distance_bound(x));
+      const int c = bounds[1]<bounds[0];
+      if (bounds[1-c]<=worst)
+        stack.push_back(std::make_pair(bounds[1-c],2*n+2-c));
+      if (bounds[c]<=worst)
+        stack.push_back(std::make_pair(bounds[c],2*n+1+c));
+    } else
+      for (const int i : self.prims(n)) {
+        const auto p = std::make_pair(sqr_magnitude(x-self.X[i]),i);
+        if (p.first>worst)
+          continue;
+        if (int(best.size())<k) {
+          best.push_back(p);
+          std::push_heap(best.begin(),best.end());
+        } else if (p<best[0]) {
+          std::pop_heap(best.begin(),best.end());
+          best.back() = p;
+          std::push_heap(best.begin(),best.end());
+        } else
+          continue;
+        if (int(best.size())==k)
+          worst = best[0].first;
+      }
+  }
+  std::sort_heap(best.begin(),best.end());
+}
+
+namespace {
+// Collects all particles within a given distance of x
+template<class TV> struct RadiusVisitor {
+  const ParticleTree<TV>& tree;
+  const TV x;
+  const T sqr_radius;
+  Neighbors& found;
+
+  bool cull(const int n) const {
+    return tree.boxes[n].sqr_distance_bound(x)>sqr_radius;
+  }
+
+  void leaf(const int n) {
+    for (const int i : tree.prims(n)) {
+      const T sqr_d = sqr_magnitude(x-tree.X[i]);
+      if (sqr_d<=sqr_radius)
+        found.push_back(std::make_pair(sqr_d,i));
+    }
+  }
+};
+}
+
+// Run query(x,stack,found) for each query point in Morton order, and gather the results.  Contiguous runs of the order
+// are distributed over threads, and each run collects its neighbors before they are copied into place.
+template<class TV,class Query> static Tuple<Nested<int>,Nested<T>>
+neighbor_queries(RawArray<const TV> queries, const int threads, const Query& query) {
+  GEODE_ASSERT(threads>=0);
+  const int n = queries.size(),
+            nt = threads ? threads : omp_get_max_threads(),
+            runs = min(n,8*nt);
+  const auto order = morton_order(queries);
+  const Array<int> counts(n,uninit);
+  std::vector<Neighbors> run_found(runs);
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int r=0;r<runs;r++) {
+    Neighbors stack, found;
+    for (const int j : partition_loop(n,runs,r)) {
+      const int q = order[j];
+      const int start = run_found[r].size();
+      query(queries[q],stack,found);
+      run_found[r].insert(run_found[r].end(),found.begin(),found.end());
+      counts[q] = run_found[r].size()-start;
+    }
+  }
+  Tuple<Nested<int>,Nested<T>> result(Nested<int>(counts,uninit),Nested<T>(counts,uninit));
+  auto& indices = result.x;
+  auto& distances = result.y;
+  #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+  for (int r=0;r<runs;r++) {
+    int k = 0;
+    for (const int j : partition_loop(n,runs,r)) {
+      const int q = order[j];
+      const int lo = indices.offsets[q];
+      for (const int i : range(counts[q])) {
+        const auto& p = run_found[r][k++];
+        indices.flat[lo+i] = p.second;
+        distances.flat[lo+i] = sqrt(p.first);
+      }
+    }
+  }
+  return result;
+}
+
+template<class TV> Tuple<Nested<int>,Nested<typename TV::Scalar>> ParticleTree<TV>::
+knn(RawArray<const TV> queries, const int k, const T max_distance, const int threads) const {
+  GEODE_ASSERT(k>=0 && max_distance>=0);
+  const T sqr_max = sqr(max_distance);
+  return neighbor_queries(queries,threads,[=](const TV x, Neighbors& stack, Neighbors& found) {
+    found.clear();
+    if (k && nodes())
+      knn_helper(*this,x,k,sqr_max,stack,found);
+  });
+}
+
+template<class TV> Tuple<Nested<int>,Nested<typename TV::Scalar>> ParticleTree<TV>::
+radius_neighbors(RawArray<const TV> queries, const T radius, const int threads) const {
+  GEODE_ASSERT(radius>=0);
+  const T sqr_radius = sqr(radius);
+  return neighbor_queries(queries,threads,[=](const TV x, Neighbors& stack, Neighbors& found) {
+    found.clear();
+    single_traverse(*this,RadiusVisitor<TV>({*this,x,sqr_radius,found}));
+    std::sort(found.begin(),found.end());
+  });
+}
+
 #define INSTANTIATE(d) \
   template class ParticleTree<Vector<T,d>>; \
   template GEODE_CORE_EXPORT void ParticleTree<Vector<T,d>>::intersection(const Box<Vector<T,d>>&,Array<int>&) const; \
   template GEODE_CORE_EXPORT void ParticleTree<Vector<T,d>>::intersection(const Sphere<Vector<T,d>>&,Array<int>&) const;
 INSTANTIATE(2)
 INSTANTIATE(3)
+
+// Closest particles found one query at a time, as a baseline for knn
+template<int d> static Array<int> closest_point_loop(const ParticleTree<Vector<T,d>>& tree,
+                                                     RawArray<const Vector<T,d>> queries) {
+  Array<int> closest(queries.size(),uninit);
+  for (const int i : range(queries.size()))
+    tree.closest_point(queries[i],closest[i]);
+  return closest;
+}
+
 }
 using namespace geode;
 
@@ -153,10 +327,13 @@ template<int d> static void wrap_helper() {
     .GEODE_METHOD(update)
     .GEODE_METHOD(remove_duplicates)
     .GEODE_METHOD_2("closest_point",closest_point_py)
+    .GEODE_METHOD(knn)
+    .GEODE_METHOD(radius_neighbors)
     ;
 }
 
 void wrap_particle_tree() {
   wrap_helper<2>();
   wrap_helper<3>();
+  GEODE_FUNCTION_2(closest_point_loop,closest_point_loop<3>)
 }
@@ -5,6 +5,8 @@
 
 #include <geode/geometry/forward.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/array/Nested.h>
+#include <geode/structure/Tuple.h>
 #include <geode/math/constants.h>
 
 namespace geode {
@@ -34,6 +36,13 @@ public:
   GEODE_CORE_EXPORT TV closest_point(TV point, int& index, T max_distance=inf, int ignore = -1) const; // simplex=-1 if nothing is found
   GEODE_CORE_EXPORT TV closest_point(TV point, T max_distance=inf) const; // return value is infinity if nothing is found
   GEODE_CORE_EXPORT Tuple<TV,int> closest_point_py(TV point, T max_distance=inf) const;
+
+  // Batched neighbor queries, returning particle indices and distances sorted by increasing distance (ties by index).
+  // Queries are processed in Morton order on up to threads threads (0 for all); the result does not depend on threads.
+  GEODE_CORE_EXPORT Tuple<Nested<int>,Nested<T>> knn(RawArray<const TV> queries, int k, T max_distance=inf,
+                                                     int threads=0) const; // Up to k closest within max_distance
+  GEODE_CORE_EXPORT Tuple<Nested<int>,Nested<T>> radius_neighbors(RawArray<const TV> queries, T radius,
+                                                                  int threads=0) const; // All within radius
 };
 
 }
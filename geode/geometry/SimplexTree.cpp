@@ -9,8 +9,10 @@
 #include <geode/geometry/Triangle2d.h>
 #include <geode/geometry/Triangle3d.h>
 #include <geode/array/IndirectArray.h>
+#include <geode/math/integer_log.h>
 #include <geode/python/Class.h>
 #include <geode/random/Random.h>
+#include <geode/utility/openmp.h>
 
 // Windows silliness
 #undef small
@@ -31,14 +33,15 @@ template<class Mesh,class TV> static Array<Box<TV>> boxes(const Mesh& mesh, Arra
   return boxes;
 }
 
-template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size)
-  : Base(RawArray<const Box<TV>>(geode::boxes(mesh,X)),leaf_size), mesh(ref(mesh)), X(X), simplices(mesh.elements.size(),uninit) {
+template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size, bool sah,
+                                                        int threads)
+  : Base(RawArray<const Box<TV>>(geode::boxes(mesh,X)),leaf_size,sah,threads), mesh(ref(mesh)), X(X), simplices(mesh.elements.size(),uninit), wide_built(false) {
   for (int t=0;t<mesh.elements.size();t++)
     simplices[t] = Simplex(X.subset(mesh.elements[t]));
 }
 
 template<class TV,int d> SimplexTree<TV,d>::SimplexTree(const SimplexTree& other, Array<const TV> X)
-  : Base(other), mesh(other.mesh), X(X), simplices(mesh->elements.size(),uninit) {
+  : Base(other), mesh(other.mesh), X(X), simplices(mesh->elements.size(),uninit), wide_built(false) {
   GEODE_ASSERT(mesh->nodes()<=X.size());
   update();
 }
@@ -56,6 +59,19 @@ template<class TV,int d> void SimplexTree<TV,d>::update() {
     boxes[n] = box;
   }
   update_nonleaf_boxes();
+  if (wide_built)
+    wide_.update(*this);
+}
+
+template<class TV,int d> const WideBoxTree<TV>& SimplexTree<TV,d>::wide() const {
+  if (!wide_built.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(wide_mutex);
+    if (!wide_built.load(std::memory_order_relaxed)) {
+      wide_ = WideBoxTree<TV>(*this);
+      wide_built.store(true,std::memory_order_release);
+    }
+  }
+  return wide_;
 }
 
 namespace {
@@ -90,39 +106,38 @@ template<> void SimplexTree<Vector<real,3>,2>::intersections(const Plane<real>&
   single_traverse(*this,PlaneVisitor<real>(*this,plane,results));
 }
 
-template<int signs,class TV,int d> static void intersection_helper(const SimplexTree<TV,d>& self, Ray<TV>& ray, const typename TV::Scalar half_thickness) {
+// Trace a ray through the subtree below a wide tree child
+template<int signs,class TV,int d> static void intersection_helper(const SimplexTree<TV,d>& self, Ray<TV>& ray, const typename TV::Scalar half_thickness, const int root=0) {
   typedef typename TV::Scalar T;
   FastRay<TV,signs> fast(ray);
-  // If we don't intersect the root box, there's nothing to do
-  const Box<T> root = fast.range(self.boxes[0],half_thickness);
-  if (root.min>root.max || (root.max) < 0 || root.min > fast.t_max)
-    return;
-  const int internal = self.leaves.lo;
-  RawStack<Tuple<int,T>> stack(GEODE_RAW_ALLOCA(self.depth,Tuple<int,T>)); // Each entry is (node,t_min)
-  stack.push(tuple(0,root.min));
+  const auto& wide = self.wide();
+  const auto& nodes = wide.nodes;
+  RawStack<Tuple<int,T>> stack(GEODE_RAW_ALLOCA(3*wide.depth+1,Tuple<int,T>)); // Each entry is (child,t_min)
+  stack.push(tuple(root,T(0)));
   while (stack.size()) {
-    const auto node_tmin = stack.pop();
-    if (node_tmin.y>fast.t_max) // Check t_min again since fast.t_max may have changed
+    const auto child_tmin = stack.pop();
+    if (child_tmin.y>fast.t_max) // Check t_min again since fast.t_max may have changed
       continue;
-    const int node = node_tmin.x;
-    if (node < internal) {
-      // Sort children by t_min
-      int child0 = 2*node+1,
-          child1 = 2*node+2;
-      auto range0 = fast.range(self.boxes[child0],half_thickness),
-           range1 = fast.range(self.boxes[child1],half_thickness);
-      if (range0.min>range1.min) {
-        swap(child0,child1);
-        swap(range0,range1);
-      }
-      // Push child with larger t_min onto the stack first, so that we check smaller t_min first
-      if (range1.min<=range1.max && range1.max>=0 && range1.min<=fast.t_max)
-        stack.push(tuple(child1,range1.min));
-      if (range0.min<=range0.max && range0.max>=0 && range0.min<=fast.t_max)
-        stack.push(tuple(child0,range0.min));
+    const int child = child_tmin.x;
+    if (child >= 0) {
+      // Test all four child boxes at once, and push hits so that smaller t_min is checked first
+      const auto& node = nodes[child];
+      Vector<T,4> lo, hi;
+      fast.ranges(node,half_thickness,lo,hi);
+      Vector<int,4> order;
+      int hits = 0;
+      for (int i=0;i<4;i++)
+        if (lo[i]<=hi[i] && hi[i]>=0 && lo[i]<=fast.t_max) {
+          int j = hits++;
+          for (;j && lo[order[j-1]]<lo[i];j--)
+            order[j] = order[j-1];
+          order[j] = i;
+        }
+      for (int j=0;j<hits;j++)
+        stack.push(tuple(node.children[order[j]],lo[order[j]]));
     } else {
       // Test all simplices in this leaf
-      for (const int t : self.prims(node))
+      for (const int t : self.prims(-1-child))
         if (self.simplices[t].intersection(ray,half_thickness)) {
           fast.t_max = ray.t_max;
           ray.aggregate_id = t;
@@ -170,6 +185,226 @@ template<class TV,int d> bool SimplexTree<TV,d>::intersection(Ray<TV>& ray, cons
   return true;
 }
 
+// Rays traced together by packet intersection
+static const int packet_size = 8;
+
+namespace {
+template<class TV> struct RayPacket {
+  typedef typename TV::Scalar T;
+  typedef Vector<T,packet_size> TP;
+  static const int d = TV::m;
+
+  int size;
+  Vector<int,packet_size> index; // Which ray each lane holds
+  Vector<TP,d> S, D, inv; // Starts, directions, and inverse directions, in structure of arrays form
+  TP t_max;
+
+  RayPacket(RawArray<const Ray<TV>> rays, RawArray<const int> indices)
+    : size(indices.size()) {
+    assert(size<=packet_size);
+    for (int k=0;k<packet_size;k++) {
+      // Unused lanes repeat the first ray, but are never in any mask
+      const auto& ray = rays[indices[k<size ? k : 0]];
+      index[k] = indices[k<size ? k : 0];
+      t_max[k] = ray.t_max;
+      for (int a=0;a<d;a++) {
+        S[a][k] = ray.start[a];
+        D[a][k] = ray.direction[a];
+        inv[a][k] = 1/ray.direction[a];
+      }
+    }
+  }
+};
+}
+
+// Lanes of a packet which might hit a simplex
+template<class TV,class Simplex> static inline int
+candidates(const Simplex& simplex, const RayPacket<TV>& packet, const int mask, const typename TV::Scalar h) {
+  return mask;
+}
+
+// Every hit found by Triangle::intersection lies within 2h of the triangle's plane and behind its three edge planes
+// moved out by 2h, so we clip each lane's ray against these five half spaces.  Edge normals are not normalized, so
+// their offsets use the 1-norm as a cheap upper bound on length.  The half spaces are enlarged by a margin much
+// larger than rounding error, so lanes are never discarded incorrectly, and degenerate triangles produce nans which
+// keep every lane.  The loops over lanes vectorize.
+template<class T> static inline int
+candidates(const Triangle<Vector<T,3>>& tri, const RayPacket<Vector<T,3>>& packet, const int mask, const T h) {
+  typedef Vector<T,3> TV;
+  typedef Vector<T,packet_size> TP;
+  const TV n[5] = {tri.n,-tri.n,cross(tri.x1-tri.x0,tri.n),cross(tri.x2-tri.x1,tri.n),cross(tri.x0-tri.x2,tri.n)};
+  const TV x[5] = {tri.x0,tri.x0,tri.x0,tri.x1,tri.x2};
+  const T size = tri.bounding_box().sizes().max();
+  TP offset, lo, hi = packet.t_max;
+  for (int k=0;k<packet_size;k++)
+    offset[k] = 2*h+T(1e-9)*(size+2*h+abs(packet.S[0][k]-tri.x0.x)+abs(packet.S[1][k]-tri.x0.y)
+                                     +abs(packet.S[2][k]-tri.x0.z));
+  for (int j=0;j<5;j++) {
+    const T norm = abs(n[j].x)+abs(n[j].y)+abs(n[j].z);
+    for (int k=0;k<packet_size;k++) {
+      // The ray is inside where a+b*t <= 0
+      const T a = n[j].x*(packet.S[0][k]-x[j].x)+n[j].y*(packet.S[1][k]-x[j].y)+n[j].z*(packet.S[2][k]-x[j].z)
+                  -norm*offset[k],
+              b = n[j].x*packet.D[0][k]+n[j].y*packet.D[1][k]+n[j].z*packet.D[2][k],
+              t = -a/b;
+      hi[k] = min(hi[k],b>0 ? t : T(inf));
+      lo[k] = max(lo[k],b<0 ? t : b==0 && a>0 ? T(inf) : T(0));
+    }
+  }
+  int result = 0;
+  for (int k=0;k<packet_size;k++)
+    result |= !(lo[k]>hi[k])<<k;
+  return result&mask;
+}
+
+template<int signs,class TV,int d> static void
+packet_intersection_helper(const SimplexTree<TV,d>& self, RawArray<Ray<TV>> rays, RawArray<const int> indices,
+                           const typename TV::Scalar half_thickness) {
+  typedef typename TV::Scalar T;
+  typedef Vector<T,packet_size> TP;
+  RayPacket<TV> packet(rays,indices);
+  const auto& wide = self.wide();
+  const auto& nodes = wide.nodes;
+
+  // Each stack entry is a child, the lanes which hit its box, and their entry parameters
+  struct Entry {
+    int child, mask;
+    TP t_min;
+  };
+  RawStack<Entry> stack(GEODE_RAW_ALLOCA(3*wide.depth+1,Entry));
+  stack.push(Entry{0,(1<<packet.size)-1,TP()});
+  while (stack.size()) {
+    const auto entry = stack.pop();
+    int mask = entry.mask; // Drop lanes which have since found closer hits
+    for (int k=0;k<packet_size;k++)
+      mask &= ~((entry.t_min[k]>packet.t_max[k])<<k);
+    if (!mask)
+      continue;
+    if (!(mask&(mask-1))) {
+      // Once a single lane remains, packet traversal gains nothing
+      const int k = integer_log_exact(uint32_t(mask));
+      auto& ray = rays[packet.index[k]];
+      intersection_helper<signs>(self,ray,half_thickness,entry.child);
+      packet.t_max[k] = ray.t_max;
+    } else if (entry.child >= 0) {
+      // Test each child box against all lanes at once
+      const auto& node = nodes[entry.child];
+      Vector<int,4> masks;
+      Vector<TP,4> t_mins;
+      Vector<T,4> first;
+      TP t_max; // Inactive lanes get -inf, so they never hit anything
+      for (int k=0;k<packet_size;k++)
+        t_max[k] = mask&1<<k ? packet.t_max[k] : -inf;
+      for (int i=0;i<4;i++) {
+        TV box_min, box_max;
+        for (int a=0;a<TV::m;a++) {
+          box_min[a] = node.min[a][i];
+          box_max[a] = node.max[a][i];
+        }
+        masks[i] = packet_intersects<signs>(box_min,box_max,packet.S,packet.inv,half_thickness,t_max,
+                                            t_mins[i],first[i]);
+      }
+      // Push children so that the one any lane reaches first is popped first
+      Vector<int,4> order;
+      int hits = 0;
+      for (int i=0;i<4;i++)
+        if (masks[i]) {
+          int j = hits++;
+          for (;j && first[order[j-1]]<first[i];j--)
+            order[j] = order[j-1];
+          order[j] = i;
+        }
+      for (int j=0;j<hits;j++)
+        stack.push(Entry{node.children[order[j]],masks[order[j]],t_mins[order[j]]});
+    } else {
+      // Test all simplices in this leaf against the lanes which might hit them
+      for (const int t : self.prims(-1-entry.child)) {
+        const auto& simplex = self.simplices[t];
+        const int lanes = candidates(simplex,packet,mask,half_thickness);
+        for (int k=0;k<packet.size;k++)
+          if (lanes&1<<k) {
+            auto& ray = rays[packet.index[k]];
+            if (simplex.intersection(ray,half_thickness)) {
+              packet.t_max[k] = ray.t_max;
+              ray.aggregate_id = t;
+            }
+          }
+      }
+    }
+  }
+}
+
+template<class TV,int d> static void
+packet_intersection_dispatch(const SimplexTree<TV,d>& self, const int signs, RawArray<Ray<TV>> rays,
+                             RawArray<const int> indices, const typename TV::Scalar half_thickness) {
+  GEODE_NOT_IMPLEMENTED();
+}
+
+template<> void packet_intersection_dispatch(const SimplexTree<Vector<real,2>,1>& self, const int signs,
+                                             RawArray<Ray<Vector<real,2>>> rays, RawArray<const int> indices,
+                                             const real half_thickness) {
+  switch (signs) {
+    case 0: packet_intersection_helper<0>(self,rays,indices,half_thickness); break;
+    case 1: packet_intersection_helper<1>(self,rays,indices,half_thickness); break;
+    case 2: packet_intersection_helper<2>(self,rays,indices,half_thickness); break;
+    case 3: packet_intersection_helper<3>(self,rays,indices,half_thickness); break;
+  }
+}
+
+template<> void packet_intersection_dispatch(const SimplexTree<Vector<real,3>,2>& self, const int signs,
+                                             RawArray<Ray<Vector<real,3>>> rays, RawArray<const int> indices,
+                                             const real half_thickness) {
+  switch (signs) {
+    case 0: packet_intersection_helper<0>(self,rays,indices,half_thickness); break;
+    case 1: packet_intersection_helper<1>(self,rays,indices,half_thickness); break;
+    case 2: packet_intersection_helper<2>(self,rays,indices,half_thickness); break;
+    case 3: packet_intersection_helper<3>(self,rays,indices,half_thickness); break;
+    case 4: packet_intersection_helper<4>(self,rays,indices,half_thickness); break;
+    case 5: packet_intersection_helper<5>(self,rays,indices,half_thickness); break;
+    case 6: packet_intersection_helper<6>(self,rays,indices,half_thickness); break;
+    case 7: packet_intersection_helper<7>(self,rays,indices,half_thickness); break;
+  }
+}
+
+template<class TV,int d> Array<bool> SimplexTree<TV,d>::intersection(RawArray<Ray<TV>> rays, const T half_thickness) const {
+  Array<bool> hits(rays.size());
+  if (!boxes.size())
+    return hits;
+
+  // Sort rays by octant with a stable counting sort, so that packets share traversal order
+  const int octants = 1<<TV::m;
+  Array<int> signs(rays.size(),uninit);
+  Array<int> offsets(octants+1);
+  for (int i=0;i<rays.size();i++) {
+    signs[i] = fast_ray_signs(rays[i]);
+    offsets[signs[i]+1]++;
+  }
+  for (int s=0;s<octants;s++)
+    offsets[s+1] += offsets[s];
+  Array<int> order(rays.size(),uninit);
+  {
+    auto next = offsets.copy();
+    for (int i=0;i<rays.size();i++)
+      order[next[signs[i]]++] = i;
+  }
+
+  // Trace each octant in packets
+  const Array<int> aggregate_save(rays.size(),uninit);
+  for (int i=0;i<rays.size();i++) {
+    aggregate_save[i] = rays[i].aggregate_id;
+    rays[i].aggregate_id = -1;
+  }
+  for (int s=0;s<octants;s++)
+    for (int lo=offsets[s];lo<offsets[s+1];lo+=packet_size)
+      packet_intersection_dispatch(*this,s,rays,order.slice(lo,min(lo+packet_size,offsets[s+1])),half_thickness);
+  for (int i=0;i<rays.size();i++) {
+    hits[i] = rays[i].aggregate_id>=0;
+    if (!hits[i])
+      rays[i].aggregate_id = aggregate_save[i];
+  }
+  return hits;
+}
+
 namespace {
 template<class TV,int d> struct SphereVisitor {
   const SimplexTree<TV,d>& self;
@@ -306,6 +541,53 @@ inside(TV point) const {
   throw ArithmeticError("SimplexTree::inside: all rays were singular");
 }
 
+template<class TV,int d> Array<int> SimplexTree<TV,d>::
+inside(RawArray<const TV> points, const int threads) const {
+  GEODE_ASSERT(threads>=0);
+  Array<int> result(points.size());
+  if (!boxes.size())
+    return result;
+  const T small = sqrt(numeric_limits<T>::epsilon());
+  const T epsilon = small*bounding_box().sizes().max();
+  const int nt = threads ? threads : omp_get_max_threads();
+  // As in inside(point), but each round casts one ray per unresolved point, all in the same direction
+  Array<int> pending = arange(points.size()).copy();
+  Array<Ray<TV>> rays;
+  for (const TV& dir : directions<TV>()) {
+    if (!pending.size())
+      break;
+    rays.clear();
+    for (const int i : pending)
+      rays.append(Ray<TV>(points[i],dir,true));
+    const int n = rays.size(),
+              runs = min(n,8*nt);
+    Array<bool> hits(n,uninit);
+    #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+    for (int r=0;r<runs;r++) {
+      const auto chunk = partition_loop(n,runs,r);
+      hits.slice(chunk) = intersection(rays.slice(chunk),epsilon);
+    }
+    int unresolved = 0;
+    for (const int j : range(n)) {
+      const int i = pending[j];
+      if (!hits[j])
+        result[i] = 0; // No intersections, so we must be outside
+      else {
+        const Simplex& simplex = simplices[rays[j].aggregate_id];
+        const auto w = barycentric_coordinates(simplex,rays[j].point(rays[j].t_max));
+        if (Simplex::min_weight(w) > small)
+          result[i] = going_out(simplex,dir);
+        else
+          pending[unresolved++] = i;
+      }
+    }
+    pending.resize(unresolved);
+  }
+  for (const int i : pending)
+    result[i] = -1;
+  return result;
+}
+
 template<class TV,int d> bool SimplexTree<TV,d>::
 inside_given_closest_point(TV point, int simplex, Weights weights) const {
   GEODE_ASSERT(mesh->elements.valid(simplex));
@@ -318,18 +600,24 @@ inside_given_closest_point(TV point, int simplex, Weights weights) const {
   return inside(point);
 }
 
-template<class TV,int d> static void closest_point_helper(const SimplexTree<TV,d>& self, TV point, int& triangle, typename TV::Scalar& sqr_distance, int node) {
+template<class TV,int d> static void closest_point_helper(const SimplexTree<TV,d>& self, const WideBoxTree<TV>& wide, TV point, int& triangle, typename TV::Scalar& sqr_distance, int child) {
   typedef typename TV::Scalar T;
-  if (!self.is_leaf(node)) {
-    Vector<T,2> bounds(self.boxes[2*node+1].sqr_distance_bound(point),
-                       self.boxes[2*node+2].sqr_distance_bound(point));
-    int c = bounds.argmin();
-    if (bounds[c]<sqr_distance)
-      closest_point_helper<TV,d>(self,point,triangle,sqr_distance,2*node+1+c);
-    if (bounds[1-c]<sqr_distance)
-      closest_point_helper<TV,d>(self,point,triangle,sqr_distance,2*node+2-c);
+  if (child >= 0) {
+    // Visit children in order of increasing distance bound
+    const auto& node = wide.nodes[child];
+    const auto bounds = wide.sqr_distance_bounds(node,point);
+    Vector<int,4> order;
+    for (int i=0;i<4;i++) {
+      int j = i;
+      for (;j && bounds[order[j-1]]>bounds[i];j--)
+        order[j] = order[j-1];
+      order[j] = i;
+    }
+    for (const int i : order)
+      if (bounds[i]<sqr_distance)
+        closest_point_helper<TV,d>(self,wide,point,triangle,sqr_distance,node.children[i]);
   } else
-    for (int t : self.prims(node)) {
+    for (int t : self.prims(-1-child)) {
       T sqr_d = sqr_magnitude(point-self.simplices[t].closest_point(point).x);
       if (sqr_distance>sqr_d) {
         sqr_distance = sqr_d;
@@ -342,7 +630,7 @@ template<class TV,int d> Tuple<TV,int,typename SimplexTree<TV,d>::Weights> Simpl
   int simplex = -1;
   if (nodes()) {
     T sqr_distance = sqr(max_distance);
-    closest_point_helper(*this,point,simplex,sqr_distance,0);
+    closest_point_helper(*this,wide(),point,simplex,sqr_distance,0);
   }
   if (simplex == -1) {
     TV x;
@@ -371,10 +659,12 @@ template<class T, int d> static int ray_traversal_test(const SimplexTree<Vector<
   const auto box = tree.bounding_box();
   const auto random = new_<Random>(819371111);
   int hits = 0;
+  Array<Ray<TV>> initial, results;
   for (int i=0;i<rays;i++) {
     const TV start = random->uniform(box);
     Ray<TV> ray(start,random->direction<TV>());
     ray.t_max = 2;
+    initial.append(ray);
     auto copy = ray;
     const bool hit = tree.intersection(ray,half_thickness);
     bool slow_hit = false;
@@ -385,7 +675,148 @@ template<class T, int d> static int ray_traversal_test(const SimplexTree<Vector<
       }
     GEODE_ASSERT(hit==slow_hit);
     hits += hit;
+    results.append(ray);
+  }
+
+  // Packets should find the same hits.  Thick triangle intersections depend slightly on the order simplices are
+  // tested in, so hit locations only agree exactly for zero thickness.  With thickness, the reported simplex must
+  // still be hit by the original ray, no further along than the packet says.
+  auto packet_rays = initial.copy();
+  const auto packet_hits = tree.intersection(packet_rays,half_thickness);
+  for (int i=0;i<rays;i++) {
+    GEODE_ASSERT(packet_hits[i]==(results[i].aggregate_id>=0));
+    if (!half_thickness)
+      GEODE_ASSERT(packet_rays[i].t_max==results[i].t_max && packet_rays[i].aggregate_id==results[i].aggregate_id);
+    else if (packet_hits[i]) {
+      auto ray = initial[i];
+      GEODE_ASSERT(tree.simplices[packet_rays[i].aggregate_id].intersection(ray,half_thickness));
+      GEODE_ASSERT(ray.t_max<=packet_rays[i].t_max);
+    }
+  }
+  return hits;
+}
+
+// Check that batch inside tests agree with single point tests away from the surface, where the ray thickness
+// can't matter.  Returns the number of inside points.
+template<class T,int d> static int inside_test(const SimplexTree<Vector<T,d>,d-1>& tree, const int points,
+                                               const int threads) {
+  typedef Vector<T,d> TV;
+  const auto box = tree.bounding_box();
+  const T margin = 1e-4*box.sizes().max();
+  const auto random = new_<Random>(81371);
+  Array<TV> X;
+  while (X.size()<points) {
+    const TV x = random->uniform(box.thickened(margin));
+    if (tree.distance(x)>margin)
+      X.append(x);
+  }
+  const auto batch = tree.inside(X,threads);
+  int count = 0;
+  for (const int i : range(points)) {
+    GEODE_ASSERT(batch[i]==tree.inside(X[i]));
+    count += batch[i];
+  }
+  return count;
+}
+
+// Closest point search on the binary tree, as done before the wide tree, for testing and benchmarking
+template<class TV,int d> static void binary_closest_point_helper(const SimplexTree<TV,d>& self, const TV point,
+                                                                 int& simplex, typename TV::Scalar& sqr_distance,
+                                                                 const int node) {
+  typedef typename TV::Scalar T;
+  if (!self.is_leaf(node)) {
+    const auto c = self.children(node);
+    const T b0 = self.boxes[c.x].sqr_distance_bound(point),
+            b1 = self.boxes[c.y].sqr_distance_bound(point);
+    const bool swap = b1<b0;
+    if ((swap ? b1 : b0)<sqr_distance)
+      binary_closest_point_helper(self,point,simplex,sqr_distance,swap ? c.y : c.x);
+    if ((swap ? b0 : b1)<sqr_distance)
+      binary_closest_point_helper(self,point,simplex,sqr_distance,swap ? c.x : c.y);
+  } else
+    for (const int t : self.prims(node)) {
+      const T sqr_d = sqr_magnitude(point-self.simplices[t].closest_point(point).x);
+      if (sqr_distance>sqr_d) {
+        sqr_distance = sqr_d;
+        simplex = t;
+      }
+    }
+}
+
+template<class T,int d> static T binary_distance(const SimplexTree<Vector<T,d>,d-1>& tree, const Vector<T,d> point) {
+  int simplex = -1;
+  T sqr_distance = inf;
+  if (tree.nodes())
+    binary_closest_point_helper(tree,point,simplex,sqr_distance,0);
+  return sqrt(sqr_distance);
+}
+
+// Check closest point queries through the wide tree against the binary tree, and check that a tree built from
+// another with moved X leaves the original's queries unchanged
+template<class T,int d> static void closest_point_test(const SimplexTree<Vector<T,d>,d-1>& tree, const int points) {
+  typedef Vector<T,d> TV;
+  const auto box = tree.bounding_box().thickened(1);
+  const auto random = new_<Random>(819371112);
+  Array<TV> X(points,uninit);
+  Array<T> distances(points,uninit);
+  for (int i=0;i<points;i++) {
+    X[i] = random->uniform(box);
+    distances[i] = tree.distance(X[i]);
+    GEODE_ASSERT(distances[i]==binary_distance(tree,X[i]));
+  }
+  const TV shift = random->uniform<TV>(-1,1);
+  Array<TV> moved(tree.X.size(),uninit);
+  for (const int i : range(moved.size()))
+    moved[i] = tree.X[i]+shift;
+  const auto copy = new_<SimplexTree<TV,d-1>>(tree,moved);
+  const auto fresh = new_<SimplexTree<TV,d-1>>(*tree.mesh,moved,tree.leaf_size);
+  for (int i=0;i<points;i++) {
+    GEODE_ASSERT(tree.distance(X[i])==distances[i]);
+    GEODE_ASSERT(copy->distance(X[i])==fresh->distance(X[i]));
+  }
+}
+
+// Time closest point queries through either the wide or the binary tree
+template<class T,int d> static T closest_point_benchmark(const SimplexTree<Vector<T,d>,d-1>& tree, const int points,
+                                                       const bool wide) {
+  typedef Vector<T,d> TV;
+  const auto box = tree.bounding_box().thickened(1);
+  const auto random = new_<Random>(819371112);
+  T sum = 0;
+  for (int i=0;i<points;i++) {
+    const TV x = random->uniform(box);
+    sum += wide ? tree.distance(x) : binary_distance(tree,x);
   }
+  return sum;
+}
+
+// Cast rays from random points in the bounding box to their first hit, for comparing the query cost of trees
+template<class T, int d> static int ray_traversal_benchmark(const SimplexTree<Vector<T,d>,d-1>& tree, const int rays, const T half_thickness) {
+  typedef Vector<T,d> TV;
+  const auto box = tree.bounding_box();
+  const auto random = new_<Random>(819371111);
+  int hits = 0;
+  for (int i=0;i<rays;i++) {
+    const TV start = random->uniform(box);
+    Ray<TV> ray(start,random->direction<TV>());
+    hits += tree.intersection(ray,half_thickness);
+  }
+  return hits;
+}
+
+// Cast the same rays as ray_traversal_benchmark in packets
+template<class T, int d> static int ray_packet_benchmark(const SimplexTree<Vector<T,d>,d-1>& tree, const int rays, const T half_thickness) {
+  typedef Vector<T,d> TV;
+  const auto box = tree.bounding_box();
+  const auto random = new_<Random>(819371111);
+  Array<Ray<TV>> all;
+  for (int i=0;i<rays;i++) {
+    const TV start = random->uniform(box);
+    all.append(Ray<TV>(start,random->direction<TV>()));
+  }
+  int hits = 0;
+  for (const bool hit : tree.intersection(all,half_thickness))
+    hits += hit;
   return hits;
 }
 
@@ -396,7 +827,7 @@ template<class TV,int d> static void wrap_helper() {
   typedef SimplexTree<TV,d> Self;
   static const string name = format("%sTree%dd",(d==1?"Segment":"Triangle"),TV::m);
   Class<Self>(name.c_str())
-    .GEODE_INIT(const typename Self::Mesh&,Array<const TV>,int)
+    .GEODE_INIT(const typename Self::Mesh&,Array<const TV>,int,bool,int)
     .GEODE_FIELD(mesh)
     .GEODE_FIELD(X)
     .GEODE_FIELD(d)
@@ -412,4 +843,9 @@ void wrap_simplex_tree() {
   wrap_helper<Vector<real,3>,1>();
   wrap_helper<Vector<real,3>,2>();
   GEODE_FUNCTION_2(ray_traversal_test,ray_traversal_test<real,3>)
+  GEODE_FUNCTION_2(inside_test,inside_test<real,3>)
+  GEODE_FUNCTION_2(ray_traversal_benchmark,ray_traversal_benchmark<real,3>)
+  GEODE_FUNCTION_2(ray_packet_benchmark,ray_packet_benchmark<real,3>)
+  GEODE_FUNCTION_2(closest_point_test,closest_point_test<real,3>)
+  GEODE_FUNCTION_2(closest_point_benchmark,closest_point_benchmark<real,3>)
 }
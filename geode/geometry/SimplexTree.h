@@ -5,9 +5,12 @@
 #include <geode/utility/config.h>
 #include <geode/geometry/forward.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/geometry/WideBoxTree.h>
 #include <geode/mesh/SegmentSoup.h>
 #include <geode/mesh/TriangleSoup.h>
 #include <geode/math/constants.h>
+#include <atomic>
+#include <mutex>
 #include <vector>
 namespace geode {
 
@@ -26,19 +29,38 @@ public:
   const Ref<const Mesh> mesh;
   const Array<const TV> X;
   const Array<Simplex> simplices;
+private:
+  mutable WideBoxTree<TV> wide_;
+  mutable std::atomic<bool> wide_built;
+  mutable std::mutex wide_mutex;
 
 protected:
-  GEODE_CORE_EXPORT SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size);
+  GEODE_CORE_EXPORT SimplexTree(const Mesh& mesh, Array<const TV> X, int leaf_size, bool sah=false, int threads=1);
   GEODE_CORE_EXPORT SimplexTree(const SimplexTree& other, Array<const TV> X); // Shares ownership for topology (mesh, tree structure, etc.) but not geometry (X,boxes,simplices)
 public:
   ~SimplexTree();
 
   GEODE_CORE_EXPORT void update(); // Call whenever X changes
+
+  // The wide tree used by intersection and closest_point queries.  It is built by the first query that needs it
+  // (safely, if several threads query at once), and refreshed by update() once built.
+  GEODE_CORE_EXPORT const WideBoxTree<TV>& wide() const;
   GEODE_CORE_EXPORT bool intersection(Ray<TV>& ray, const T thickness_over_two) const;
+  // Cast many rays at once, returning which hit.  Rays are sorted by direction octant and traced in packets which
+  // share a single traversal of the tree.  Without thickness, each ray is updated exactly as by intersection(ray,0).
+  // With thickness, which rays hit still matches intersection(ray,thickness_over_two), but thick triangle tests depend
+  // on the order simplices are visited, so t_max and aggregate_id may name a different simplex within the thickness
+  // of the one the single ray version reports.
+  GEODE_CORE_EXPORT Array<bool> intersection(RawArray<Ray<TV>> rays, const T thickness_over_two) const;
   GEODE_CORE_EXPORT Array<Ray<TV> > intersections(const Ray<TV>& ray, const T thickness_over_two) const;
   GEODE_CORE_EXPORT void intersection(const Sphere<TV>& sphere, Array<int>& hits) const;
   GEODE_CORE_EXPORT void intersections(const Plane<T>& plane, Array<Segment<TV>>& result) const;
   GEODE_CORE_EXPORT bool inside(TV point) const;
+  // Inside tests for many points at once, with rays cast in packets on up to threads threads (0 for all).
+  // Each entry is 1 inside, 0 outside, or -1 if all rays were singular.  Since packets report thick hits slightly
+  // differently (see above), points within the ray thickness of the surface may be classified differently than by
+  // inside(point), which might also throw where this returns -1.  All other points agree.
+  GEODE_CORE_EXPORT Array<int> inside(RawArray<const TV> points, const int threads=1) const;
   GEODE_CORE_EXPORT bool inside_given_closest_point(TV point, int simplex, Weights weights) const;
   GEODE_CORE_EXPORT T distance(TV point, T max_distance=inf) const; // return value is infinity if nothing is found
 
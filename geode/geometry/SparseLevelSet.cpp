@@ -0,0 +1,314 @@
+//#####################################################################
+// Class SparseLevelSet
+//#####################################################################
+#include <geode/geometry/SparseLevelSet.h>
+#include <geode/geometry/ParticleTree.h>
+#include <geode/geometry/surface_levelset.h>
+#include <geode/geometry/Triangle3d.h>
+#include <geode/math/small_sort.h>
+#include <geode/python/Class.h>
+#include <geode/utility/str.h>
+#include <queue>
+#include <vector>
+namespace geode {
+
+typedef real T;
+typedef Vector<T,3> TV;
+typedef Vector<int,3> IV;
+GEODE_DEFINE_TYPE(SparseLevelSet)
+
+static const int block = SparseLevelSet::block,
+                 block_nodes = block*block*block;
+
+static inline int floor_div(const int i) {
+  return i>=0 ? i/block : -((block-1-i)/block);
+}
+
+static inline IV floor_div(const IV I) {
+  return IV(floor_div(I.x),floor_div(I.y),floor_div(I.z));
+}
+
+static inline int local_index(const IV I) {
+  return (I.x*block+I.y)*block+I.z;
+}
+
+static inline IV local_node(const int i) {
+  return IV(i/(block*block),i/block%block,i%block);
+}
+
+SparseLevelSet::SparseLevelSet(const SimplexTree<TV,2>& surface, const T dx, const int band, const int threads)
+  : tree(ref(surface))
+  , dx(dx)
+  , band(band)
+  , origin(surface.bounding_box().min) {
+  GEODE_ASSERT(dx>0 && band>=2);
+  const T width = band*dx,
+          seed_width = 2*dx;
+  // Range of nodes covering a box
+  const auto node_box = [=](const Box<TV>& box) {
+    return vec(IV(floor((box.min-origin)/dx)),IV(ceil((box.max-origin)/dx)));
+  };
+
+  // Allocate blocks whose nodes might lie within the band of some triangle
+  const T half_diagonal = T(.5)*sqrt(T(3))*(block-1)*dx;
+  for (const auto& tri : surface.simplices) {
+    const auto nodes = node_box(geode::bounding_box(tri.x0,tri.x1,tri.x2).thickened(width));
+    const auto bmin = floor_div(nodes.x),
+               bmax = floor_div(nodes.y);
+    for (int i=bmin.x;i<=bmax.x;i++)
+      for (int j=bmin.y;j<=bmax.y;j++)
+        for (int k=bmin.z;k<=bmax.z;k++) {
+          const IV b(i,j,k);
+          if (blocks.contains(b))
+            continue;
+          const TV center = origin+dx*(TV(block*b)+T(.5)*(block-1));
+          if (tri.distance(center)<=width+half_diagonal) {
+            blocks.set(b,block_coords.size());
+            block_coords.append(b);
+          }
+        }
+  }
+  values.resize(block_nodes*block_coords.size(),uninit);
+  values.fill(numeric_limits<T>::infinity());
+  for (const auto& b : block_coords)
+    band_box.enlarge(Box<TV>(origin+dx*TV(block*b),origin+dx*TV(block*b+block-1)));
+
+  // Seed nodes near the surface with exact signed distances
+  Array<int> seeds;
+  Array<TV> seed_X;
+  for (const auto& tri : surface.simplices) {
+    const auto nodes = node_box(geode::bounding_box(tri.x0,tri.x1,tri.x2).thickened(seed_width));
+    for (int i=nodes.x.x;i<=nodes.y.x;i++)
+      for (int j=nodes.x.y;j<=nodes.y.y;j++)
+        for (int k=nodes.x.z;k<=nodes.y.z;k++) {
+          const IV I(i,j,k);
+          const int* b = blocks.get_pointer(floor_div(I));
+          if (!b)
+            continue;
+          const int n = block_nodes**b+local_index(I-block*floor_div(I));
+          if (values[n]==numeric_limits<T>::infinity()) {
+            values[n] = 0; // Mark as seen
+            seeds.append(n);
+            seed_X.append(origin+dx*TV(I));
+          }
+        }
+  }
+  for (const int n : seeds)
+    values[n] = numeric_limits<T>::infinity();
+  const auto particles = new_<ParticleTree<TV>>(seed_X,8);
+  const auto closest = surface_levelset(particles,surface,seed_width,true,threads);
+
+  // Fast marching on unsigned distances out to the band width, where each node takes its sign from the neighbor
+  // which determines it
+  Array<bool> negative(values.size());
+  Array<char> state(values.size()); // 0 far, 1 trial, 2 accepted
+  typedef std::pair<T,int> Entry;
+  std::priority_queue<Entry,std::vector<Entry>,std::greater<Entry>> heap;
+  for (const int s : range(seeds.size()))
+    if (closest.z[s]>=0) {
+      const int n = seeds[s];
+      values[n] = abs(closest.x[s]);
+      negative[n] = closest.x[s]<0;
+      state[n] = 2;
+    }
+  // Face adjacent blocks, indexed by 2*axis+side
+  Array<Vector<int,6>> adjacent(block_coords.size(),uninit);
+  for (const int b : range(block_coords.size()))
+    for (int a=0;a<3;a++)
+      for (int side=0;side<2;side++) {
+        IV c = block_coords[b];
+        c[a] += side ? 1 : -1;
+        adjacent[b][2*a+side] = blocks.get_default(c,-1);
+      }
+  const int stride[3] = {block*block,block,1};
+  const auto neighbor = [&](const int n, const int a, const int side) {
+    const int l = n%block_nodes,
+              i = l/stride[a]%block;
+    if (side ? i<block-1 : i>0)
+      return side ? n+stride[a] : n-stride[a];
+    const int b = adjacent[n/block_nodes][2*a+side];
+    return b<0 ? -1 : block_nodes*b+l+(side ? -1 : 1)*(block-1)*stride[a];
+  };
+  const auto update = [&](const int n) {
+    // Smallest accepted neighbor along each axis
+    Vector<T,3> a;
+    int sign_from = -1;
+    for (int axis=0;axis<3;axis++) {
+      a[axis] = numeric_limits<T>::infinity();
+      for (int side=0;side<2;side++) {
+        const int m = neighbor(n,axis,side);
+        if (m>=0 && state[m]==2 && a[axis]>values[m]) {
+          a[axis] = values[m];
+          if (sign_from<0 || values[sign_from]>values[m])
+            sign_from = m;
+        }
+      }
+    }
+    if (sign_from<0)
+      return;
+    // Solve sum_i (u-a_i)^2 = dx^2 over the axes with a_i < u
+    small_sort(a.x,a.y,a.z);
+    T u = a.x+dx;
+    for (int used=2;used<=3 && u>a[used-1];used++) {
+      T sum = 0, sqr_sum = 0;
+      for (int i=0;i<used;i++) {
+        sum += a[i];
+        sqr_sum += sqr(a[i]);
+      }
+      const T disc = sqr(sum)-used*(sqr_sum-sqr(dx));
+      if (disc<0)
+        break;
+      u = (sum+sqrt(disc))/used;
+    }
+    if (u<=width && values[n]>u) {
+      values[n] = u;
+      negative[n] = negative[sign_from];
+      state[n] = 1;
+      heap.push(Entry(u,n));
+    }
+  };
+  for (const int n : seeds)
+    if (state[n]==2)
+      for (int axis=0;axis<3;axis++)
+        for (int side=0;side<2;side++) {
+          const int m = neighbor(n,axis,side);
+          if (m>=0 && state[m]!=2)
+            update(m);
+        }
+  while (heap.size()) {
+    const auto e = heap.top();
+    heap.pop();
+    const int n = e.second;
+    if (state[n]==2 || e.first>values[n])
+      continue;
+    state[n] = 2;
+    for (int axis=0;axis<3;axis++)
+      for (int side=0;side<2;side++) {
+        const int m = neighbor(n,axis,side);
+        if (m>=0 && state[m]!=2)
+          update(m);
+      }
+  }
+
+  // Nodes beyond the band are left at infinity, so lookups touching them fall back to the exact distance
+  for (const int n : range(values.size()))
+    if (state[n]==2 && negative[n])
+      values[n] = -values[n];
+}
+
+SparseLevelSet::~SparseLevelSet() {}
+
+const T* SparseLevelSet::node_pointer(const IV node) const {
+  const auto b = floor_div(node);
+  const int* index = blocks.get_pointer(b);
+  return index ? &values[block_nodes**index+local_index(node-block*b)] : 0;
+}
+
+T SparseLevelSet::node_phi(const IV node) const {
+  const T* p = node_pointer(node);
+  return p && abs(*p)!=numeric_limits<T>::infinity() ? *p : numeric_limits<T>::quiet_NaN();
+}
+
+bool SparseLevelSet::interpolate(const TV& X, T& phi, TV* gradient) const {
+  if (!band_box.lazy_inside(X))
+    return false;
+  const TV u = (X-origin)/dx;
+  const IV I(floor(u));
+  const TV f = u-TV(I);
+  // Corner values, in the same block if possible
+  Vector<T,8> v;
+  const auto b = floor_div(I);
+  const auto L = I-block*b;
+  if (L.max()<block-1) {
+    const int* index = blocks.get_pointer(b);
+    if (!index)
+      return false;
+    const T* base = &values[block_nodes**index+local_index(L)];
+    for (int c=0;c<8;c++)
+      v[c] = base[((c>>2&1)*block+(c>>1&1))*block+(c&1)];
+  } else
+    for (int c=0;c<8;c++) {
+      const T* p = node_pointer(I+IV(c>>2&1,c>>1&1,c&1));
+      if (!p)
+        return false;
+      v[c] = *p;
+    }
+  for (int c=0;c<8;c++)
+    if (abs(v[c])==numeric_limits<T>::infinity())
+      return false;
+  // Trilinear interpolation along z, then y, then x
+  const T v00 = v[0]+f.z*(v[1]-v[0]), v01 = v[2]+f.z*(v[3]-v[2]),
+          v10 = v[4]+f.z*(v[5]-v[4]), v11 = v[6]+f.z*(v[7]-v[6]),
+          v0 = v00+f.y*(v01-v00), v1 = v10+f.y*(v11-v10);
+  phi = v0+f.x*(v1-v0);
+  if (gradient) {
+    const T z00 = v[1]-v[0], z01 = v[3]-v[2],
+            z10 = v[5]-v[4], z11 = v[7]-v[6],
+            z0 = z00+f.y*(z01-z00), z1 = z10+f.y*(z11-z10);
+    *gradient = TV(v1-v0,
+                   (v01-v00)+f.x*((v11-v10)-(v01-v00)),
+                   z0+f.x*(z1-z0))/dx;
+  }
+  return true;
+}
+
+T SparseLevelSet::exact_phi(const TV& X, TV* normal) const {
+  const auto c = tree->closest_point(X);
+  if (c.y<0) {
+    if (normal)
+      *normal = TV();
+    return numeric_limits<T>::infinity();
+  }
+  const TV delta = X-c.x;
+  const T distance = magnitude(delta);
+  const bool inside = tree->inside_given_closest_point(X,c.y,c.z);
+  if (normal)
+    *normal = distance ? (inside ? -delta : delta)/distance : tree->simplices[c.y].n;
+  return inside ? -distance : distance;
+}
+
+T SparseLevelSet::phi(const TV& X) const {
+  T phi;
+  return interpolate(X,phi,0) ? phi : exact_phi(X,0);
+}
+
+TV SparseLevelSet::normal(const TV& X) const {
+  T phi;
+  TV gradient;
+  if (interpolate(X,phi,&gradient) && gradient!=TV())
+    return gradient.normalized();
+  exact_phi(X,&gradient);
+  return gradient;
+}
+
+TV SparseLevelSet::surface(const TV& X) const {
+  return X-phi(X)*normal(X);
+}
+
+bool SparseLevelSet::lazy_inside(const TV& X) const {
+  return phi(X)<=0;
+}
+
+Box<TV> SparseLevelSet::bounding_box() const {
+  return tree->bounding_box();
+}
+
+string SparseLevelSet::repr() const {
+  return format("SparseLevelSet(SimplexTree(TriangleSoup(%s),%s,%d),%s,%d,1)",
+                str(tree->mesh->elements),str(tree->X),tree->leaf_size,str(dx),band);
+}
+
+}
+using namespace geode;
+
+void wrap_sparse_levelset() {
+  typedef SparseLevelSet Self;
+  Class<Self>("SparseLevelSet")
+    .GEODE_INIT(const SimplexTree<TV,2>&,T,int,int)
+    .GEODE_FIELD(dx)
+    .GEODE_FIELD(band)
+    .GEODE_FIELD(origin)
+    .GEODE_METHOD(allocated_blocks)
+    .GEODE_METHOD(node_phi)
+    ;
+}
@@ -0,0 +1,70 @@
+//#####################################################################
+// Class SparseLevelSet
+//#####################################################################
+//
+// A narrow band signed distance field for a closed triangle mesh, stored in sparse blocks of 8x8x8 grid nodes.
+// Only blocks within band cells of the surface are allocated.  Nodes within two cells of the surface get exact
+// distances and signs from surface_levelset, and fast marching extends these to the rest of the allocated blocks.
+//
+// Inside the band, phi and normal are trilinear interpolants of the nodes and their gradient.  Queries outside the
+// band fall back to exact distances from the SimplexTree, so the result is a valid Implicit everywhere.
+// TriangleTopology meshes can be converted with face_soup().
+//
+//#####################################################################
+#pragma once
+
+#include <geode/geometry/Implicit.h>
+#include <geode/geometry/SimplexTree.h>
+#include <geode/structure/Hashtable.h>
+namespace geode {
+
+class SparseLevelSet : public Implicit<Vector<real,3>> {
+public:
+  GEODE_DECLARE_TYPE(GEODE_CORE_EXPORT)
+  typedef real T;
+  typedef Vector<T,3> TV;
+  typedef Implicit<TV> Base;
+  static const int block = 8; // Nodes per block along each axis
+
+  const Ref<const SimplexTree<TV,2>> tree; // The surface
+  const T dx; // Grid spacing
+  const int band; // Half width of the band in cells
+  const TV origin; // Position of node (0,0,0)
+
+protected:
+  Hashtable<Vector<int,3>,int> blocks; // Block coordinates to block index
+  Array<Vector<int,3>> block_coords;
+  Array<T> values; // block*block^3 + local node index
+  Box<TV> band_box; // Bounding box of all allocated blocks
+
+  GEODE_CORE_EXPORT SparseLevelSet(const SimplexTree<TV,2>& surface, const T dx, const int band, const int threads);
+public:
+  ~SparseLevelSet();
+
+  int allocated_blocks() const {
+    return block_coords.size();
+  }
+
+  // Signed distance at a grid node, or nan if the node is outside the band
+  GEODE_CORE_EXPORT T node_phi(const Vector<int,3> node) const;
+
+  // Trilinear interpolation and its gradient, returning false outside the band
+  GEODE_CORE_EXPORT bool interpolate(const TV& X, T& phi, TV* gradient) const;
+
+  T phi(const TV& X) const;
+  TV normal(const TV& X) const;
+  TV surface(const TV& X) const;
+  bool lazy_inside(const TV& X) const;
+  Box<TV> bounding_box() const;
+  string repr() const;
+  using Base::phi;
+  using Base::normal;
+  using Base::surface;
+  using Base::lazy_inside;
+
+private:
+  const T* node_pointer(const Vector<int,3> node) const;
+  T exact_phi(const TV& X, TV* normal) const;
+};
+
+}
@@ -34,6 +34,12 @@ public:
   Box<TV> bounding_box() const;
   string repr() const;
 
+  // Batch phi loops over elements outside and points inside, so that the per element setup is shared
+  void phi(RawArray<const TV> X, RawArray<T> phi) const;
+  void lazy_inside(RawArray<const TV> X, RawArray<bool> inside) const;
+  using Base::normal;
+  using Base::surface;
+
 private:
   Tuple<T,TV> phi_normal(const TV& X) const;
 };
@@ -0,0 +1,69 @@
+//#####################################################################
+// Class WideBoxTree
+//#####################################################################
+#include <geode/geometry/WideBoxTree.h>
+namespace geode {
+
+// Build the wide node covering the binary subtree below root, returning its index and the depth below it
+template<class TV> static int build(WideBoxTree<TV>& self, const BoxTree<TV>& tree, const int root, int& depth) {
+  typedef typename WideBoxTree<TV>::Node Node;
+  const int width = WideBoxTree<TV>::width;
+
+  // Expand the internal binary node with the largest box until the lanes are full
+  Vector<int,width> lanes;
+  int count = 1;
+  lanes[0] = root;
+  while (count<width) {
+    int best = -1;
+    for (int i=0;i<count;i++)
+      if (   !tree.is_leaf(lanes[i])
+          && (best<0 || tree.boxes[lanes[i]].sizes().sum()>tree.boxes[lanes[best]].sizes().sum()))
+        best = i;
+    if (best<0)
+      break;
+    const int n = lanes[best];
+    lanes[best] = 2*n+1;
+    lanes[count++] = 2*n+2;
+  }
+
+  // Fill lanes, and recurse into internal ones
+  const int node = self.nodes.append(Node());
+  for (int i=0;i<width;i++) {
+    self.nodes[node].binary[i] = i<count ? lanes[i] : -1;
+    self.nodes[node].children[i] = -1;
+  }
+  depth = 1;
+  for (int i=0;i<count;i++) {
+    int child_depth = 0;
+    const int child = tree.is_leaf(lanes[i]) ? -1-lanes[i] : build(self,tree,lanes[i],child_depth);
+    self.nodes[node].children[i] = child;
+    depth = max(depth,1+child_depth);
+  }
+  return node;
+}
+
+template<class TV> WideBoxTree<TV>::WideBoxTree(const BoxTree<TV>& tree)
+  : depth(0) {
+  if (tree.nodes()) {
+    nodes.preallocate(tree.nodes()/3+1);
+    build(*this,tree,0,depth);
+  }
+  update(tree);
+}
+
+template<class TV> void WideBoxTree<TV>::update(const BoxTree<TV>& tree) {
+  const Box<TV> empty;
+  for (auto& node : nodes)
+    for (int i=0;i<width;i++) {
+      const int n = node.binary[i];
+      const auto& box = n>=0 ? tree.boxes[n] : empty;
+      for (int a=0;a<d;a++) {
+        node.min[a][i] = box.min[a];
+        node.max[a][i] = box.max[a];
+      }
+    }
+}
+
+template class WideBoxTree<Vector<real,2>>;
+template class WideBoxTree<Vector<real,3>>;
+}
@@ -0,0 +1,87 @@
+//#####################################################################
+// Class WideBoxTree
+//#####################################################################
+//
+// WideBoxTree collapses a binary BoxTree into a 4-wide hierarchy for faster queries.
+// Each wide node stores the boxes of up to four children in structure of arrays
+// form, so that one vector instruction handles one axis of all four children.
+// A child is either another wide node or a leaf of the binary tree, so leaf
+// primitives are still found through BoxTree::prims.
+//
+// Each wide node is formed by repeatedly expanding its largest internal binary
+// descendant until there are four.  Unused lanes hold empty boxes, which never
+// intersect anything and are infinitely far from every point.
+//
+//#####################################################################
+#pragma once
+
+#include <geode/geometry/BoxTree.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+namespace geode {
+namespace {
+
+// Squared distances from X to four boxes stored one vector per axis
+template<class T,int d> static inline Vector<T,4>
+wide_sqr_distances(const Vector<Vector<T,4>,d>& min, const Vector<Vector<T,4>,d>& max, const Vector<T,d>& X) {
+  Vector<T,4> bounds;
+  for (int a=0;a<d;a++)
+    for (int i=0;i<4;i++) {
+      const T dx = geode::max(min[a][i]-X[a],X[a]-max[a][i],T(0));
+      bounds[i] += dx*dx;
+    }
+  return bounds;
+}
+
+#ifdef __AVX__
+template<int d> static inline Vector<double,4>
+wide_sqr_distances(const Vector<Vector<double,4>,d>& min, const Vector<Vector<double,4>,d>& max,
+                   const Vector<double,d>& X) {
+  __m256d sum = _mm256_setzero_pd();
+  for (int a=0;a<d;a++) {
+    const __m256d x = _mm256_set1_pd(X[a]),
+                  dx = _mm256_max_pd(_mm256_max_pd(_mm256_sub_pd(_mm256_loadu_pd(&min[a][0]),x),
+                                                   _mm256_sub_pd(x,_mm256_loadu_pd(&max[a][0]))),
+                                     _mm256_setzero_pd());
+    sum = _mm256_add_pd(sum,_mm256_mul_pd(dx,dx));
+  }
+  Vector<double,4> bounds;
+  _mm256_storeu_pd(&bounds[0],sum);
+  return bounds;
+}
+#endif
+
+}
+
+template<class TV> class WideBoxTree {
+  typedef typename TV::Scalar T;
+public:
+  static const int d = TV::m;
+  static const int width = 4;
+  typedef Vector<T,width> TW;
+
+  struct Node {
+    Vector<TW,d> min, max; // Child boxes, one vector per axis
+    Vector<int,width> children; // Wide node if nonnegative, otherwise -1-leaf for binary tree leaves
+    Vector<int,width> binary; // Binary tree node of each child, or -1 for unused lanes
+  };
+
+  Array<Node> nodes; // Node 0 is the root
+  int depth; // Maximum number of wide nodes on a path from the root
+
+  WideBoxTree()
+    : depth(0) {}
+
+  GEODE_CORE_EXPORT explicit WideBoxTree(const BoxTree<TV>& tree);
+
+  // Copy boxes from the binary tree after they change
+  GEODE_CORE_EXPORT void update(const BoxTree<TV>& tree);
+
+  // Squared distances from a point to each child box
+  TW sqr_distance_bounds(const Node& node, const TV& X) const {
+    return wide_sqr_distances(node.min,node.max,X);
+  }
+};
+
+}
@@ -18,5 +18,6 @@ void wrap_geometry() {
   GEODE_WRAP(bezier)
   GEODE_WRAP(segment)
   GEODE_WRAP(surface_levelset)
+  GEODE_WRAP(sparse_levelset)
   GEODE_WRAP(offset_mesh)
 }
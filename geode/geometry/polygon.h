@@ -29,7 +29,7 @@ GEODE_CORE_EXPORT Array<Vec2> resample_polygon(RawArray<const Vec2> poly, double
 // if p2_tree is NULL, a search tree is created for p2
 GEODE_CORE_EXPORT bool polygon_outlines_intersect(RawArray<const Vec2> p1, RawArray<const Vec2> p2, Ptr<SimplexTree<Vec2,1>> p2_tree = Ptr<>());
 
-// Is the point inside the polygon?  WARNING: Not robust
+// Is the point inside the polygon?  WARNING: Not robust.  For many queries, use PolygonLocator (geode/exact/PolygonLocator.h).
 GEODE_CORE_EXPORT bool inside_polygon(RawArray<const Vec2> poly, const Vec2 p);
 
 // Find a point inside the shape defined by polys, and inside the contour poly.
@@ -6,10 +6,13 @@
 #include <geode/geometry/SimplexTree.h>
 #include <geode/geometry/Segment.h>
 #include <geode/geometry/Triangle3d.h>
+#include <geode/array/IndirectArray.h>
 #include <geode/array/ProjectedArray.h>
 #include <geode/array/ConstantMap.h>
+#include <geode/python/ExceptionValue.h>
 #include <geode/python/wrap.h>
 #include <geode/utility/Log.h>
+#include <geode/utility/openmp.h>
 #include <limits>
 namespace geode {
 
@@ -32,13 +35,109 @@ static inline T lower_bound_sqr_phi(const Box<TV>& n1, const Box<TV>& n2) {
   return sqr_magnitude((n1-n2).clamp(TV()));
 }
 
+// Triangles in surface tree order, one row per field, so that leaves can compute many distances at once
+struct TriangleLanes {
+  enum { x0, e0=3, e1=6, n=9, inv00=12, inv11, invff, invnn, fields };
+  Array<T,2> lanes;
+
+  TriangleLanes() {}
+
+  TriangleLanes(const SimplexTree<TV,2>& surface)
+    : lanes(fields,surface.p.size(),uninit) {
+    const auto inv = [](const T x) { return x ? 1/x : T(0); };
+    for (const int j : range(surface.p.size())) {
+      const auto& tri = surface.simplices[surface.p[j]];
+      const TV e0 = tri.x1-tri.x0,
+               e1 = tri.x2-tri.x0,
+               n = cross(e0,e1);
+      for (int a=0;a<3;a++) {
+        lanes(x0+a,j) = tri.x0[a];
+        lanes(TriangleLanes::e0+a,j) = e0[a];
+        lanes(TriangleLanes::e1+a,j) = e1[a];
+        lanes(TriangleLanes::n+a,j) = n[a];
+      }
+      lanes(inv00,j) = inv(sqr_magnitude(e0));
+      lanes(inv11,j) = inv(sqr_magnitude(e1));
+      lanes(invff,j) = inv(sqr_magnitude(e1-e0));
+      lanes(invnn,j) = inv(sqr_magnitude(n));
+    }
+  }
+
+  // Squared distances from X to the triangles at tree positions [lo,hi).  The closest point is on the plane if its
+  // projection lies inside the triangle, and otherwise on the nearest edge.  All branches are selects, so the loop
+  // vectorizes across triangles.
+  void sqr_distances(const TV X, const int lo, const int hi, T* __restrict__ sd) const {
+    #define L(f) const T* __restrict__ f = &lanes(TriangleLanes::f,lo);
+    L(x0) L(e0) L(e1) L(n) L(inv00) L(inv11) L(invff) L(invnn)
+    #undef L
+    const int m = hi-lo,
+              s = lanes.n;
+    for (int i=0;i<m;i++) {
+      const T vx = X.x-x0[i], vy = X.y-x0[i+s], vz = X.z-x0[i+2*s],
+              ax = e0[i], ay = e0[i+s], az = e0[i+2*s],
+              bx = e1[i], by = e1[i+s], bz = e1[i+2*s],
+              nx = n[i], ny = n[i+s], nz = n[i+2*s],
+              fx = bx-ax, fy = by-ay, fz = bz-az,
+              ux = vx-ax, uy = vy-ay, uz = vz-az;
+      // Edges x0-x1, x0-x2, and x1-x2
+      const T t0 = clamp((vx*ax+vy*ay+vz*az)*inv00[i],T(0),T(1)),
+              t1 = clamp((vx*bx+vy*by+vz*bz)*inv11[i],T(0),T(1)),
+              t2 = clamp((ux*fx+uy*fy+uz*fz)*invff[i],T(0),T(1)),
+              d0 = sqr(vx-t0*ax)+sqr(vy-t0*ay)+sqr(vz-t0*az),
+              d1 = sqr(vx-t1*bx)+sqr(vy-t1*by)+sqr(vz-t1*bz),
+              d2 = sqr(ux-t2*fx)+sqr(uy-t2*fy)+sqr(uz-t2*fz),
+              edge = min(d0,d1,d2);
+      // Plane, if the projection is inside
+      const T nv = nx*vx+ny*vy+nz*vz,
+              s0 = nx*(ay*vz-az*vy)+ny*(az*vx-ax*vz)+nz*(ax*vy-ay*vx),
+              s1 = nx*(vy*bz-vz*by)+ny*(vz*bx-vx*bz)+nz*(vx*by-vy*bx),
+              s2 = nx*(fy*uz-fz*uy)+ny*(fz*ux-fx*uz)+nz*(fx*uy-fy*ux);
+      const bool inside = (s0>=0) & (s1>=0) & (s2>=0) & (invnn[i]>0);
+      sd[i] = inside ? nv*nv*invnn[i] : edge;
+    }
+  }
+};
+
 template<int d> struct Helper {
   const ParticleTree<TV>& particles;
   const SimplexTree<TV,d>& surface;
+  const TriangleLanes& lanes; // Empty unless d==2
   RawArray<T> sqr_phi_node;
   RawArray<CloseInfo<d>> info; // phi = sqr_phi, normal = delta
+  Array<T> sd; // Scratch space for one surface leaf
 
-  void eval(const int pn, const int sn) const {
+  // Closest simplex to particle p among surface leaf sn, if closer than info[p]
+  void leaf(const int p, const int sn, Segment<TV>*) {
+    for (const int t : surface.prims(sn)) {
+      if (profile)
+        evaluation_count++;
+      update(p,t);
+    }
+  }
+
+  void leaf(const int p, const int sn, Triangle<TV>*) {
+    const auto r = surface.ranges[sn];
+    if (profile)
+      evaluation_count += r.size();
+    lanes.sqr_distances(particles.X[p],r.lo,r.hi,sd.data());
+    int best = 0;
+    for (int i=1;i<r.size();i++)
+      if (sd[best]>sd[i])
+        best = i;
+    // Redo the winner with the exact scalar routine to get the closest point and weights
+    if (info[p].phi > sd[best])
+      update(p,surface.p[r.lo+best]);
+  }
+
+  void update(const int p, const int t) {
+    const auto close = surface.simplices[t].closest_point(particles.X[p]);
+    const TV delta = particles.X[p] - close.x;
+    const T sd = sqr_magnitude(delta);
+    if (info[p].phi > sd)
+      info[p] = CloseInfo<d>({sd,delta,t,close.y});
+  }
+
+  void eval(const int pn, const int sn) {
     const Box<TV> &pbox = particles.boxes[pn],
                   &sbox = surface.boxes[sn];
     const bool pleaf = particles.is_leaf(pn),
@@ -46,18 +145,9 @@ template<int d> struct Helper {
     if (pleaf && sleaf) { // Two leaves: compute all pairwise distances
       sqr_phi_node[pn] = 0;
       const auto particle_prims = particles.prims(pn);
-      const auto surface_prims = surface.prims(sn);
       for (const int p : particle_prims) {
         if (info[p].phi > lower_bound_sqr_phi(particles.X[p],sbox))
-          for (const int t : surface_prims) {
-            if (profile)
-              evaluation_count++;
-            const auto close = surface.simplices[t].closest_point(particles.X[p]);
-            const TV delta = particles.X[p] - close.x;
-            const T sd = sqr_magnitude(delta);
-            if (info[p].phi > sd)
-              info[p] = CloseInfo<d>({sd,delta,t,close.y});
-          }
+          leaf(p,sn,(typename SimplexTree<TV,d>::Simplex*)0);
         sqr_phi_node[pn] = max(sqr_phi_node[pn],info[p].phi);
       }
     } else if (pleaf || (!sleaf && pbox.sizes().max()<=sbox.sizes().max())) {
@@ -80,6 +170,28 @@ template<int d> struct Helper {
     }
   }
 };
+
+static TriangleLanes triangle_lanes(const SimplexTree<TV,1>& surface) { return TriangleLanes(); }
+static TriangleLanes triangle_lanes(const SimplexTree<TV,2>& surface) { return TriangleLanes(surface); }
+
+// Split the particle tree into independent subtrees breadth first.  The split does not depend on thread count, so
+// neither do the results.
+static Array<int> particle_tasks(const ParticleTree<TV>& particles, const int count) {
+  Array<int> tasks, queue;
+  queue.append(0);
+  int lo = 0;
+  while (lo<queue.size() && tasks.size()+queue.size()-lo<count) {
+    const int n = queue[lo++];
+    if (particles.is_leaf(n))
+      tasks.append(n);
+    else {
+      queue.append(2*n+1);
+      queue.append(2*n+2);
+    }
+  }
+  tasks.extend(queue.slice(lo,queue.size()));
+  return tasks;
+}
 }
 
 static TV normal_flip(const Segment<TV>& seg, const TV u) {
@@ -100,10 +212,40 @@ static TV normal_flip(const Triangle<TV>& tri, const TV u) {
 static TV normal_noflip(const Segment<TV>& seg) { GEODE_UNREACHABLE(); }
 static TV normal_noflip(const Triangle<TV>& tri) { return tri.n; }
 
+// Inside tests given closest points: 1 inside, 0 outside, -1 if the test failed.  Closest points interior to a
+// triangle are resolved by its plane, and the remaining particles cast rays together in tree order, so that nearby
+// rays share packets.
+static Array<int> inside_signs(const ParticleTree<TV>& particles, const SimplexTree<TV,1>& surface,
+                               RawArray<const CloseInfo<1>> info, const int threads) {
+  GEODE_UNREACHABLE();
+}
+static Array<int> inside_signs(const ParticleTree<TV>& particles, const SimplexTree<TV,2>& surface,
+                               RawArray<const CloseInfo<2>> info, const int threads) {
+  const T small = sqrt(numeric_limits<T>::epsilon());
+  const int n = info.size(),
+            nt = threads ? threads : omp_get_max_threads();
+  Array<int> sign(n,uninit), cast;
+  for (const int i : particles.p)
+    if (info[i].simplex>=0 && !(Triangle<TV>::min_weight(info[i].weights) > small))
+      cast.append(i);
+  #pragma omp parallel for num_threads(nt)
+  for (int i=0;i<n;i++)
+    if (info[i].simplex>=0) {
+      const auto& tri = surface.simplices[info[i].simplex];
+      sign[i] = dot(tri.n,particles.X[i]-tri.x0)<=0;
+    }
+  const auto inside = surface.inside(particles.X.subset(cast).copy(),threads);
+  for (const int j : range(cast.size()))
+    sign[cast[j]] = inside[j];
+  return sign;
+}
+
 template<int d> void surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& surface,
                                       RawArray<typename Hide<CloseInfo<d>>::type> info,
-                                      const T max_distance, const bool compute_signs) {
+                                      const T max_distance, const bool compute_signs, const int threads) {
   GEODE_ASSERT(particles.X.size()==info.size());
+  GEODE_ASSERT(threads>=0);
+  const int nt = threads ? threads : omp_get_max_threads();
   const T sqr_max_distance = sqr(max_distance);
   for (auto& I : info) {
     I.phi = sqr_max_distance;
@@ -112,8 +254,29 @@ template<int d> void surface_levelset(const ParticleTree<TV>& particles, const S
   if (profile)
     evaluation_count = 0;
   const auto sqr_phi_node = constant_map(particles.nodes(),sqr_max_distance).copy();
-  if (particles.X.size() && surface.simplices.size())
-    Helper<d>({particles,surface,sqr_phi_node,info}).eval(0,0);
+  if (particles.X.size() && surface.simplices.size()) {
+    const auto lanes = triangle_lanes(surface);
+    int max_leaf = 0;
+    for (const int n : surface.leaves)
+      max_leaf = max(max_leaf,surface.ranges[n].size());
+    // Each particle subtree writes only its own nodes and particles
+    const auto tasks = particle_tasks(particles,256);
+    ExceptionValue error;
+    #pragma omp parallel for schedule(dynamic,1) num_threads(nt)
+    for (int i=0;i<tasks.size();i++) {
+      try {
+        Helper<d>({particles,surface,lanes,sqr_phi_node,info,Array<T>(max_leaf,uninit)}).eval(tasks[i],0);
+      } catch (const std::exception& e) {
+        #pragma omp critical
+        {
+          if (!error)
+            error = ExceptionValue(e);
+        }
+      }
+    }
+    if (error)
+      error.throw_();
+  }
   if (profile) {
     long slow_count = (long)particles.X.size()*surface.simplices.size();
     cout << "particles = "<<particles.X.size()<<", per particle "<<evaluation_count/particles.X.size()<<endl;
@@ -122,41 +285,45 @@ template<int d> void surface_levelset(const ParticleTree<TV>& particles, const S
   }
   const T epsilon = sqrt(numeric_limits<T>::epsilon())*max(particles.bounding_box().sizes().max(),
                                                              surface.bounding_box().sizes().max());
-  if (d<TV::m-1 || !compute_signs)
-    for (auto& I : info) {
+  const int n = info.size();
+  if (d<TV::m-1 || !compute_signs) {
+    #pragma omp parallel for num_threads(nt)
+    for (int i=0;i<n;i++) {
+      auto& I = info[i];
       I.phi = sqrt(I.phi);
       I.normal = (I.simplex) < 0 ? TV() // Parentheses needed for gcc 4.9 bug
                : I.phi > epsilon ? I.normal / I.phi
                                  : normal_flip(surface.simplices[I.simplex],I.normal);
     }
-  else // compute_signs
-    for (const int i : range(info.size())) {
-      auto& I = info[i];
-      I.phi = sqrt(I.phi);
-      if ((I.simplex) < 0) // Parentheses needed for gcc 4.9 bug
-        I.normal = TV();
-      else {
-        try {
-          const bool inside = surface.inside_given_closest_point(particles.X[i],I.simplex,I.weights);
-          if (inside)
-            I.phi = -I.phi;
-          if (abs(I.phi) > epsilon)
-            I.normal /= I.phi;
-          else
-            I.normal = normal_noflip(surface.simplices[I.simplex]);
-        } catch (const ArithmeticError&) { // Inside test failed, assume zero
-          I.phi = 0;
-          I.normal = normal_noflip(surface.simplices[I.simplex]);
-        }
-      }
+    return;
+  }
+
+  const auto sign = inside_signs(particles,surface,info,threads);
+  #pragma omp parallel for num_threads(nt)
+  for (int i=0;i<n;i++) {
+    auto& I = info[i];
+    I.phi = sqrt(I.phi);
+    if ((I.simplex) < 0) // Parentheses needed for gcc 4.9 bug
+      I.normal = TV();
+    else if (sign[i]<0) { // Inside test failed, assume zero
+      I.phi = 0;
+      I.normal = normal_noflip(surface.simplices[I.simplex]);
+    } else {
+      if (sign[i])
+        I.phi = -I.phi;
+      if (abs(I.phi) > epsilon)
+        I.normal /= I.phi;
+      else
+        I.normal = normal_noflip(surface.simplices[I.simplex]);
     }
+  }
 }
 
 template<int d> Tuple<Array<T>,Array<TV>,Array<int>,Array<typename SimplexTree<TV,d>::Weights>>
 surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& surface,
-                 const T max_distance, const bool compute_signs) {
+                 const T max_distance, const bool compute_signs, const int threads) {
   Array<CloseInfo<d>> info(particles.X.size(),uninit);
-  surface_levelset<d>(particles,surface,info,max_distance,compute_signs);
+  surface_levelset<d>(particles,surface,info,max_distance,compute_signs,threads);
   return tuple(info.template project<T,&CloseInfo<d>::phi>().copy(),
                info.template project<TV,&CloseInfo<d>::normal>().copy(),
                info.template project<int,&CloseInfo<d>::simplex>().copy(),
@@ -164,9 +331,9 @@ surface_levelset(const ParticleTree<TV>& particles, const SimplexTree<TV,d>& sur
 }
 
 #define INSTANTIATE(d) \
-  template void surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,RawArray<CloseInfo<d>>,T,bool); \
+  template void surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,RawArray<CloseInfo<d>>,T,bool,int); \
   template Tuple<Array<T>,Array<TV>,Array<int>,Array<typename SimplexTree<TV,d>::Weights>> \
-    surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,const T,const bool);
+    surface_levelset(const ParticleTree<TV>&,const SimplexTree<TV,d>&,const T,const bool,const int);
 INSTANTIATE(1)
 INSTANTIATE(2)
 
@@ -202,8 +369,8 @@ using namespace geode;
 
 void wrap_surface_levelset() {
   GEODE_FUNCTION_2(surface_levelset_c3d,static_cast<Tuple<Array<T>,Array<TV>,Array<int>,Array<T>>(*)(
-    const ParticleTree<TV>&,const SimplexTree<TV,1>&,T,bool)>(surface_levelset))
+    const ParticleTree<TV>&,const SimplexTree<TV,1>&,T,bool,int)>(surface_levelset))
   GEODE_FUNCTION_2(surface_levelset_s3d,static_cast<Tuple<Array<T>,Array<TV>,Array<int>,Array<TV>>(*)(
-    const ParticleTree<TV>&,const SimplexTree<TV,2>&,T,bool)>(surface_levelset))
+    const ParticleTree<TV>&,const SimplexTree<TV,2>&,T,bool,int)>(surface_levelset))
   GEODE_FUNCTION(slow_surface_levelset)
 }
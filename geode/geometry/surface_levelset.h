@@ -23,12 +23,14 @@ template<int d> struct CloseInfo {
 template<int d> GEODE_CORE_EXPORT void surface_levelset(const ParticleTree<Vector<real,3>>& particles,
                                                         const SimplexTree<Vector<real,3>,d>& surface,
                                                         RawArray<typename Hide<CloseInfo<d>>::type> info,
-                                                        const real max_distance=inf, const bool compute_signs=true);
+                                                        const real max_distance=inf, const bool compute_signs=true,
+                                                        const int threads=1);
 
 // Functional-style version: returns distance, normals, closest simplex, and barycentric weights per point.
+// Particle subtrees are processed on up to threads threads (0 for all); the result does not depend on threads.
 template<int d> GEODE_CORE_EXPORT Tuple<Array<real>,Array<Vector<real,3>>,
                                         Array<int>,Array<typename SimplexTree<Vector<real,3>,d>::Weights>>
 surface_levelset(const ParticleTree<Vector<real,3>>& particles, const SimplexTree<Vector<real,3>,d>& surface,
-                 const real max_distance=inf, const bool compute_signs=true);
+                 const real max_distance=inf, const bool compute_signs=true, const int threads=1);
 
 }
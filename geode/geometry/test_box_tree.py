@@ -3,6 +3,7 @@
 from __future__ import division
 from geode import *
 from geode.geometry.platonic import *
+import time
 
 def test_box_tree():
   random.seed(10098331)
@@ -11,6 +12,19 @@ def test_box_tree():
     x = random.randn(n,3).astype(real)
     tree = BoxTree(x,10)
     tree.check(x)
+    for threads in 1,3:
+      assert all(BoxTree(x,10,False,threads).p==tree.p)
+      BoxTree(x,10,True,threads).check(x)
+
+def test_parallel_double_traverse():
+  random.seed(1031)
+  for n in 0,1,35,200,1000:
+    tree0 = BoxTree(random.randn(n,3).astype(real),1)
+    tree1 = BoxTree(random.randn(2*n,3).astype(real),3)
+    for thickness in 0,.5:
+      for threads in 1,2,3,7,0:
+        pairs = parallel_double_traverse_test(tree0,tree1,threads,thickness)
+        assert pairs>0 or n<35 or not thickness
 
 def test_particle_tree():
   random.seed(10098331)
@@ -23,6 +37,35 @@ def test_particle_tree():
     tree.update()
     tree.check(X)
 
+def test_particle_neighbors(benchmark=False):
+  random.seed(10098331)
+  for n in (1000000,) if benchmark else (0,1,35,200):
+    X = random.randn(n,3).astype(real)
+    Y = random.randn(100,3).astype(real)
+    tree = ParticleTree(X,10)
+    sqr_d = ((Y[:,None,:]-X[None,:,:])**2).sum(axis=-1) if not benchmark else None
+    for k in 1,5:
+      start = time.time()
+      knn,dists = tree.knn(X if benchmark else Y,k,inf,0)
+      if benchmark:
+        print 'knn %d: %g s'%(k,time.time()-start)
+        continue
+      assert all(tree.knn(Y,k,inf,1)[0].flat==knn.flat)
+      for i in xrange(len(Y)):
+        order = argsort(sqr_d[i],kind='mergesort')[:k]
+        assert all(knn[i]==order)
+        assert allclose(dists[i],sqrt(sqr_d[i,order]))
+    if benchmark:
+      start = time.time()
+      closest_point_loop(tree,X)
+      print 'closest_point loop: %g s'%(time.time()-start)
+      continue
+    for r in 0,.5,1:
+      near,dists = tree.radius_neighbors(Y,r,0)
+      for i in xrange(len(Y)):
+        inside = nonzero(sqr_d[i]<=r*r)[0]
+        assert all(near[i]==inside[argsort(sqr_d[i,inside],kind='mergesort')])
+
 def test_simplex_tree():
   mesh,X = sphere_mesh(4)
   tree = SimplexTree(mesh,X,4)
@@ -30,6 +73,46 @@ def test_simplex_tree():
   hits = ray_traversal_test(tree,rays,1e-6)
   print 'rays = %d, hits = %d'%(rays,hits)
   assert hits==642
+  # Without thickness, packets must reproduce single ray hits exactly
+  ray_traversal_test(tree,rays,0)
+  # Batch inside tests must agree with single point tests away from the surface
+  for threads in 1,3:
+    inside_test(tree,1000,threads)
+  # Wide tree closest points must match the binary tree, and trees built from this one must not disturb it
+  closest_point_test(tree,1000)
+
+def closest_point_timing():
+  mesh,X = sphere_mesh(6)
+  tree = SimplexTree(mesh,X,4)
+  for wide in False,True:
+    start = time.time()
+    closest_point_benchmark(tree,100000,wide)
+    print '%s closest points: %g s'%('wide' if wide else 'binary',time.time()-start)
+
+def test_sah_tree(benchmark=False):
+  # A fine sphere next to a big cube, so that triangle sizes are very uneven
+  sphere,X0 = sphere_mesh(6 if benchmark else 3,(3,0,0),.5)
+  cube,X1 = cube_mesh((-2,-2,-2),(2,2,2))
+  mesh = TriangleSoup(concatenate([sphere.elements,len(X0)+cube.elements]))
+  X = concatenate([X0,X1])
+  rays = 100000 if benchmark else 1000
+  hits = []
+  for sah in False,True:
+    tree = SimplexTree(mesh,X,4,sah,2)
+    if not benchmark:
+      assert ray_traversal_test(tree,rays,1e-6)==ray_traversal_test(SimplexTree(mesh,X,4,sah,1),rays,1e-6)
+    start = time.time()
+    hits.append(ray_traversal_benchmark(tree,rays,1e-6))
+    if benchmark:
+      print '%s: %g s'%('sah' if sah else 'median',time.time()-start)
+    start = time.time()
+    hits.append(ray_packet_benchmark(tree,rays,1e-6))
+    if benchmark:
+      print '%s packets: %g s'%('sah' if sah else 'median',time.time()-start)
+  assert len(set(hits))==1
 
 if __name__=='__main__':
+  test_particle_neighbors(benchmark=True)
   test_simplex_tree()
+  closest_point_timing()
+  test_sah_tree(benchmark=True)
@@ -72,6 +72,29 @@ def test_consistency():
       print 'box %s, sizes %s, volume %g\ninner box %s, sizes %s, volume %g'%(box,box.sizes(),box.volume(),inner_box,inner_box.sizes(),inner_box.volume())
       assert False
 
+def test_batch():
+  random.seed(98184)
+  sphere = Sphere((1,2,3),2)
+  shapes = [
+    Sphere((1,2),2),
+    sphere,
+    Box((-1,),(2,)),
+    Box((-1,-2),(1,2)),
+    Box((-1,-2,-3),(1,2,3)),
+    Capsule((-.5,-.5),(1,2),1),
+    Capsule((-.5,-.5,-.5),(1,2,3),1),
+    Cylinder((-1,-2,-3),(4,2,1),1.5),
+    ThickShell(TriangleSoup([(0,1,2)]),random.randn(3,3),.2*abs(random.randn(3))),
+    FrameImplicit(Frames(random.randn(3),Rotation.from_angle_axis(pi/3,(1,2,3))),sphere)]
+  for shape in shapes:
+    box = shape.bounding_box()
+    X = box.min+(box.max-box.min)*random.uniform(-.5,1.5,size=(1000,len(box.min)))
+    phi = shape.phis(X)
+    assert allclose(phi,[shape.phi(x) for x in X],rtol=0,atol=1e-12)
+    assert all(shape.lazy_insides(X)==[shape.lazy_inside(x) for x in X])
+    assert allclose(shape.normals(X),[shape.normal(x) for x in X],rtol=0,atol=1e-10)
+    assert allclose(shape.surfaces(X),[shape.surface(x) for x in X],rtol=0,atol=1e-10)
+
 """
 def test_generate_triangles():
   tolerance=1e-5
@@ -97,3 +120,4 @@ if __name__=='__main__':
   test_segments()
   test_bounding_box()
   test_consistency()
+  test_batch()
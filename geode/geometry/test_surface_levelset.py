@@ -12,6 +12,9 @@ def test_surface_levelset():
   particles = ParticleTree(random.randn(1000,3),10)
   print 'fast'
   phi,normal,triangles,weights = surface_levelset(particles,surface,10,True)
+  # Threads should not change anything
+  phi4,normal4,triangles4,weights4 = surface_levelset(particles,surface,10,True,3)
+  assert all(phi==phi4) and all(normal==normal4) and all(triangles==triangles4) and all(weights==weights4)
   mags,Xn = magnitudes_and_normalized(particles.X)
   print 'phi range %g %g'%(phi.min(),phi.max())
   # Compare with sphere distances
@@ -39,3 +42,23 @@ def test_surface_levelset():
     print 'i %d, phi %g, phi2 %g'%(i,phi[i],phi2[i])
   assert relative_error(abs(phi),phi2) < 1e-7
   assert all(magnitudes(cross(normal,normal2))<1e-7)
+
+def test_sparse_levelset():
+  random.seed(127131)
+  mesh,X = sphere_mesh(4)
+  surface = SimplexTree(mesh,X,10)
+  dx = .05
+  levelset = SparseLevelSet(surface,dx,4,1)
+  Y = random.randn(300,3)
+  Y *= random.uniform(.7,1.3,size=(len(Y),1))/magnitudes(Y).reshape(-1,1)
+  phi,_,_,_ = surface_levelset(ParticleTree(Y,10),surface,inf,True)
+  sparse = asarray([levelset.phi(y) for y in Y])
+  # Within a cell of the surface, nodes are exact and only interpolation error remains
+  near = absolute(phi)<dx
+  assert absolute(sparse-phi)[near].max() < dx/10
+  # Fast marching is first order farther out, and everything outside the band is exact
+  assert absolute(sparse-phi).max() < dx/2
+  assert all((sparse<0)==(phi<0))
+  normals = asarray([levelset.normal(y) for y in Y])
+  assert maxabs(magnitudes(normals)-1) < 1e-10
+  assert all(dots(normals,Y/magnitudes(Y).reshape(-1,1)) > .9)
@@ -7,6 +7,9 @@
 #include <geode/array/RawStack.h>
 #include <geode/array/view.h>
 #include <geode/geometry/BoxTree.h>
+#include <geode/python/ExceptionValue.h>
+#include <geode/utility/openmp.h>
+#include <vector>
 namespace geode {
 
 // Traverse one box tree.  There is no automatic culling: the visitor is responsible for everything.
@@ -123,4 +126,110 @@ template<class Visitor,class TV> static void double_traverse(const BoxTree<TV>&
   double_traverse_helper(tree,visitor,Zero());
 }
 
+// Opt-in traits for parallel_double_traverse.  A thread safe visitor is shared by all threads, so cull and leaf may be
+// called concurrently.  A mergeable visitor provides clone(), which returns an empty visitor sharing the same inputs,
+// and merge(Visitor& other), which absorbs the results of a clone.
+template<class Visitor> struct traverse_thread_safe : public mpl::false_ {};
+template<class Visitor> struct traverse_mergeable : public mpl::false_ {};
+
+// Opt-in per thread setup for parallel_double_traverse.  An object of type traverse_scope<Visitor>::type is constructed
+// on each thread before it starts traversing (and once around a serial traversal), so that visitors can hoist setup
+// such as IntervalScope out of leaf.
+template<class Visitor> struct traverse_scope { struct type { type() {} }; };
+
+// One visitor per piece of a parallel traversal: clones for mergeable visitors, otherwise the original
+template<class Visitor,bool mergeable=traverse_mergeable<Visitor>::value> struct TraverseClones {
+  Visitor& visitor;
+  TraverseClones(Visitor& visitor, const int count) : visitor(visitor) {}
+  Visitor& operator[](const int t) { return visitor; }
+  void merge() {}
+};
+template<class Visitor> struct TraverseClones<Visitor,true> {
+  Visitor& visitor;
+  std::vector<Visitor> clones;
+  TraverseClones(Visitor& visitor, const int count)
+    : visitor(visitor) {
+    clones.reserve(count);
+    for (int t=0;t<count;t++)
+      clones.push_back(visitor.clone());
+  }
+  Visitor& operator[](const int t) { return clones[t]; }
+  void merge() { for (auto& clone : clones) visitor.merge(clone); }
+};
+
+// Split a double traversal into independent pieces by expanding pairs of intersecting nodes breadth first until
+// there are at least count pieces.  Leaf pairs and unexpanded pairs are returned untested.
+template<class Visitor,class TV> static Array<Vector<int,2>>
+double_traverse_tasks(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, const Visitor& visitor, const int count,
+                      const typename TV::Scalar thickness) {
+  Array<Vector<int,2>> tasks, queue;
+  if (!tree0.nodes() || !tree1.nodes())
+    return tasks;
+  queue.append(vec(0,0));
+  int lo = 0;
+  while (lo<queue.size() && tasks.size()+queue.size()-lo<count) {
+    const auto n = queue[lo++];
+    const bool split0 = n.x<tree0.leaves.lo,
+               split1 = n.y<tree1.leaves.lo;
+    if (!split0 && !split1)
+      tasks.append(n);
+    else if (!visitor.cull(n.x,n.y) && tree0.boxes[n.x].intersects(tree1.boxes[n.y],thickness))
+      for (const int i : range(split0?2:1))
+        for (const int j : range(split1?2:1))
+          queue.append(vec(split0?2*n.x+1+i:n.x,split1?2*n.y+1+j:n.y));
+  }
+  tasks.extend(queue.slice(lo,queue.size()));
+  return tasks;
+}
+
+// Traverse two distinct hierarchies on up to threads threads (0 for all), with the same visitor interface as
+// double_traverse.  Visitors must opt in via traverse_thread_safe or traverse_mergeable; others are traversed serially.
+// Mergeable visitors get one clone per piece, and clones are merged back in order, so results do not depend on
+// scheduling.  They may still depend on the number of threads through the order of pieces.
+template<class Visitor,class TV> static void
+parallel_double_traverse(const BoxTree<TV>& tree0, const BoxTree<TV>& tree1, Visitor& visitor, const int threads,
+                         const typename TV::Scalar thickness=0) {
+  static_assert(!(traverse_thread_safe<Visitor>::value && traverse_mergeable<Visitor>::value),
+                "Visitors should be thread safe or mergeable, not both");
+  GEODE_ASSERT(&tree0 != &tree1,"Identical trees should use the serial routine");
+  GEODE_ASSERT(threads>=0);
+  const int nt = threads ? threads : omp_get_max_threads();
+  if (   nt==1 || !tree0.nodes() || !tree1.nodes()
+      || !(traverse_thread_safe<Visitor>::value || traverse_mergeable<Visitor>::value)) {
+    const typename traverse_scope<Visitor>::type scope;
+    double_traverse(tree0,tree1,visitor,thickness);
+    return;
+  }
+  const auto tasks = double_traverse_tasks(tree0,tree1,visitor,16*nt,thickness);
+  TraverseClones<Visitor> clones(visitor,tasks.size());
+
+  // Exceptions can't escape OpenMP regions, so we stash the first
+  const int buffer_size = 3*max(tree0.depth,tree1.depth);
+  ExceptionValue error;
+  #pragma omp parallel num_threads(nt)
+  {
+    const typename traverse_scope<Visitor>::type scope;
+    #pragma omp for schedule(dynamic,1)
+    for (int t=0;t<tasks.size();t++) {
+      try {
+        RawStack<Vector<int,2>> stack(GEODE_RAW_ALLOCA(buffer_size,Vector<int,2>));
+        auto& local = clones[t];
+        if (thickness)
+          double_traverse_helper(tree0,tree1,local,stack,tasks[t].x,tasks[t].y,thickness);
+        else
+          double_traverse_helper(tree0,tree1,local,stack,tasks[t].x,tasks[t].y,Zero());
+      } catch (const std::exception& e) {
+        #pragma omp critical
+        {
+          if (!error)
+            error = ExceptionValue(e);
+        }
+      }
+    }
+  }
+  if (error)
+    error.throw_();
+  clones.merge();
+}
+
 }
@@ -16,6 +16,7 @@
 #include <geode/utility/Log.h>
 #include <geode/vector/convert.h>
 #include <geode/structure/UnionFind.h>
+#include <algorithm>
 namespace geode {
 
 using Log::cout;
@@ -1639,6 +1640,118 @@ Vector<Array<int>,3> MutableTriangleTopology::collect_garbage() {
   return vec(vertex_permutation,face_permutation,boundary_permutation);
 }
 
+Array<int> MutableTriangleTopology::canonicalize() {
+  GEODE_ASSERT(n_vertices()==vertex_to_edge_.size() && n_faces()==faces_.size());
+  const int nv = n_vertices(),
+            nf = n_faces(),
+            nb = n_boundary_edges();
+
+  // Rotate each face to start at its smallest vertex, bucket faces by that vertex, and sort within each bucket
+  Array<int> rotation(nf,uninit),
+             offsets(nv+1);
+  for (const int f : range(nf)) {
+    const auto& v = faces_.flat[f].vertices;
+    const int r = v.x<v.y ? v.x<v.z ? 0 : 2 : v.y<v.z ? 1 : 2;
+    rotation[f] = r;
+    offsets[v[r].id+1]++;
+  }
+  for (const int i : range(nv))
+    offsets[i+1] += offsets[i];
+  Array<int> order(nf,uninit);
+  {
+    Array<int> next = offsets.slice(0,nv).copy();
+    for (const int f : range(nf))
+      order[next[faces_.flat[f].vertices[rotation[f]].id]++] = f;
+  }
+  const auto key = [&](const int f) {
+    const auto& v = faces_.flat[f].vertices;
+    const int r = rotation[f];
+    return vec(v[(r+1)%3].id,v[(r+2)%3].id);
+  };
+  for (const int i : range(nv))
+    std::sort(order.begin()+offsets[i],order.begin()+offsets[i+1],[&](const int a, const int b) {
+      const auto ka = key(a), kb = key(b);
+      return ka.x<kb.x || (ka.x==kb.x && ka.y<kb.y);
+    });
+  Array<int> face_permutation(nf,uninit);
+  for (const int i : range(nf))
+    face_permutation[order[i]] = i;
+  const auto interior = [&](const HalfedgeId h) {
+    const int f = h.id/3;
+    return HalfedgeId(3*face_permutation[f]+(h.id%3-rotation[f]+3)%3);
+  };
+
+  // Order boundary halfedges by their reverses, dropping erased boundary halfedges
+  Array<int> boundary_permutation(boundaries_.size());
+  boundary_permutation.fill(-1);
+  {
+    Array<int> by_reverse(3*nf);
+    by_reverse.fill(-1);
+    for (const int b : range(boundaries_.size()))
+      if (!erased(HalfedgeId(-1-b)))
+        by_reverse[interior(boundaries_[b].reverse).id] = b;
+    int j = 0;
+    for (const int b : by_reverse)
+      if (b>=0)
+        boundary_permutation[b] = j++;
+  }
+  const auto permute = [&](const HalfedgeId h) {
+    return h.id>=0 ? interior(h) : HalfedgeId(-1-boundary_permutation[-1-h.id]);
+  };
+
+  // Rebuild the flat arrays
+  Field<FaceInfo,FaceId> faces(nf,uninit);
+  for (const int f : range(nf)) {
+    const auto& old = faces_.flat[f];
+    auto& info = faces.flat[face_permutation[f]];
+    for (const int i : range(3)) {
+      const int j = (i+rotation[f])%3;
+      info.vertices[i] = old.vertices[j];
+      info.neighbors[i] = permute(old.neighbors[j]);
+    }
+  }
+  Array<BoundaryInfo> boundaries(nb,uninit);
+  for (const int b : range(boundaries_.size())) {
+    if (boundary_permutation[b]<0)
+      continue;
+    const auto& old = boundaries_[b];
+    auto& info = boundaries[boundary_permutation[b]];
+    info.prev = permute(old.prev);
+    info.next = permute(old.next);
+    info.reverse = permute(old.reverse);
+    info.src = old.src;
+  }
+  auto& vertex_to_edge = mutable_vertex_to_edge_.flat;
+  vertex_to_edge.fill(HalfedgeId());
+  for (const int b : range(nb)) {
+    auto& e = vertex_to_edge[boundaries[b].src.id];
+    if (!e.valid())
+      e = HalfedgeId(-1-b);
+  }
+  for (const int f : range(nf))
+    for (const int i : range(3)) {
+      auto& e = vertex_to_edge[faces.flat[f].vertices[i].id];
+      if (!e.valid())
+        e = HalfedgeId(3*f+i);
+    }
+  mutable_faces_ = faces;
+  mutable_boundaries_ = boundaries;
+  mutable_erased_boundaries_ = HalfedgeId();
+
+  // Permute fields
+  Array<char> work;
+  for (auto& s : face_fields)
+    inplace_partial_permute(s,face_permutation,work);
+  if (halfedge_fields.size()) {
+    Array<int> halfedge_permutation(3*nf,uninit);
+    for (const int h : range(3*nf))
+      halfedge_permutation[h] = interior(HalfedgeId(h)).id;
+    for (auto& s : halfedge_fields)
+      inplace_partial_permute(s,halfedge_permutation,work);
+  }
+  return face_permutation;
+}
+
 Array<int> TriangleTopology::internal_collect_boundary_garbage() {
   // Compact boundaries
   int j = 0;
@@ -2311,6 +2424,7 @@ void wrap_corner_mesh() {
       .GEODE_METHOD(erase_isolated_vertices)
       .GEODE_METHOD(collect_garbage)
       .GEODE_METHOD(collect_boundary_garbage)
+      .GEODE_METHOD(canonicalize)
       #ifdef GEODE_PYTHON
       .GEODE_METHOD_2("add_vertex_field",add_vertex_field_py)
       .GEODE_METHOD_2("add_face_field",add_face_field_py)
@@ -603,6 +603,13 @@ public:
   // For any field f (not managed by this object), use f.permute() to create a field that works with the new ids.
   GEODE_CORE_EXPORT Vector<Array<int>,3> collect_garbage();
 
+  // Renumber faces and halfedges so that ids depend only on the set of triangles, not on the order of construction.
+  // Each face is rotated to start at its smallest vertex, faces are sorted lexicographically, boundary halfedges are
+  // ordered by their reverses, and each vertex's halfedge is its first outgoing boundary halfedge (or first outgoing
+  // interior halfedge if it has none).  Requires no erased vertices or faces; erased boundary halfedges are dropped.
+  // Returns the face permutation, such that old face f is now face permutation[f].
+  GEODE_CORE_EXPORT Array<int> canonicalize();
+
   // Collect unused boundary halfedges.  Returns old_to_new map.  This can be called after construction
   // from triangle soup, since unordered face addition leaves behind garbage boundary halfedges.
   // The complexity is linear in the size of the boundary (including garbage).
@@ -264,8 +264,52 @@ def test_fields():
     # Flip some edges, check that the content of affected faces is as expected
     # (we're already checking consistency)
 
+def test_canonicalize():
+  random.seed(813178)
+  for soup in grid_topology(4,5),torus_topology(4,5):
+    structure = None
+    for i in xrange(3):
+      # Build the same mesh from shuffled and rotated triangles
+      tris = soup.elements.copy()
+      random.shuffle(tris)
+      tris = asarray([roll(t,random.randint(3)) for t in tris],dtype=int32)
+      mesh = MutableTriangleTopology()
+      mesh.add_vertices(soup.nodes())
+      mesh.add_faces(tris)
+
+      # Fields must follow their faces and halfedges
+      Ii = mesh.add_face_field('i',invalid_id)
+      Hi = mesh.add_halfedge_field('2i',invalid_id)
+      I,H = mesh.field(Ii),mesh.field(Hi)
+      for f in mesh.all_faces():
+        I[f] = f
+      for h in mesh.interior_halfedges():
+        H[h] = mesh.halfedge_vertices(h)
+      perm = mesh.canonicalize()
+      mesh.assert_consistent(True)
+      I,H = mesh.field(Ii),mesh.field(Hi)
+      assert all(perm[I]==arange(mesh.n_faces))
+      for h in mesh.interior_halfedges():
+        assert all(H[h]==mesh.halfedge_vertices(h))
+
+      # Ids depend only on the set of triangles
+      loops = mesh.boundary_loops()
+      s = (mesh.elements(),loops.offsets,loops.flat,
+           [mesh.halfedge(v) for v in mesh.all_vertices()],
+           [mesh.face_halfedges(f) for f in mesh.all_faces()],
+           [mesh.halfedge_faces(h) for h in mesh.interior_halfedges()])
+      if structure is None:
+        structure = s
+        t = s[0]
+        assert all(t[:,0]<t[:,1]) and all(t[:,0]<t[:,2])
+        assert all(diff(t[:,0])>=0)
+      else:
+        for a,b in zip(structure,s):
+          assert all(asarray(a)==asarray(b))
+
 if __name__=='__main__':
   test_fields()
+  test_canonicalize()
   test_corner_construction()
   test_halfedge_construction()
   test_collapse()
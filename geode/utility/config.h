@@ -91,6 +91,9 @@ typedef double real;
 
 #define GEODE_ALIGNED(n) __attribute__((aligned(n)))
 
+// Thread local storage for plain old data
+#define GEODE_THREAD_LOCAL __thread
+
 #else // _WIN32
 
 #ifndef GEODE_SINGLE_LIB
@@ -117,6 +120,7 @@ typedef double real;
 #define GEODE_FORMAT
 #define GEODE_EXPECT(value,expect) (value)
 #define GEODE_ALIGNED(n) __declspec(align(n))
+#define GEODE_THREAD_LOCAL __declspec(thread)
 
 #endif
 